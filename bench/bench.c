@@ -0,0 +1,188 @@
+// Benchmarks for the request and parse paths, run against bench/mock_server.c.
+//
+// Usage: bench [iterations]
+//
+// NEKOS_BASE_URL must point at the mock server, see the bench target in the Makefile.
+#define _POSIX_C_SOURCE 200809L
+
+#define NEKOSBEST_IMPL
+#include <nekosbest.h>
+
+#include <time.h>
+
+#define DEFAULT_ITERATIONS 1000
+#define PARSE_ITERATIONS_FACTOR 20
+#define RANGED_CHUNK_SIZE (32 * 1024)
+
+typedef struct {
+    const char *name;
+    size_t iterations;
+    double *samples; // nanoseconds per operation
+    double total;
+} bench_result;
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec * 1e9 + (double) ts.tv_nsec;
+}
+
+static int compare_doubles(const void *a, const void *b) {
+    double x = *(const double*) a;
+    double y = *(const double*) b;
+    return (x > y) - (x < y);
+}
+
+static void report(bench_result *result) {
+    qsort(result->samples, result->iterations, sizeof(double), compare_doubles);
+    double p50 = result->samples[result->iterations / 2];
+    double p99 = result->samples[(result->iterations * 99) / 100];
+    printf("%-24s %10zu %14.1f %12.2f %12.2f\n", result->name, result->iterations,
+        result->iterations / (result->total / 1e9), p50 / 1e3, p99 / 1e3);
+}
+
+static int fail(const char *name, nekos_status status) {
+    fprintf(stderr, "%s failed with error code %d\n", name, status);
+    return EXIT_FAILURE;
+}
+
+int main(int argc, char **argv) {
+    size_t iterations = argc > 1 ? (size_t) atol(argv[1]) : DEFAULT_ITERATIONS;
+    if (iterations == 0)
+        iterations = DEFAULT_ITERATIONS;
+    size_t parse_iterations = iterations * PARSE_ITERATIONS_FACTOR;
+
+    bench_result result;
+    result.samples = (double*) malloc(parse_iterations * sizeof(double));
+    if (!result.samples)
+        return fail("allocation", NEKOS_MEM_ERR);
+
+    nekos_client *client = nekos_default_client();
+    if (!client)
+        return fail("nekos_default_client", NEKOS_LIBCURL_ERR);
+
+    // wait for the mock server to come up
+    nekos_endpoint_list endpoints;
+    nekos_status status = NEKOS_LIBCURL_ERR;
+    for (int attempt = 0; attempt < 50 && status != NEKOS_OK; attempt++) {
+        status = nekos_endpoints(&endpoints);
+        if (status != NEKOS_OK) {
+            struct timespec delay = { 0, 100 * 1000 * 1000 };
+            nanosleep(&delay, NULL);
+        }
+    }
+    if (status != NEKOS_OK)
+        return fail("nekos_endpoints", status);
+    nekos_free_endpoints(&endpoints);
+
+    nekos_endpoint endpoint;
+    endpoint.name = "neko";
+    endpoint.format = NEKOS_PNG;
+
+    printf("%-24s %10s %14s %12s %12s\n", "benchmark", "iterations", "ops/s", "p50 (us)", "p99 (us)");
+
+    // nekos_category
+    result.name = "nekos_category";
+    result.iterations = iterations;
+    result.total = 0;
+    for (size_t i = 0; i < iterations; i++) {
+        nekos_result_list results;
+        double start = now_ns();
+        status = nekos_category(&results, &endpoint, NEKOS_MAX_AMOUNT);
+        result.samples[i] = now_ns() - start;
+        result.total += result.samples[i];
+        if (status != NEKOS_OK)
+            return fail(result.name, status);
+        nekos_free_results(&results);
+    }
+    report(&result);
+
+    // nekos_search
+    result.name = "nekos_search";
+    result.total = 0;
+    for (size_t i = 0; i < iterations; i++) {
+        nekos_result_list results;
+        double start = now_ns();
+        status = nekos_search(&results, "citrus", NEKOS_MAX_AMOUNT, NEKOS_GIF, NULL);
+        result.samples[i] = now_ns() - start;
+        result.total += result.samples[i];
+        if (status != NEKOS_OK)
+            return fail(result.name, status);
+        nekos_free_results(&results);
+    }
+    report(&result);
+
+    // nekos_download
+    nekos_result_list images;
+    status = nekos_category(&images, &endpoint, 1);
+    if (status != NEKOS_OK)
+        return fail("nekos_category", status);
+    result.name = "nekos_download";
+    result.total = 0;
+    for (size_t i = 0; i < iterations; i++) {
+        nekos_http_response http_response;
+        double start = now_ns();
+        status = nekos_download(&http_response, images.responses[0].url);
+        result.samples[i] = now_ns() - start;
+        result.total += result.samples[i];
+        if (status != NEKOS_OK)
+            return fail(result.name, status);
+        nekos_free_http_response(&http_response);
+    }
+    report(&result);
+
+    // nekos_download_ranged, split into four ranges
+    result.name = "nekos_download_ranged";
+    result.total = 0;
+    for (size_t i = 0; i < iterations; i++) {
+        nekos_http_response http_response;
+        double start = now_ns();
+        status = nekos_download_ranged(&http_response, images.responses[0].url, RANGED_CHUNK_SIZE, 4);
+        result.samples[i] = now_ns() - start;
+        result.total += result.samples[i];
+        if (status != NEKOS_OK)
+            return fail(result.name, status);
+        nekos_free_http_response(&http_response);
+    }
+    nekos_free_results(&images);
+    report(&result);
+
+    // json parsing of a full category response, timed without the copy of the input
+    nekos_http_response canned;
+    status = nekos_do_request(client, NEKOS_STATS_CATEGORY, &canned, NEKOS_BASE_URL "neko?amount=20");
+    if (status != NEKOS_OK)
+        return fail("nekos_do_request", status);
+
+    static const struct { const char *name; int flags; } parse_modes[] = {
+        { "parse (heap)", 0 },
+        { "parse (arena)", NEKOS_ARENA_RESULTS },
+        { "parse (zero-copy)", NEKOS_ZERO_COPY_RESULTS }
+    };
+    for (size_t m = 0; m < sizeof(parse_modes) / sizeof(parse_modes[0]); m++) {
+        result.name = parse_modes[m].name;
+        result.iterations = parse_iterations;
+        result.total = 0;
+        for (size_t i = 0; i < parse_iterations; i++) {
+            nekos_http_response copy;
+            copy.len = canned.len;
+            copy.text = (char*) malloc(canned.len);
+            if (!copy.text)
+                return fail(result.name, NEKOS_MEM_ERR);
+            memcpy(copy.text, canned.text, canned.len);
+
+            nekos_result_list results;
+            double start = now_ns();
+            status = nekos_parse_results(parse_modes[m].flags, &results, &copy, NEKOS_PNG);
+            result.samples[i] = now_ns() - start;
+            result.total += result.samples[i];
+            if (status != NEKOS_OK)
+                return fail(result.name, status);
+            nekos_free_results(&results);
+        }
+        report(&result);
+    }
+
+    nekos_free_http_response(&canned);
+    free(result.samples);
+    return EXIT_SUCCESS;
+}
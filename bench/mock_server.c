@@ -0,0 +1,246 @@
+// Offline stand-in for the nekos.best API, serving canned responses on 127.0.0.1.
+//
+// Usage: mock_server [port]
+//
+// Routes:
+//   /api/v2/endpoints               list of categories (supports If-None-Match)
+//   /api/v2/<category>?amount=N     N results of the category
+//   /api/v2/search?type=T&amount=N  N results of format T (1 = png, 2 = gif)
+//   /image/<name>                   a canned image (supports HEAD and single byte ranges)
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <signal.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#define DEFAULT_PORT 8765
+#define IMAGE_SIZE (128 * 1024)
+#define MAX_AMOUNT 20
+#define REQUEST_SIZE 8192
+#define BODY_SIZE 16384
+#define ENDPOINTS_ETAG "\"mock-endpoints-1\""
+
+typedef struct {
+    const char *name;
+    int png;
+} category;
+
+static const category categories[] = {
+    { "husbando", 1 }, { "kitsune", 1 }, { "neko", 1 }, { "waifu", 1 },
+    { "baka", 0 }, { "bite", 0 }, { "blush", 0 }, { "cuddle", 0 }, { "hug", 0 }, { "kiss", 0 }, { "pat", 0 }, { "wave", 0 }
+};
+#define CATEGORY_COUNT (sizeof(categories) / sizeof(categories[0]))
+
+static int port = DEFAULT_PORT;
+static char image[IMAGE_SIZE];
+
+static int write_all(int fd, const char *data, size_t len) {
+    while (len > 0) {
+        ssize_t written = write(fd, data, len);
+        if (written <= 0)
+            return 0;
+        data += written;
+        len -= (size_t) written;
+    }
+
+    return 1;
+}
+
+static int head_request;
+
+static int respond(int fd, int code, const char *type, const char *extra_headers, const char *body, size_t len) {
+    char header[512];
+    int header_len = snprintf(header, sizeof(header),
+        "HTTP/1.1 %d %s\r\nContent-Type: %s\r\nContent-Length: %zu\r\nConnection: keep-alive\r\n%s\r\n",
+        code, code == 200 ? "OK" : code == 206 ? "Partial Content" : code == 304 ? "Not Modified" : "Not Found", type, len, extra_headers);
+    return write_all(fd, header, (size_t) header_len) && (head_request || write_all(fd, body, len));
+}
+
+static const char* find_header(char *headers, const char *name) {
+    size_t name_len = strlen(name);
+    for (char *line = strstr(headers, "\r\n"); line; line = strstr(line + 2, "\r\n"))
+        if (strncasecmp(line + 2, name, name_len) == 0 && line[2 + name_len] == ':')
+            return line + 2 + name_len + 1 + strspn(line + 2 + name_len + 1, " ");
+    return NULL;
+}
+
+static int respond_image(int fd, char *headers) {
+    // serve a single byte range if asked for one
+    unsigned long first, last;
+    const char *range = find_header(headers, "Range");
+    if (range && sscanf(range, "bytes=%lu-%lu", &first, &last) == 2 && first <= last && last < sizeof(image)) {
+        char content_range[128];
+        snprintf(content_range, sizeof(content_range), "Accept-Ranges: bytes\r\nContent-Range: bytes %lu-%lu/%zu\r\n", first, last, sizeof(image));
+        return respond(fd, 206, "image/png", content_range, image + first, last - first + 1);
+    }
+
+    return respond(fd, 200, "image/png", "Accept-Ranges: bytes\r\n", image, sizeof(image));
+}
+
+static int query_int(const char *query, const char *key, int fallback) {
+    // find "key=" at the start of a parameter
+    size_t key_len = strlen(key);
+    for (const char *param = query; param; param = strchr(param, '&')) {
+        if (*param == '&' || *param == '?')
+            param++;
+        if (strncmp(param, key, key_len) == 0 && param[key_len] == '=')
+            return atoi(param + key_len + 1);
+    }
+
+    return fallback;
+}
+
+static size_t results_json(char *body, int png, int amount) {
+    if (amount < 1 || amount > MAX_AMOUNT)
+        amount = 1;
+
+    size_t len = (size_t) snprintf(body, BODY_SIZE, "{\"results\":[");
+    for (int i = 0; i < amount; i++) {
+        if (png)
+            len += (size_t) snprintf(body + len, BODY_SIZE - len,
+                "%s{\"artist_href\":\"https://example.com/artists/%d\",\"artist_name\":\"Artist \\u00e9 %d\","
+                "\"source_url\":\"https://example.com/sources/%d\",\"url\":\"http://127.0.0.1:%d/image/%d.png\"}",
+                i ? "," : "", i, i, i, port, i);
+        else
+            len += (size_t) snprintf(body + len, BODY_SIZE - len,
+                "%s{\"anime_name\":\"Anime %d\",\"url\":\"http://127.0.0.1:%d/image/%d.gif\"}",
+                i ? "," : "", i, port, i);
+    }
+
+    len += (size_t) snprintf(body + len, BODY_SIZE - len, "]}");
+    return len;
+}
+
+static int handle_request(int fd, char *request) {
+    // parse request line
+    head_request = strncmp(request, "HEAD ", 5) == 0;
+    char *path = strchr(request, ' ');
+    if (!path)
+        return 0;
+    path++;
+    char *path_end = strchr(path, ' ');
+    if (!path_end)
+        return 0;
+    *path_end = '\0';
+    char *headers = path_end + 1;
+
+    char *query = strchr(path, '?');
+    size_t path_len = query ? (size_t) (query - path) : strlen(path);
+    if (!query)
+        query = path + path_len;
+
+    static char body[BODY_SIZE];
+    if (strncmp(path, "/image/", 7) == 0)
+        return respond_image(fd, headers);
+
+    if (path_len == 17 && strncmp(path, "/api/v2/endpoints", 17) == 0) {
+        // answer revalidation of cached endpoint lists
+        for (char *line = strstr(headers, "\r\n"); line; line = strstr(line + 2, "\r\n"))
+            if (strncasecmp(line + 2, "If-None-Match: " ENDPOINTS_ETAG, 15 + strlen(ENDPOINTS_ETAG)) == 0)
+                return respond(fd, 304, "application/json", "ETag: " ENDPOINTS_ETAG "\r\n", "", 0);
+
+        size_t len = (size_t) snprintf(body, BODY_SIZE, "{");
+        for (size_t i = 0; i < CATEGORY_COUNT; i++)
+            len += (size_t) snprintf(body + len, BODY_SIZE - len, "%s\"%s\":{\"format\":\"%s\"}", i ? "," : "", categories[i].name, categories[i].png ? "png" : "gif");
+        len += (size_t) snprintf(body + len, BODY_SIZE - len, "}");
+        return respond(fd, 200, "application/json", "ETag: " ENDPOINTS_ETAG "\r\n", body, len);
+    }
+
+    if (path_len == 14 && strncmp(path, "/api/v2/search", 14) == 0) {
+        size_t len = results_json(body, query_int(query, "type", 1) == 1, query_int(query, "amount", 1));
+        return respond(fd, 200, "application/json", "", body, len);
+    }
+
+    for (size_t i = 0; i < CATEGORY_COUNT; i++) {
+        size_t name_len = strlen(categories[i].name);
+        if (path_len == 8 + name_len && strncmp(path, "/api/v2/", 8) == 0 && strncmp(path + 8, categories[i].name, name_len) == 0) {
+            size_t len = results_json(body, categories[i].png, query_int(query, "amount", 1));
+            return respond(fd, 200, "application/json", "", body, len);
+        }
+    }
+
+    return respond(fd, 404, "application/json", "", "{}", 2);
+}
+
+static void serve_connection(int fd) {
+    char request[REQUEST_SIZE + 1];
+    size_t len = 0;
+    for (;;) {
+        // handle every complete request in the buffer
+        char *end;
+        request[len] = '\0';
+        while ((end = strstr(request, "\r\n\r\n"))) {
+            end[2] = '\0';
+            if (!handle_request(fd, request))
+                return;
+
+            size_t consumed = (size_t) (end + 4 - request);
+            memmove(request, request + consumed, len - consumed + 1);
+            len -= consumed;
+        }
+
+        if (len == REQUEST_SIZE)
+            return;
+        ssize_t received = read(fd, request + len, REQUEST_SIZE - len);
+        if (received <= 0)
+            return;
+        len += (size_t) received;
+    }
+}
+
+int main(int argc, char **argv) {
+    if (argc > 1)
+        port = atoi(argv[1]);
+
+    // deterministic image contents behind a png signature
+    unsigned int state = 1;
+    for (size_t i = 0; i < sizeof(image); i++) {
+        state = state * 1103515245u + 12345u;
+        image[i] = (char) (state >> 16);
+    }
+    memcpy(image, "\x89PNG\r\n\x1a\n", 8);
+
+    int server = socket(AF_INET, SOCK_STREAM, 0);
+    int reuse = 1;
+    setsockopt(server, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((unsigned short) port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (server < 0 || bind(server, (struct sockaddr*) &addr, sizeof(addr)) != 0 || listen(server, 128) != 0) {
+        perror("mock_server");
+        return EXIT_FAILURE;
+    }
+
+    // serve each connection in its own process, reaped automatically
+    signal(SIGCHLD, SIG_IGN);
+    signal(SIGPIPE, SIG_IGN);
+    fprintf(stderr, "mock_server listening on 127.0.0.1:%d\n", port);
+    for (;;) {
+        int client = accept(server, NULL, NULL);
+        if (client < 0)
+            continue;
+
+        // headers and body are written separately, don't let them wait for an ack
+        int nodelay = 1;
+        setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+
+        pid_t pid = fork();
+        if (pid == 0) {
+            close(server);
+            serve_connection(client);
+            close(client);
+            _exit(EXIT_SUCCESS);
+        }
+        close(client);
+    }
+}
@@ -10,15 +10,47 @@ extern "C" {
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
 #include <curl/curl.h>
-#include <cjson/cJSON.h>
+#include <time.h>
 
-/// Base URL for nekos.best API.
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#ifdef _WIN32
+#include <io.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <process.h>
+#include <sys/stat.h>
+#include <windows.h>
+#else
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <utime.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <pthread.h>
+#endif
+
+/// Base URL for nekos.best API, can be defined before including the header to use a different server.
+#ifndef NEKOS_BASE_URL
 #define NEKOS_BASE_URL "https://nekos.best/api/v2/"
+#endif
 
 /// Maximum amount of results that can be requested.
 #define NEKOS_MAX_AMOUNT 20
 
+/// Maximum amount of requests made by one call of \link nekos_category_unique nekos_category_unique \endlink.
+#define NEKOS_UNIQUE_MAX_REQUESTS 8
+
+/// Default size of the byte ranges of a ranged download.
+#define NEKOS_DEFAULT_CHUNK_SIZE (256 * 1024)
+
 /// Minimum length of query string.
 #define NEKOS_MIN_QUERY_LEN 3
 /// Maximum length of query string.
@@ -29,8 +61,13 @@ typedef enum {
     NEKOS_OK, ///< Indicates that the operation was successful.
     NEKOS_MEM_ERR, ///< Indicates that there was a memory allocation error.
     NEKOS_LIBCURL_ERR, ///< Indicates that there was an error with libcurl.
-    NEKOS_CJSON_ERR, ///< Indicates that there was an error with cJSON.
-    NEKOS_INVALID_PARAM_ERR ///< Indicates that an invalid parameter was passed to a function.
+    NEKOS_CJSON_ERR, ///< Indicates that a json response could not be parsed.
+    NEKOS_INVALID_PARAM_ERR, ///< Indicates that an invalid parameter was passed to a function.
+    NEKOS_IO_ERR, ///< Indicates that writing to a \link nekos_sink nekos_sink \endlink failed.
+    NEKOS_BUFFER_ERR, ///< Indicates that a caller-supplied buffer was too small for the response.
+    NEKOS_EMPTY_ERR, ///< Indicates that no result was available.
+    NEKOS_RATE_LIMIT_ERR, ///< Indicates that the api rejected the request because of its rate limit.
+    NEKOS_FORMAT_ERR ///< Indicates that an image or snapshot was not in a format that could be read.
 } nekos_status;
 
 /// Enum for the format of the image.
@@ -51,6 +88,17 @@ typedef struct {
     size_t len; ///< [out] Amount of endpoints/categories.
 } nekos_endpoint_list;
 
+/**
+ * Struct for a hash index over a list of endpoints/categories.
+ *
+ * An index refers to the endpoint array of its list, which must outlive it and must not change while it is used.
+ */
+typedef struct {
+    nekos_endpoint *endpoints; ///< [in] Array of the indexed endpoints/categories.
+    size_t *buckets; ///< [in] Open-addressing hash index holding `index + 1` of each endpoint (0 marks an empty bucket).
+    size_t bucket_count; ///< [in] Amount of buckets in the hash index, always a power of two.
+} nekos_endpoint_index;
+
 /// Struct for a gif source.
 typedef struct {
     char *anime_name; ///< [out] Name of the anime the gif is from.
@@ -73,10 +121,29 @@ typedef struct {
     char* url; ///< [out] URL to the image.
 } nekos_result;
 
+/**
+ * Struct for the timing of a single request.
+ *
+ * Phase times are measured from the start of the request, as reported by libcurl.
+ * Phases that did not happen (e.g. the tls handshake on a reused connection) are reported as 0.
+ */
+typedef struct {
+    curl_off_t dns_us; ///< [out] Microseconds until the name was resolved.
+    curl_off_t connect_us; ///< [out] Microseconds until the tcp connection was established.
+    curl_off_t tls_us; ///< [out] Microseconds until the tls handshake was completed.
+    curl_off_t first_byte_us; ///< [out] Microseconds until the first byte of the response was received.
+    curl_off_t total_us; ///< [out] Microseconds until the transfer was completed.
+    curl_off_t parse_us; ///< [out] Microseconds spent parsing the json response, 0 for downloads.
+    curl_off_t bytes_sent; ///< [out] Bytes sent for the request.
+    curl_off_t bytes_received; ///< [out] Bytes of the response body received.
+} nekos_timing;
+
 /// Struct for a list of result images.
 typedef struct {
     nekos_result *responses; ///< [out] Array of result images.
     size_t len; ///< [out] Amount of result images.
+    void *arena; ///< [out] Single block holding the whole list if it was allocated with \link NEKOS_ARENA_RESULTS nekos_client_flag::NEKOS_ARENA_RESULTS \endlink or \link NEKOS_ZERO_COPY_RESULTS nekos_client_flag::NEKOS_ZERO_COPY_RESULTS \endlink, NULL otherwise.
+    nekos_timing timing; ///< [out] Timing of the request the list was parsed from.
 } nekos_result_list;
 
 /**
@@ -85,422 +152,6685 @@ typedef struct {
 typedef struct {
     char *text; ///< [out] Non-nullterminated text of the response.
     size_t len; ///< [out] Length of the response text.
+    nekos_timing timing; ///< [out] Timing of the request, all 0 if no request was made.
 } nekos_http_response;
 
-#ifndef NEKOSBEST_IMPL
+/// Struct for the metadata of an image, see \link nekos_probe nekos_probe \endlink.
+typedef struct {
+    nekos_format format; ///< [out] Format of the image, read from its signature.
+    unsigned int width; ///< [out] Width of the image in pixels.
+    unsigned int height; ///< [out] Height of the image in pixels.
+    unsigned int frames; ///< [out] Amount of frames of the image, 0 if it was not counted.
+    size_t bytes_read; ///< [out] Bytes of the image received to read the metadata.
+} nekos_image_info;
+
+/// Struct for a decoded image of 8-bit RGBA pixels.
+typedef struct {
+    unsigned char *pixels; ///< [in,out] Rows of pixels, 4 bytes each in RGBA order.
+    unsigned int width; ///< [in,out] Width of the image in pixels.
+    unsigned int height; ///< [in,out] Height of the image in pixels.
+    size_t stride; ///< [in,out] Bytes from the start of one row to the start of the next, at least 4 times the width.
+} nekos_image;
+
+/// Struct for the bounding box of a thumbnail.
+typedef struct {
+    unsigned int width; ///< [in] Maximum width of the thumbnail in pixels.
+    unsigned int height; ///< [in] Maximum height of the thumbnail in pixels.
+} nekos_thumbnail_size;
 
 /**
- * Get a list of endpoints/categories.
- *
- * This function fetches the `endpoints` endpoint of the api
- * and parses the response into a list of endpoints.
+ * Callback decoding a downloaded image into RGBA pixels.
  *
- * It will allocate memory for the list of endpoints and the endpoints themselves.
+ * The library does not contain an image decoder, this callback wraps the one of the application.
+ * It is called from worker threads of a \link nekos_thumbnailer nekos_thumbnailer \endlink, possibly for several images at once.
  *
- * \param [out] endpoints
- *   Pointer to a \link nekos_endpoint_list nekos_endpoint_list \endlink to store the endpoints in.
+ * \param [in] data
+ *   Encoded image.
+ * \param [in] len
+ *   Length of the encoded image.
+ * \param [out] image
+ *   Pointer to a \link nekos_image nekos_image \endlink to store the decoded image in.
+ * \param [in] userdata
+ *   User pointer of the \link nekos_decoder nekos_decoder \endlink.
  *
  * \return
- *   ::NEKOS_OK \n
- *   ::NEKOS_MEM_ERR \n
- *   ::NEKOS_LIBCURL_ERR \n
- *   ::NEKOS_CJSON_ERR
+ *   0 if the image was decoded, any other value otherwise.
  */
-nekos_status nekos_endpoints(nekos_endpoint_list* endpoints);
+typedef int (*nekos_decode_callback)(const char *data, size_t len, nekos_image *image, void *userdata);
 
 /**
- * Find a specific endpoint in a list of endpoints/categories.
- *
- * This function searches for a specific endpoint in a list of endpoints by name.
+ * Callback freeing an image returned by a \link nekos_decode_callback nekos_decode_callback \endlink.
  *
- * \param [in] endpoints
- *   Pointer to a \link nekos_endpoint_list nekos_endpoint_list \endlink to search in.
- * \param [in] name
- *   Name of the endpoint to search for.
+ * \param [in] image
+ *   Pointer to the decoded image.
+ * \param [in] userdata
+ *   User pointer of the \link nekos_decoder nekos_decoder \endlink.
+ */
+typedef void (*nekos_release_callback)(nekos_image *image, void *userdata);
+
+/// Struct for an image decoder supplied by the application.
+typedef struct {
+    nekos_decode_callback decode; ///< [in] Callback decoding an image.
+    nekos_release_callback release; ///< [in] Callback freeing a decoded image, NULL if nothing needs to be freed.
+    void *userdata; ///< [in] User pointer passed to the callbacks.
+} nekos_decoder;
+
+/**
+ * Callback receiving the thumbnails of an image.
  *
- * \return
- *   Pointer to the endpoint if found, NULL otherwise.
+ * \param [in] status
+ *   Status of the download and decoding of the image.
+ * \param [in] thumbnails
+ *   Array with a thumbnail for every size of the thumbnailer if the status is ::NEKOS_OK, NULL otherwise.
+ *   The callback owns the thumbnails and must free them with \link nekos_free_thumbnails nekos_free_thumbnails \endlink.
+ * \param [in] userdata
+ *   User pointer passed when submitting the image.
  */
-nekos_endpoint* nekos_find_endpoint(const nekos_endpoint_list* endpoints, const char* name);
+typedef void (*nekos_thumbnail_callback)(nekos_status status, nekos_image *thumbnails, void *userdata);
+
+/// Amount of buckets in a latency histogram of \link nekos_call_stats nekos_call_stats \endlink.
+#define NEKOS_STATS_BUCKETS 32
+
+/// Api functions tracked in \link nekos_stats nekos_stats \endlink.
+typedef enum {
+    NEKOS_STATS_ENDPOINTS, ///< Requests for the list of endpoints.
+    NEKOS_STATS_CATEGORY, ///< Requests for images of a category.
+    NEKOS_STATS_SEARCH, ///< Search requests.
+    NEKOS_STATS_DOWNLOAD, ///< Image downloads.
+    NEKOS_STATS_COUNT ///< Amount of tracked api functions.
+} nekos_stats_call;
+
+/// Struct for cumulative statistics of an api function.
+typedef struct {
+    unsigned long long count; ///< [out] Amount of requests made.
+    unsigned long long errors; ///< [out] Amount of requests that failed.
+    unsigned long long coalesced; ///< [out] Amount of requests served by an identical request already in flight.
+    unsigned long long retries; ///< [out] Amount of retries after transient failures.
+    unsigned long long hedged; ///< [out] Amount of duplicate requests sent because the first one was late.
+    unsigned long long hedge_wins; ///< [out] Amount of duplicate requests that finished before the first one.
+    nekos_timing total; ///< [out] Sum of the timings of all requests.
+    unsigned long long histogram[NEKOS_STATS_BUCKETS]; ///< [out] Latency histogram. Bucket `i > 0` counts requests that took `[2^(i-1), 2^i)` microseconds including parsing, the last bucket everything above.
+} nekos_call_stats;
 
 /**
- * Get a list of images from a category.
+ * Struct for cumulative statistics of a client.
  *
- * This function fetches the specified category endpoint of the api
- * and parses the response into a list of images.
+ * All values are plain counters which can be exported as they are.
+ */
+typedef struct {
+    nekos_call_stats calls[NEKOS_STATS_COUNT]; ///< [out] Statistics per api function, indexed by \link nekos_stats_call nekos_stats_call \endlink.
+} nekos_stats;
+
+/**
+ * Struct for custom memory allocation functions.
  *
- * It will allocate memory for the list of results, the results themselves, and the source information.
+ * All memory allocated by this library (results, endpoints and response texts) goes through these functions.
+ * Memory allocated by libcurl is not affected.
+ */
+typedef struct {
+    void *(*malloc_fn)(size_t size); ///< [in] Function to allocate memory with, NULL for malloc.
+    void *(*realloc_fn)(void *ptr, size_t size); ///< [in] Function to resize memory with, NULL for realloc.
+    void (*free_fn)(void *ptr); ///< [in] Function to free memory with, NULL for free.
+} nekos_hooks;
+
+/// Flags for configuring a \link nekos_client nekos_client \endlink.
+typedef enum {
+    NEKOS_ARENA_RESULTS = 1 << 0, ///< Allocate each \link nekos_result_list nekos_result_list \endlink as a single block.
+    NEKOS_ZERO_COPY_RESULTS = 1 << 1, ///< Keep the response as the single block of each \link nekos_result_list nekos_result_list \endlink, with strings pointing into it. Takes precedence over \link NEKOS_ARENA_RESULTS nekos_client_flag::NEKOS_ARENA_RESULTS \endlink.
+    NEKOS_COALESCE_REQUESTS = 1 << 2, ///< Let identical search and endpoint requests of clients using the same \link nekos_share nekos_share \endlink share one upstream request while it is in flight.
+    NEKOS_HTTP2 = 1 << 3, ///< Negotiate HTTP/2 over TLS and multiplex parallel requests over one connection instead of opening one per request.
+    NEKOS_COMPRESS_JSON = 1 << 4 ///< Accept every content encoding supported by libcurl (e.g. gzip, brotli, zstd) for json responses of the api. Image downloads are never compressed.
+} nekos_client_flag;
+
+/**
+ * Callback receiving a chunk of a streamed download.
  *
- * \param [out] results
- *   Pointer to a \link nekos_result_list nekos_result_list \endlink to store the results in.
- * \param [in] endpoint
- *   Pointer to a \link nekos_endpoint nekos_endpoint \endlink to specify the category.
- * \param [in] amount
- *   Amount of images to fetch. Must be between 1 and \link NEKOS_MAX_AMOUNT \endlink.
+ * \param [in] data
+ *   Pointer to the received bytes. Only valid for the duration of the call.
+ * \param [in] len
+ *   Amount of received bytes.
+ * \param [in] userdata
+ *   User pointer passed in the \link nekos_sink nekos_sink \endlink.
  *
  * \return
- *   ::NEKOS_OK \n
- *   ::NEKOS_MEM_ERR \n
- *   ::NEKOS_LIBCURL_ERR \n
- *   ::NEKOS_CJSON_ERR \n
- *   ::NEKOS_INVALID_PARAM_ERR
+ *   0 to continue the download, anything else to abort it.
  */
-nekos_status nekos_category(nekos_result_list *results, const nekos_endpoint *endpoint, int amount);
+typedef int (*nekos_chunk_callback)(const char *data, size_t len, void *userdata);
+
+/// Enum for the destination of a streamed download.
+typedef enum {
+    NEKOS_SINK_CALLBACK, ///< Indicates that chunks are passed to \link nekos_sink::callback nekos_sink::callback \endlink.
+    NEKOS_SINK_FD, ///< Indicates that chunks are written to the file descriptor \link nekos_sink::fd nekos_sink::fd \endlink.
+    NEKOS_SINK_FILE ///< Indicates that chunks are written to the stream \link nekos_sink::file nekos_sink::file \endlink.
+} nekos_sink_type;
 
 /**
- * Search for images.
- *
- * This function fetches the `search` endpoint of the api
- * and parses the response into a list of images.
+ * Struct for a streamed download destination.
  *
- * The search can optionally specify a endpoint/category.
+ * Data is written to the sink as soon as it arrives, without buffering the whole response.
+ */
+typedef struct {
+    nekos_sink_type type; ///< [in] Type of the sink.
+    nekos_chunk_callback callback; ///< [in] Callback to pass chunks to (only used if the type is \link NEKOS_SINK_CALLBACK nekos_sink_type::NEKOS_SINK_CALLBACK \endlink).
+    void *userdata; ///< [in] User pointer passed to the callback (only used if the type is \link NEKOS_SINK_CALLBACK nekos_sink_type::NEKOS_SINK_CALLBACK \endlink).
+    int fd; ///< [in] File descriptor to write to (only used if the type is \link NEKOS_SINK_FD nekos_sink_type::NEKOS_SINK_FD \endlink).
+    FILE *file; ///< [in] Stream to write to (only used if the type is \link NEKOS_SINK_FILE nekos_sink_type::NEKOS_SINK_FILE \endlink).
+} nekos_sink;
+
+/**
+ * Struct for a disk cache of downloaded images.
  *
- * It will allocate memory for the list of results, the results themselves, and the source information.
+ * Images are stored in `dir` under a name derived from a hash of their url.
+ * Files are touched on every hit and the least recently used ones are removed once `max_size` is exceeded.
+ * Only files created by the cache are ever removed from `dir`.
  *
- * \param [out] results
- *   Pointer to a \link nekos_result_list nekos_result_list \endlink to store the results in.
- * \param [in] raw_query
- *   Query to search for. Must be between \link NEKOS_MIN_QUERY_LEN \endlink and \link NEKOS_MAX_QUERY_LEN \endlink.
- * \param [in] amount
- *   Amount of images to fetch. Must be between 1 and \link NEKOS_MAX_AMOUNT \endlink.
- * \param [in] format
- *   Format of the images to search for.
- * \param [in] endpoint
- *   Pointer to a \link nekos_endpoint nekos_endpoint \endlink to specify a category. Can be NULL.
+ * The cache keeps a running total of its size, so the directory is only scanned when an added image pushes it over `max_size`.
+ * It can be used by any number of clients and threads at once.
  *
- * \return
- *   ::NEKOS_OK \n
- *   ::NEKOS_MEM_ERR \n
- *   ::NEKOS_LIBCURL_ERR \n
- *   ::NEKOS_CJSON_ERR \n
- *   ::NEKOS_INVALID_PARAM_ERR
+ * The image cache relies on POSIX file mapping and is not available on Windows.
  */
-nekos_status nekos_search(nekos_result_list *results, const char* raw_query, int amount, const nekos_format format, const nekos_endpoint *endpoint);
+typedef struct {
+    const char *dir; ///< [in] Existing directory to store cached images in.
+    size_t max_size; ///< [in] Maximum total size of cached images in bytes.
+    unsigned long long size; ///< [out] Total size of cached images in bytes, recounted by every trim.
+#ifndef _WIN32
+    pthread_mutex_t lock; ///< [in] Lock for `size` and trimming.
+#endif
+} nekos_image_cache;
+
+/// Cached search in a \link nekos_search_cache nekos_search_cache \endlink.
+typedef struct nekos_search_cache_entry nekos_search_cache_entry;
 
 /**
- * Download an image.
+ * Struct for an in-memory cache of search results.
  *
- * This function fetches the specified image url
- * and stores the response in a \link nekos_http_response nekos_http_response \endlink.
+ * Searches are keyed on their query, amount, format and category.
+ * Queries are compared after trimming, collapsing runs of whitespace and folding ascii case, so "Senko" and " senko " share an entry.
+ * Entries are served for `ttl_ms` milliseconds and the least recently used one is evicted once `capacity` searches are cached.
  *
- * It will allocate memory for the response text.
+ * A search cache must only be used by one client at a time.
+ */
+typedef struct {
+    size_t capacity; ///< [in] Maximum amount of cached searches.
+    long ttl_ms; ///< [in] Milliseconds a search is served from the cache.
+    unsigned long long hits; ///< [out] Amount of searches served from the cache.
+    unsigned long long misses; ///< [out] Amount of searches that were not cached or expired.
+    size_t len; ///< [out] Amount of cached searches.
+    nekos_search_cache_entry *entries; ///< [in] Storage for `capacity` entries.
+    size_t *buckets; ///< [in] Hash index holding `index + 1` of the first entry of each chain (0 marks an empty bucket).
+    size_t bucket_count; ///< [in] Amount of buckets in the hash index, always a power of two.
+    size_t free; ///< [in] `index + 1` of the first unused entry, 0 if the cache is full.
+    size_t newest; ///< [in] `index + 1` of the most recently used entry, 0 if the cache is empty.
+    size_t oldest; ///< [in] `index + 1` of the least recently used entry, 0 if the cache is empty.
+} nekos_search_cache;
+
+/**
+ * Struct for a compact set of seen result urls.
  *
- * \param [out] http_response
- *   Pointer to a \link nekos_http_response nekos_http_response \endlink to store the response in.
- * \param [in] url
- *   URL of the image to download.
+ * The set is a bloom filter: it never forgets a url, but may report a url as seen that was not,
+ * at a rate growing with the amount of urls added. It uses about 1.44 * log2(1 / rate) bits per url
+ * for the false-positive rate it was sized for.
  *
- * \return
- *   ::NEKOS_OK \n
- *   ::NEKOS_MEM_ERR \n
- *   ::NEKOS_LIBCURL_ERR
+ * A seen filter must only be used by one client at a time.
  */
-nekos_status nekos_download(nekos_http_response *http_response, const char* url);
+typedef struct {
+    unsigned char *bits; ///< [in] Bit array of the filter.
+    size_t bit_count; ///< [out] Size of the bit array in bits.
+    unsigned int hash_count; ///< [out] Amount of bits set for every url.
+    size_t capacity; ///< [out] Amount of urls the filter was sized for.
+    size_t len; ///< [out] Amount of urls added.
+    size_t set_bits; ///< [out] Amount of bits set.
+} nekos_seen_filter;
 
 /**
- * Free an endpoint.
+ * Struct for a token bucket limiting the rate of requests.
  *
- * This function frees the memory allocated for the endpoint.
+ * Each request takes a token and waits if none is left. Tokens are refilled at `rate` per second up to `burst`.
+ * The rate limit headers of every response drain the bucket early if the api reports fewer remaining requests,
+ * and a request rejected with status 429 pauses all requests until the time given by `Retry-After` before it is retried.
  *
- * \param [in] endpoint
- *   Pointer to a \link nekos_endpoint nekos_endpoint \endlink to free.
-*/
-void nekos_free_endpoint(const nekos_endpoint* endpoint);
+ * A rate limiter can be used by any number of clients and threads at once and must outlive its clients.
+ */
+typedef struct {
+    double rate; ///< [in] Tokens added per second.
+    double burst; ///< [in] Maximum amount of tokens.
+    int max_retries; ///< [in] Amount of times a request rejected with status 429 is retried, 3 after initialization.
+    double tokens; ///< [in] Tokens currently available.
+    curl_off_t updated_us; ///< [in] Time of the last refill.
+    curl_off_t blocked_until_us; ///< [in] Time until which the api asked to pause all requests.
+    size_t queued; ///< [in] Amount of requests waiting for a token, read with \link nekos_rate_limiter_queued nekos_rate_limiter_queued \endlink.
+    unsigned long long throttled; ///< [out] Amount of responses with status 429.
+#ifdef _WIN32
+    CRITICAL_SECTION lock; ///< [in] Lock for the bucket.
+    CONDITION_VARIABLE changed; ///< [in] Signaled when the api changed the limit.
+#else
+    pthread_mutex_t lock; ///< [in] Lock for the bucket.
+    pthread_cond_t changed; ///< [in] Signaled when the api changed the limit.
+#endif
+} nekos_rate_limiter;
+
+/// Request in flight that identical requests wait for.
+typedef struct nekos_flight nekos_flight;
 
 /**
- * Free a list of endpoints.
+ * Struct for state shared between clients.
  *
- * This function frees the memory allocated for the list of endpoints and the endpoints themselves.
+ * A share holds a DNS cache, TLS sessions and a pool of open connections that every
+ * \link nekos_client nekos_client \endlink and \link nekos_async nekos_async \endlink pointing to it uses.
+ * Access is serialized with one lock per kind of data, so clients in different threads can use the same share at once.
  *
- * \param [in] endpoints
- *   Pointer to a \link nekos_endpoint_list nekos_endpoint_list \endlink to free.
+ * It also tracks requests in flight for clients with \link NEKOS_COALESCE_REQUESTS nekos_client_flag::NEKOS_COALESCE_REQUESTS \endlink.
+ *
+ * A share must outlive all clients using it.
  */
-void nekos_free_endpoints(const nekos_endpoint_list* endpoints);
+typedef struct {
+    CURLSH *share; ///< [in] libcurl share handle.
+    nekos_flight *flights; ///< [in] Coalesced requests in flight.
+#ifdef _WIN32
+    CRITICAL_SECTION locks[CURL_LOCK_DATA_LAST]; ///< [in] Lock for each kind of shared data.
+    CRITICAL_SECTION flight_lock; ///< [in] Lock for the coalesced requests.
+    CONDITION_VARIABLE flight_done; ///< [in] Signaled when a coalesced request completes.
+#else
+    pthread_mutex_t locks[CURL_LOCK_DATA_LAST]; ///< [in] Lock for each kind of shared data.
+    pthread_mutex_t flight_lock; ///< [in] Lock for the coalesced requests.
+    pthread_cond_t flight_done; ///< [in] Signaled when a coalesced request completes.
+#endif
+} nekos_share;
 
 /**
- * Free a result.
+ * Struct for the timeouts, retries and hedging of the requests of a client.
  *
- * This function frees the memory allocated for the result and the source information.
+ * Transient failures (connection errors, timeouts and responses with status 500, 502, 503 or 504) are retried
+ * after a random delay between 0 and `backoff_ms * 2^retry`, capped at `max_backoff_ms`.
  *
- * \param [in] result
- *   Pointer to a \link nekos_result nekos_result \endlink to free.
+ * A hedged request sends a duplicate of itself once it took longer than the hedge delay, and takes whichever
+ * finishes first. The duplicate shares the rate limiter of the client and is skipped if no token is available.
+ *
+ * All fields are 0 after client initialization, which disables timeouts, retries and hedging.
+ * Retries and hedging apply to endpoint, category and search requests and single downloads, timeouts to all requests of the client.
+ * An asynchronous context only applies the timeouts of its own policy.
  */
-void nekos_free_result(const nekos_result* result);
+typedef struct {
+    long connect_timeout_ms; ///< [in] Maximum milliseconds to establish a connection, 0 for the libcurl default.
+    long timeout_ms; ///< [in] Maximum milliseconds for each attempt of a request, 0 for no limit.
+    int max_retries; ///< [in] Maximum amount of retries of a request after transient failures.
+    long backoff_ms; ///< [in] Upper bound of the delay before the first retry, doubled for each further retry.
+    long max_backoff_ms; ///< [in] Upper bound of the delay before any retry, 0 for no bound.
+    long hedge_delay_ms; ///< [in] Milliseconds after which a duplicate request is sent, 0 to disable hedging.
+    double hedge_percentile; ///< [in] Latency percentile (between 0 and 100) of previous requests to use as hedge delay instead, once enough requests were made. 0 to always use `hedge_delay_ms`.
+} nekos_request_policy;
 
 /**
- * Free a list of results.
+ * Struct for a reusable client.
  *
- * This function frees the memory allocated for the list of results, the results themselves, and the source information.
+ * A client owns libcurl handles that are kept alive between requests,
+ * so that consecutive requests can reuse open connections, TLS sessions and DNS lookups.
  *
- * \param [in] results
- *   Pointer to a \link nekos_result_list nekos_result_list \endlink to free.
+ * A client must not be used by more than one thread at a time. Use a client per thread
+ * and a \link nekos_share nekos_share \endlink to share caches and connections between them.
  */
-void nekos_free_results(const nekos_result_list* results);
+typedef struct {
+    CURL *curl; ///< [in] libcurl easy handle used for all requests made with this client.
+    CURLM *multi; ///< [in] libcurl multi handle used for parallel requests made with this client.
+    int flags; ///< [in] Bitmask of \link nekos_client_flag nekos_client_flag \endlink, 0 after initialization.
+    nekos_stats stats; ///< [out] Cumulative statistics of requests made with this client.
+    nekos_share *share; ///< [in] State shared with other clients, NULL after initialization.
+    nekos_search_cache *search_cache; ///< [in] Cache for search results, NULL after initialization.
+    nekos_rate_limiter *rate_limiter; ///< [in] Rate limiter for requests to the api and downloads, NULL after initialization.
+    nekos_request_policy policy; ///< [in] Timeouts, retries and hedging of requests, all 0 after initialization.
+    CURL *hedge; ///< [in] libcurl easy handle for duplicate requests, created on first use.
+} nekos_client;
 
 /**
- * Free an http response.
+ * Callback receiving the results of an asynchronous category or search request.
  *
- * This function frees the memory allocated for the response text.
+ * \param [in] status
+ *   Status of the request.
+ * \param [in] results
+ *   Pointer to the parsed results if the status is ::NEKOS_OK, NULL otherwise.
+ *   The callback owns the results and must free them with \link nekos_free_results nekos_free_results \endlink.
+ * \param [in] userdata
+ *   User pointer passed when starting the request.
+ */
+typedef void (*nekos_results_callback)(nekos_status status, nekos_result_list *results, void *userdata);
+
+/**
+ * Callback receiving the response of an asynchronous download.
  *
+ * \param [in] status
+ *   Status of the request.
  * \param [in] http_response
- *   Pointer to a \link nekos_http_response nekos_http_response \endlink to free.
+ *   Pointer to the response if the status is ::NEKOS_OK, NULL otherwise.
+ *   The callback owns the response and must free it with \link nekos_free_http_response nekos_free_http_response \endlink.
+ * \param [in] userdata
+ *   User pointer passed when starting the request.
  */
-void nekos_free_http_response(const nekos_http_response* http_response);
+typedef void (*nekos_response_callback)(nekos_status status, nekos_http_response *http_response, void *userdata);
 
-#else // NEKOSBEST_IMPL
-
-static size_t nekos_write_callback(const void *ptr, size_t count, size_t nmemb, nekos_http_response *http_response) {
-    size_t size = count * nmemb;
-    size_t new_len = http_response->len + size;
-
-    // resize response text
-    char* new_text = (char*) realloc(http_response->text, new_len + 1);
-    if (!new_text) {
-        free(http_response->text);
-        return CURLE_ABORTED_BY_CALLBACK;
-    }
+/**
+ * Callback asking the event loop to watch a socket.
+ *
+ * \param [in] socket
+ *   Socket to watch.
+ * \param [in] what
+ *   `CURL_POLL_IN`, `CURL_POLL_OUT`, `CURL_POLL_INOUT` to watch the socket for these events, or `CURL_POLL_REMOVE` to stop watching it.
+ * \param [in] userdata
+ *   User pointer of the \link nekos_async nekos_async \endlink.
+ */
+typedef void (*nekos_socket_callback)(curl_socket_t socket, int what, void *userdata);
 
-    // copy new data to response text
-    memcpy(new_text + http_response->len, ptr, size);
-    http_response->text = new_text;
-    http_response->len = new_len;
-    return size;
-}
+/**
+ * Callback asking the event loop to (re)arm its timer.
+ *
+ * \param [in] timeout_ms
+ *   Milliseconds after which \link nekos_async_socket_action nekos_async_socket_action \endlink must be called with
+ *   `CURL_SOCKET_TIMEOUT`, or -1 to disarm the timer.
+ * \param [in] userdata
+ *   User pointer of the \link nekos_async nekos_async \endlink.
+ */
+typedef void (*nekos_timer_callback)(long timeout_ms, void *userdata);
 
-static nekos_status nekos_do_request(nekos_http_response *http_response, const char* url) {
-    // initialize http response object
-    http_response->len = 0;
-    http_response->text = (char*) malloc(1);
-    if (!http_response->text)
-        return NEKOS_MEM_ERR;
+/// Handle of an in-flight asynchronous request.
+typedef struct nekos_async_request nekos_async_request;
 
-    // initialize curl
-    CURL *curl = curl_easy_init();
-    if (!curl)
-        return NEKOS_LIBCURL_ERR;
+/**
+ * Struct for an asynchronous request context.
+ *
+ * The context never blocks. It tells the event loop which sockets and timeouts to watch
+ * through its callbacks, and the event loop reports readiness back with
+ * \link nekos_async_socket_action nekos_async_socket_action \endlink.
+ * Completion callbacks are only ever called from within that function.
+ *
+ * A context must not be used by more than one thread at a time.
+ */
+typedef struct {
+    CURLM *multi; ///< [in] libcurl multi handle driving all requests.
+    int flags; ///< [in] Bitmask of \link nekos_client_flag nekos_client_flag \endlink applied to requests and parsed results, 0 after initialization.
+    nekos_socket_callback socket_callback; ///< [in] Callback for socket changes.
+    nekos_timer_callback timer_callback; ///< [in] Callback for timer changes.
+    void *userdata; ///< [in] User pointer passed to the socket and timer callbacks.
+    nekos_async_request *requests; ///< [out] Linked list of in-flight requests.
+    size_t in_flight; ///< [out] Amount of in-flight requests.
+    nekos_stats stats; ///< [out] Cumulative statistics of requests completed on this context.
+    nekos_share *share; ///< [in] State shared with clients, NULL after initialization.
+    nekos_request_policy policy; ///< [in] Timeouts of requests, all 0 after initialization. Retries and hedging are not supported and ignored.
+} nekos_async;
 
-    // configure curl request
-    curl_easy_setopt(curl, CURLOPT_URL, url);
-    curl_easy_setopt(curl, CURLOPT_CA_CACHE_TIMEOUT, 604800L);
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, nekos_write_callback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, http_response);
+#ifndef _WIN32
 
-    // make request
-    CURLcode res = curl_easy_perform(curl);
-    if (res != CURLE_OK)
-        return NEKOS_LIBCURL_ERR;
+/// Struct for a prefetched result.
+typedef struct {
+    nekos_result result; ///< [out] Prefetched result, must be freed with \link nekos_free_result nekos_free_result \endlink.
+    nekos_http_response image; ///< [out] Prefetched image, empty if images are not prefetched. Must be freed with \link nekos_free_http_response nekos_free_http_response \endlink.
+} nekos_prefetched;
 
-    // cleanup curl
-    curl_easy_cleanup(curl);
-    return NEKOS_OK;
-}
+/**
+ * Struct for a background prefetcher of a category.
+ *
+ * A prefetcher keeps a ring buffer of ready results for one endpoint/category.
+ * A background thread with its own \link nekos_client nekos_client \endlink refills it
+ * in batches of up to \link NEKOS_MAX_AMOUNT \endlink once it falls below the low-water mark.
+ *
+ * All fields are managed by the prefetcher and must not be accessed directly.
+ * The prefetcher relies on POSIX threads and is not available on Windows.
+ */
+typedef struct {
+    nekos_client client; ///< Client used by the background thread.
+    nekos_endpoint endpoint; ///< Copy of the endpoint/category to prefetch.
+    int prefetch_images; ///< Whether images are downloaded along with the results.
+    nekos_prefetched *ring; ///< Ring buffer of ready results.
+    size_t capacity; ///< Amount of slots in the ring buffer.
+    size_t head; ///< Index of the oldest ready result.
+    size_t len; ///< Amount of ready results.
+    size_t low_water; ///< Refill threshold.
+    size_t attempts; ///< Amount of completed refill attempts.
+    nekos_status last_status; ///< Status of the last refill attempt.
+    int failed; ///< Whether the last refill attempt failed, refills pause until the next pop.
+    int stop; ///< Whether the background thread should exit.
+    pthread_t thread; ///< Background thread.
+    pthread_mutex_t mutex; ///< Mutex guarding all fields above.
+    pthread_cond_t refill; ///< Signaled when the ring buffer needs a refill.
+    pthread_cond_t ready; ///< Signaled after every refill attempt.
+} nekos_prefetcher;
 
-static char* nekos_jsondup(const cJSON *json, const char* key) {
-    const cJSON *element = cJSON_GetObjectItemCaseSensitive(json, key);
-    char* str = (char*) malloc(strlen(element->valuestring) + 1);
-    strcpy(str, element->valuestring);
-    return str;
-}
+/// Queued image of a \link nekos_thumbnailer nekos_thumbnailer \endlink.
+typedef struct nekos_thumbnail_job nekos_thumbnail_job;
 
-nekos_status nekos_endpoints(nekos_endpoint_list* endpoints) {
-    // make request
-    nekos_http_response http_response;
-    nekos_status http_status = nekos_do_request(&http_response, NEKOS_BASE_URL "endpoints");
-    if (http_status != NEKOS_OK)
-        return http_status;
+/**
+ * Struct for a pipeline downloading, decoding and downscaling images.
+ *
+ * A download thread with its own \link nekos_client nekos_client \endlink fetches queued urls in parallel batches,
+ * while a pool of worker threads decodes the downloaded images and downscales them to every thumbnail size,
+ * so downloads and decoding overlap.
+ *
+ * All fields are managed by the thumbnailer and must not be accessed directly.
+ * The thumbnailer relies on POSIX threads and is not available on Windows.
+ */
+typedef struct {
+    nekos_client client; ///< Client used by the download thread.
+    nekos_decoder decoder; ///< Decoder used by the worker threads.
+    nekos_thumbnail_size *sizes; ///< Copy of the thumbnail sizes.
+    size_t size_count; ///< Amount of thumbnail sizes.
+    pthread_t downloader; ///< Download thread.
+    pthread_t *workers; ///< Worker threads.
+    size_t worker_count; ///< Amount of worker threads.
+    nekos_thumbnail_job *downloads; ///< Queue of images waiting for their download.
+    nekos_thumbnail_job *downloads_tail; ///< Last image waiting for its download.
+    nekos_thumbnail_job *decodes; ///< Queue of downloaded images waiting for a worker.
+    nekos_thumbnail_job *decodes_tail; ///< Last downloaded image waiting for a worker.
+    size_t decode_len; ///< Amount of downloaded images waiting for a worker.
+    size_t pending; ///< Amount of submitted images whose callback has not returned yet.
+    int stop; ///< Whether the threads should exit.
+    pthread_mutex_t mutex; ///< Mutex guarding all fields above.
+    pthread_cond_t work; ///< Signaled when an image is queued, a worker takes one or the threads should exit.
+    pthread_cond_t done; ///< Signaled when the callback of an image has returned.
+} nekos_thumbnailer;
 
-    // parse response
-    cJSON *json = cJSON_ParseWithLength(http_response.text, http_response.len);
-    if (!json || !cJSON_IsObject(json))
-        return NEKOS_CJSON_ERR;
+#endif // _WIN32
 
-    // parse json
-    endpoints->len = cJSON_GetArraySize(json);
-    endpoints->endpoints = (nekos_endpoint*) malloc(endpoints->len * sizeof(nekos_endpoint));
+/// Magic bytes at the start of a snapshot.
+#define NEKOS_SNAPSHOT_MAGIC "nekosnap"
+/// Version of the snapshot format.
+#define NEKOS_SNAPSHOT_VERSION 1
 
-    // iterate through endpoints
-    const cJSON *endpoint_obj;
-    size_t i = 0;
-    cJSON_ArrayForEach(endpoint_obj, json) {
-        char* name = endpoint_obj->string;
-        endpoints->endpoints[i].name = (char*) malloc(strlen(name) + 1);
-        strcpy(endpoints->endpoints[i].name, name);
+/**
+ * Struct for a read-only snapshot of endpoint and result lists.
+ *
+ * A snapshot is a single block without pointers, so it can be mapped at any address by any number of processes.
+ * All integers are 32-bit in native byte order and all offsets are relative to the start of the block:
+ * - a header of the magic bytes followed by the version, the total size, the endpoint count and offset, and the list count and offset
+ * - a table of endpoints, each a name offset and a format
+ * - a table of result lists, each a result count and the offset of its results
+ * - the results of all lists, each a format, an url offset and three source offsets
+ *   (the anime name for gifs; the artist name, artist href and source url for pngs)
+ * - the nullterminated strings, an offset of 0 marks a missing string
+ * - a final 0 byte, so no string can run past the end
+ *
+ * Use the `nekos_snapshot_*` accessor functions instead of reading the block directly.
+ */
+typedef struct {
+    const char *data; ///< [out] Start of the snapshot.
+    size_t len; ///< [out] Size of the snapshot in bytes.
+    int mapped; ///< [out] Whether the snapshot was mapped by \link nekos_snapshot_open nekos_snapshot_open \endlink.
+} nekos_snapshot;
 
-        const cJSON *format_obj = cJSON_GetObjectItemCaseSensitive(endpoint_obj, "format");
-        endpoints->endpoints[i].format = strcmp(format_obj->valuestring, "png") == 0 ? NEKOS_PNG : NEKOS_GIF;
+/// Struct for an endpoint/category read from a snapshot, pointing into the snapshot.
+typedef struct {
+    const char *name; ///< [out] Name of the endpoint/category.
+    nekos_format format; ///< [out] Format of the endpoint/category.
+} nekos_snapshot_endpoint;
 
-        i++;
-    }
+/// Struct for a result image read from a snapshot, pointing into the snapshot.
+typedef struct {
+    nekos_format format; ///< [out] Format of the image.
+    const char *url; ///< [out] URL to the image.
+    const char *anime_name; ///< [out] Name of the anime the gif is from, NULL for pngs.
+    const char *artist_name; ///< [out] Name of the artist of the png, NULL for gifs.
+    const char *artist_href; ///< [out] URL to the artist's page, NULL for gifs.
+    const char *source_url; ///< [out] URL to the source of the png, NULL for gifs.
+} nekos_snapshot_result;
 
-    // cleanup
-    cJSON_Delete(json);
-    free(http_response.text);
-    return NEKOS_OK;
-}
+/**
+ * Set custom memory allocation functions.
+ *
+ * This function must be called before any other function of this library,
+ * memory allocated with one set of hooks must not be freed with another.
+ *
+ * \param [in] hooks
+ *   Pointer to a \link nekos_hooks nekos_hooks \endlink with the functions to use, NULL to restore the defaults.
+ */
+void nekos_init_hooks(const nekos_hooks *hooks);
 
-nekos_endpoint* nekos_find_endpoint(const nekos_endpoint_list* endpoints, const char* name) {
-    for (size_t i = 0; i < endpoints->len; i++) {
-        if (strcmp(endpoints->endpoints[i].name, name) == 0)
-            return &endpoints->endpoints[i];
-    }
+/**
+ * Initialize the library globally.
+ *
+ * This function initializes libcurl. It is not thread-safe and must be called once
+ * before any other thread uses the library. Without it, libcurl initializes itself
+ * lazily on first use, which is only safe in single-threaded programs.
+ *
+ * \return
+ *   ::NEKOS_OK \n
+ *   ::NEKOS_LIBCURL_ERR
+ */
+nekos_status nekos_global_init(void);
 
-    return NULL;
-}
+/**
+ * Clean up the library globally.
+ *
+ * This function frees the default client of the calling thread and cleans up libcurl.
+ * It is not thread-safe and must be called after all other threads stopped using the library.
+ */
+void nekos_global_cleanup(void);
+
+/**
+ * Initialize state shared between clients.
+ *
+ * This function creates a share for the DNS cache, TLS sessions and open connections.
+ * Point the `share` field of a \link nekos_client nekos_client \endlink or \link nekos_async nekos_async \endlink
+ * to it to use it.
+ *
+ * \param [out] share
+ *   Pointer to a \link nekos_share nekos_share \endlink to initialize.
+ *
+ * \return
+ *   ::NEKOS_OK \n
+ *   ::NEKOS_LIBCURL_ERR
+ */
+nekos_status nekos_share_init(nekos_share *share);
+
+/**
+ * Initialize an in-memory cache of search results.
+ *
+ * Point the `search_cache` field of a \link nekos_client nekos_client \endlink to it to use it.
+ * The cache must be freed with \link nekos_free_search_cache nekos_free_search_cache \endlink.
+ *
+ * \param [out] cache
+ *   Pointer to a \link nekos_search_cache nekos_search_cache \endlink to initialize.
+ * \param [in] capacity
+ *   Maximum amount of cached searches. Must be at least 1.
+ * \param [in] ttl_ms
+ *   Milliseconds a search is served from the cache.
+ *
+ * \return
+ *   ::NEKOS_OK \n
+ *   ::NEKOS_MEM_ERR \n
+ *   ::NEKOS_INVALID_PARAM_ERR
+ */
+nekos_status nekos_search_cache_init(nekos_search_cache *cache, size_t capacity, long ttl_ms);
+
+/**
+ * Initialize a filter of seen result urls.
+ *
+ * The filter is sized so that its false-positive rate stays at or below `false_positive_rate`
+ * until `capacity` urls have been added. It must be freed with \link nekos_free_seen_filter nekos_free_seen_filter \endlink.
+ *
+ * \param [out] filter
+ *   Pointer to a \link nekos_seen_filter nekos_seen_filter \endlink to initialize.
+ * \param [in] capacity
+ *   Amount of urls the filter is sized for. Must be at least 1.
+ * \param [in] false_positive_rate
+ *   Target rate of urls wrongly reported as seen. Must be between 0 and 1, exclusive.
+ *
+ * \return
+ *   ::NEKOS_OK \n
+ *   ::NEKOS_MEM_ERR \n
+ *   ::NEKOS_INVALID_PARAM_ERR
+ */
+nekos_status nekos_seen_filter_init(nekos_seen_filter *filter, size_t capacity, double false_positive_rate);
+
+/**
+ * Add a url to a filter of seen result urls.
+ *
+ * \param [in] filter
+ *   Pointer to a \link nekos_seen_filter nekos_seen_filter \endlink to add the url to.
+ * \param [in] url
+ *   URL of the result.
+ */
+void nekos_seen_filter_add(nekos_seen_filter *filter, const char* url);
+
+/**
+ * Check if a url was added to a filter of seen result urls.
+ *
+ * \param [in] filter
+ *   Pointer to a \link nekos_seen_filter nekos_seen_filter \endlink to check.
+ * \param [in] url
+ *   URL of the result.
+ *
+ * \return
+ *   0 if the url was not added, 1 if it was added or is a false positive.
+ */
+int nekos_seen_filter_contains(const nekos_seen_filter *filter, const char* url);
+
+/**
+ * Get the memory footprint of a filter of seen result urls.
+ *
+ * \param [in] filter
+ *   Pointer to a \link nekos_seen_filter nekos_seen_filter \endlink.
+ *
+ * \return
+ *   Bytes allocated for the bit array of the filter.
+ */
+size_t nekos_seen_filter_memory(const nekos_seen_filter *filter);
+
+/**
+ * Estimate the current false-positive rate of a filter of seen result urls.
+ *
+ * The estimate is the chance that all bits checked for an unseen url are set, from the share of bits set so far.
+ *
+ * \param [in] filter
+ *   Pointer to a \link nekos_seen_filter nekos_seen_filter \endlink.
+ *
+ * \return
+ *   Rate of unseen urls reported as seen, between 0 and 1.
+ */
+double nekos_seen_filter_false_positive_rate(const nekos_seen_filter *filter);
+
+/**
+ * Initialize a rate limiter.
+ *
+ * Point the `rate_limiter` field of a \link nekos_client nekos_client \endlink to it to use it.
+ * It applies to endpoint, category and search requests and single downloads.
+ * The rate limiter must be freed with \link nekos_free_rate_limiter nekos_free_rate_limiter \endlink.
+ *
+ * \param [out] limiter
+ *   Pointer to a \link nekos_rate_limiter nekos_rate_limiter \endlink to initialize.
+ * \param [in] rate
+ *   Requests per second. Must be greater than 0.
+ * \param [in] burst
+ *   Maximum amount of requests made without waiting. Must be at least 1.
+ *
+ * \return
+ *   ::NEKOS_OK \n
+ *   ::NEKOS_INVALID_PARAM_ERR
+ */
+nekos_status nekos_rate_limiter_init(nekos_rate_limiter *limiter, double rate, double burst);
+
+/**
+ * Get the amount of requests waiting for a rate limiter.
+ *
+ * \param [in] limiter
+ *   Pointer to a \link nekos_rate_limiter nekos_rate_limiter \endlink to query.
+ *
+ * \return
+ *   Amount of requests currently waiting for a token.
+ */
+size_t nekos_rate_limiter_queued(nekos_rate_limiter *limiter);
+
+/**
+ * Initialize a client.
+ *
+ * This function creates the libcurl handle owned by the client.
+ * The client must be freed with \link nekos_free_client nekos_free_client \endlink.
+ *
+ * \param [out] client
+ *   Pointer to a \link nekos_client nekos_client \endlink to initialize.
+ *
+ * \return
+ *   ::NEKOS_OK \n
+ *   ::NEKOS_LIBCURL_ERR
+ */
+nekos_status nekos_client_init(nekos_client *client);
+
+/**
+ * Get the default client.
+ *
+ * This function returns the client used by the functions that do not take a client.
+ * Each thread has its own default client, created on first use and freed when the thread exits.
+ * The default client of the thread calling \link nekos_global_cleanup nekos_global_cleanup \endlink is freed there.
+ *
+ * The returned client must not be passed to another thread.
+ *
+ * \return
+ *   Pointer to the default client, NULL if it could not be initialized.
+ */
+nekos_client* nekos_default_client(void);
+
+/**
+ * Get a list of endpoints/categories using a client.
+ *
+ * See \link nekos_endpoints nekos_endpoints \endlink.
+ *
+ * \param [in] client
+ *   Pointer to a \link nekos_client nekos_client \endlink to make the request with.
+ * \param [out] endpoints
+ *   Pointer to a \link nekos_endpoint_list nekos_endpoint_list \endlink to store the endpoints in.
+ *
+ * \return
+ *   ::NEKOS_OK \n
+ *   ::NEKOS_MEM_ERR \n
+ *   ::NEKOS_LIBCURL_ERR \n
+ *   ::NEKOS_CJSON_ERR \n
+ *   ::NEKOS_RATE_LIMIT_ERR
+ */
+nekos_status nekos_client_endpoints(nekos_client *client, nekos_endpoint_list* endpoints);
+
+/**
+ * Get a list of endpoints/categories through a cache file using a client.
+ *
+ * See \link nekos_endpoints_cached nekos_endpoints_cached \endlink.
+ *
+ * \param [in] client
+ *   Pointer to a \link nekos_client nekos_client \endlink to make the request with.
+ * \param [out] endpoints
+ *   Pointer to a \link nekos_endpoint_list nekos_endpoint_list \endlink to store the endpoints in.
+ * \param [in] cache_path
+ *   Path of the cache file. It is created if it does not exist.
+ * \param [in] ttl
+ *   Amount of seconds the cache is used without revalidation.
+ *
+ * \return
+ *   ::NEKOS_OK \n
+ *   ::NEKOS_MEM_ERR \n
+ *   ::NEKOS_LIBCURL_ERR \n
+ *   ::NEKOS_CJSON_ERR \n
+ *   ::NEKOS_RATE_LIMIT_ERR
+ */
+nekos_status nekos_client_endpoints_cached(nekos_client *client, nekos_endpoint_list* endpoints, const char* cache_path, long ttl);
+
+/**
+ * Get a list of images from a category using a client.
+ *
+ * See \link nekos_category nekos_category \endlink.
+ *
+ * \param [in] client
+ *   Pointer to a \link nekos_client nekos_client \endlink to make the request with.
+ * \param [out] results
+ *   Pointer to a \link nekos_result_list nekos_result_list \endlink to store the results in.
+ * \param [in] endpoint
+ *   Pointer to a \link nekos_endpoint nekos_endpoint \endlink to specify the category.
+ * \param [in] amount
+ *   Amount of images to fetch. Must be between 1 and \link NEKOS_MAX_AMOUNT \endlink.
+ *
+ * \return
+ *   ::NEKOS_OK \n
+ *   ::NEKOS_MEM_ERR \n
+ *   ::NEKOS_LIBCURL_ERR \n
+ *   ::NEKOS_CJSON_ERR \n
+ *   ::NEKOS_INVALID_PARAM_ERR \n
+ *   ::NEKOS_RATE_LIMIT_ERR
+ */
+nekos_status nekos_client_category(nekos_client *client, nekos_result_list *results, const nekos_endpoint *endpoint, int amount);
+
+/**
+ * Get a list of unseen images from a category using a client.
+ *
+ * See \link nekos_category_unique nekos_category_unique \endlink.
+ *
+ * \param [in] client
+ *   Pointer to a \link nekos_client nekos_client \endlink to make the requests with.
+ * \param [out] results
+ *   Pointer to a \link nekos_result_list nekos_result_list \endlink to store the results in.
+ * \param [in] endpoint
+ *   Pointer to a \link nekos_endpoint nekos_endpoint \endlink to specify the category.
+ * \param [in] amount
+ *   Amount of images to fetch. Must be between 1 and \link NEKOS_MAX_AMOUNT \endlink.
+ * \param [in] filter
+ *   Pointer to the \link nekos_seen_filter nekos_seen_filter \endlink of urls already seen.
+ *
+ * \return
+ *   ::NEKOS_OK \n
+ *   ::NEKOS_MEM_ERR \n
+ *   ::NEKOS_LIBCURL_ERR \n
+ *   ::NEKOS_CJSON_ERR \n
+ *   ::NEKOS_INVALID_PARAM_ERR \n
+ *   ::NEKOS_EMPTY_ERR \n
+ *   ::NEKOS_RATE_LIMIT_ERR
+ */
+nekos_status nekos_client_category_unique(nekos_client *client, nekos_result_list *results, const nekos_endpoint *endpoint, int amount, nekos_seen_filter *filter);
+
+/**
+ * Search for images using a client.
+ *
+ * See \link nekos_search nekos_search \endlink.
+ *
+ * If the client has a `search_cache`, a cached search is copied into `results` without any network io or parsing.
+ * Such a list is a single block (see `arena`) and has a zeroed `timing`.
+ *
+ * \param [in] client
+ *   Pointer to a \link nekos_client nekos_client \endlink to make the request with.
+ * \param [out] results
+ *   Pointer to a \link nekos_result_list nekos_result_list \endlink to store the results in.
+ * \param [in] raw_query
+ *   Query to search for. Must be between \link NEKOS_MIN_QUERY_LEN \endlink and \link NEKOS_MAX_QUERY_LEN \endlink.
+ * \param [in] amount
+ *   Amount of images to fetch. Must be between 1 and \link NEKOS_MAX_AMOUNT \endlink.
+ * \param [in] format
+ *   Format of the images to search for.
+ * \param [in] endpoint
+ *   Pointer to a \link nekos_endpoint nekos_endpoint \endlink to specify a category. Can be NULL.
+ *
+ * \return
+ *   ::NEKOS_OK \n
+ *   ::NEKOS_MEM_ERR \n
+ *   ::NEKOS_LIBCURL_ERR \n
+ *   ::NEKOS_CJSON_ERR \n
+ *   ::NEKOS_INVALID_PARAM_ERR \n
+ *   ::NEKOS_RATE_LIMIT_ERR
+ */
+nekos_status nekos_client_search(nekos_client *client, nekos_result_list *results, const char* raw_query, int amount, const nekos_format format, const nekos_endpoint *endpoint);
+
+/**
+ * Download an image using a client.
+ *
+ * See \link nekos_download nekos_download \endlink.
+ *
+ * \param [in] client
+ *   Pointer to a \link nekos_client nekos_client \endlink to make the request with.
+ * \param [out] http_response
+ *   Pointer to a \link nekos_http_response nekos_http_response \endlink to store the response in.
+ * \param [in] url
+ *   URL of the image to download.
+ *
+ * \return
+ *   ::NEKOS_OK \n
+ *   ::NEKOS_MEM_ERR \n
+ *   ::NEKOS_LIBCURL_ERR \n
+ *   ::NEKOS_RATE_LIMIT_ERR
+ */
+nekos_status nekos_client_download(nekos_client *client, nekos_http_response *http_response, const char* url);
+
+/**
+ * Download multiple images in parallel using a client.
+ *
+ * See \link nekos_download_many nekos_download_many \endlink.
+ *
+ * \param [in] client
+ *   Pointer to a \link nekos_client nekos_client \endlink to make the requests with.
+ * \param [out] http_responses
+ *   Array of `n` \link nekos_http_response nekos_http_response \endlink to store the responses in.
+ * \param [out] statuses
+ *   Array of `n` \link nekos_status nekos_status \endlink to store the status of each download in.
+ * \param [in] urls
+ *   Array of `n` URLs of the images to download.
+ * \param [in] n
+ *   Amount of images to download.
+ * \param [in] max_parallel
+ *   Maximum amount of simultaneous transfers, 0 for no limit.
+ *
+ * \return
+ *   ::NEKOS_OK if all downloads succeeded, otherwise the status of the first failed download \n
+ *   ::NEKOS_MEM_ERR \n
+ *   ::NEKOS_LIBCURL_ERR \n
+ *   ::NEKOS_INVALID_PARAM_ERR
+ */
+nekos_status nekos_client_download_many(nekos_client *client, nekos_http_response *http_responses, nekos_status *statuses, const char **urls, size_t n, int max_parallel);
+
+/**
+ * Download an image in parallel byte ranges using a client.
+ *
+ * See \link nekos_download_ranged nekos_download_ranged \endlink.
+ *
+ * \param [in] client
+ *   Pointer to a \link nekos_client nekos_client \endlink to make the requests with.
+ * \param [out] http_response
+ *   Pointer to a \link nekos_http_response nekos_http_response \endlink to store the response in.
+ * \param [in] url
+ *   URL of the image to download.
+ * \param [in] chunk_size
+ *   Size of each byte range, 0 for \link NEKOS_DEFAULT_CHUNK_SIZE \endlink.
+ * \param [in] max_parallel
+ *   Maximum amount of simultaneous ranges, 0 for no limit.
+ *
+ * \return
+ *   ::NEKOS_OK \n
+ *   ::NEKOS_MEM_ERR \n
+ *   ::NEKOS_LIBCURL_ERR \n
+ *   ::NEKOS_INVALID_PARAM_ERR
+ */
+nekos_status nekos_client_download_ranged(nekos_client *client, nekos_http_response *http_response, const char* url, size_t chunk_size, int max_parallel);
+
+/**
+ * Download an image into a caller-owned buffer using a client.
+ *
+ * See \link nekos_download_into nekos_download_into \endlink.
+ *
+ * \param [in] client
+ *   Pointer to a \link nekos_client nekos_client \endlink to make the request with.
+ * \param [out] http_response
+ *   Pointer to a \link nekos_http_response nekos_http_response \endlink to store the response in.
+ * \param [in] buffer
+ *   Caller-owned buffer to store the response text in.
+ * \param [in] capacity
+ *   Size of the buffer in bytes.
+ * \param [in] url
+ *   URL of the image to download.
+ *
+ * \return
+ *   ::NEKOS_OK \n
+ *   ::NEKOS_LIBCURL_ERR \n
+ *   ::NEKOS_RATE_LIMIT_ERR \n
+ *   ::NEKOS_BUFFER_ERR
+ */
+nekos_status nekos_client_download_into(nekos_client *client, nekos_http_response *http_response, char *buffer, size_t capacity, const char* url);
+
+/**
+ * Stream an image to a sink using a client.
+ *
+ * See \link nekos_download_to nekos_download_to \endlink.
+ *
+ * \param [in] client
+ *   Pointer to a \link nekos_client nekos_client \endlink to make the request with.
+ * \param [in] sink
+ *   Pointer to a \link nekos_sink nekos_sink \endlink to write the response to.
+ * \param [in] url
+ *   URL of the image to download.
+ *
+ * \return
+ *   ::NEKOS_OK \n
+ *   ::NEKOS_LIBCURL_ERR \n
+ *   ::NEKOS_RATE_LIMIT_ERR \n
+ *   ::NEKOS_IO_ERR
+ */
+nekos_status nekos_client_download_to(nekos_client *client, const nekos_sink *sink, const char* url);
+
+/**
+ * Read the metadata of an image using a client.
+ *
+ * See \link nekos_probe nekos_probe \endlink.
+ *
+ * \param [in] client
+ *   Pointer to a \link nekos_client nekos_client \endlink to make the request with.
+ * \param [out] info
+ *   Pointer to a \link nekos_image_info nekos_image_info \endlink to store the metadata in.
+ * \param [in] result
+ *   Pointer to the \link nekos_result nekos_result \endlink to probe.
+ * \param [in] count_frames
+ *   Whether to count the frames of a gif, which reads the whole image.
+ *
+ * \return
+ *   ::NEKOS_OK \n
+ *   ::NEKOS_LIBCURL_ERR \n
+ *   ::NEKOS_INVALID_PARAM_ERR \n
+ *   ::NEKOS_FORMAT_ERR
+ */
+nekos_status nekos_client_probe(nekos_client *client, nekos_image_info *info, const nekos_result *result, int count_frames);
+
+/**
+ * Get a snapshot of the statistics of a client.
+ *
+ * \param [in] client
+ *   Pointer to the \link nekos_client nekos_client \endlink to get the statistics of.
+ * \param [out] stats
+ *   Pointer to a \link nekos_stats nekos_stats \endlink to copy the statistics to.
+ */
+void nekos_client_get_stats(const nekos_client *client, nekos_stats *stats);
+
+/**
+ * Get a snapshot of the statistics of the calling thread's default client.
+ *
+ * \param [out] stats
+ *   Pointer to a \link nekos_stats nekos_stats \endlink to copy the statistics to.
+ *
+ * \return
+ *   ::NEKOS_OK \n
+ *   ::NEKOS_LIBCURL_ERR
+ */
+nekos_status nekos_get_stats(nekos_stats *stats);
+
+/**
+ * Reset the statistics of a client.
+ *
+ * \param [in] client
+ *   Pointer to the \link nekos_client nekos_client \endlink to reset the statistics of.
+ */
+void nekos_client_reset_stats(nekos_client *client);
+
+/**
+ * Estimate a latency percentile from a histogram.
+ *
+ * \param [in] stats
+ *   Pointer to the \link nekos_call_stats nekos_call_stats \endlink to read the histogram of.
+ * \param [in] percentile
+ *   Percentile to estimate, between 0 and 100.
+ *
+ * \return
+ *   Upper bound of the histogram bucket containing the percentile in microseconds, 0 if no requests were made.
+ */
+unsigned long long nekos_stats_percentile(const nekos_call_stats *stats, double percentile);
+
+/**
+ * Initialize an asynchronous request context.
+ *
+ * \param [out] async
+ *   Pointer to a \link nekos_async nekos_async \endlink to initialize.
+ * \param [in] socket_callback
+ *   Callback asking the event loop to watch sockets.
+ * \param [in] timer_callback
+ *   Callback asking the event loop to arm its timer.
+ * \param [in] userdata
+ *   User pointer passed to both callbacks.
+ *
+ * \return
+ *   ::NEKOS_OK \n
+ *   ::NEKOS_LIBCURL_ERR
+ */
+nekos_status nekos_async_init(nekos_async *async, nekos_socket_callback socket_callback, nekos_timer_callback timer_callback, void *userdata);
+
+/**
+ * Start fetching images from a category asynchronously.
+ *
+ * See \link nekos_category nekos_category \endlink. The request is started once the event loop
+ * reacts to the timer set through the timer callback.
+ *
+ * \param [in] async
+ *   Pointer to a \link nekos_async nekos_async \endlink to run the request on.
+ * \param [out] request
+ *   Pointer to store the request handle in, can be NULL. The handle is valid until the completion callback returns.
+ * \param [in] endpoint
+ *   Pointer to a \link nekos_endpoint nekos_endpoint \endlink to specify the category.
+ * \param [in] amount
+ *   Amount of images to fetch. Must be between 1 and \link NEKOS_MAX_AMOUNT \endlink.
+ * \param [in] callback
+ *   Callback receiving the results.
+ * \param [in] userdata
+ *   User pointer passed to the callback.
+ *
+ * \return
+ *   ::NEKOS_OK \n
+ *   ::NEKOS_MEM_ERR \n
+ *   ::NEKOS_LIBCURL_ERR \n
+ *   ::NEKOS_INVALID_PARAM_ERR
+ */
+nekos_status nekos_async_category(nekos_async *async, nekos_async_request **request, const nekos_endpoint *endpoint, int amount, nekos_results_callback callback, void *userdata);
+
+/**
+ * Start searching for images asynchronously.
+ *
+ * See \link nekos_search nekos_search \endlink.
+ *
+ * \param [in] async
+ *   Pointer to a \link nekos_async nekos_async \endlink to run the request on.
+ * \param [out] request
+ *   Pointer to store the request handle in, can be NULL. The handle is valid until the completion callback returns.
+ * \param [in] raw_query
+ *   Query to search for. Must be between \link NEKOS_MIN_QUERY_LEN \endlink and \link NEKOS_MAX_QUERY_LEN \endlink.
+ * \param [in] amount
+ *   Amount of images to fetch. Must be between 1 and \link NEKOS_MAX_AMOUNT \endlink.
+ * \param [in] format
+ *   Format of the images to search for.
+ * \param [in] endpoint
+ *   Pointer to a \link nekos_endpoint nekos_endpoint \endlink to specify a category. Can be NULL.
+ * \param [in] callback
+ *   Callback receiving the results.
+ * \param [in] userdata
+ *   User pointer passed to the callback.
+ *
+ * \return
+ *   ::NEKOS_OK \n
+ *   ::NEKOS_MEM_ERR \n
+ *   ::NEKOS_LIBCURL_ERR \n
+ *   ::NEKOS_INVALID_PARAM_ERR
+ */
+nekos_status nekos_async_search(nekos_async *async, nekos_async_request **request, const char* raw_query, int amount, const nekos_format format, const nekos_endpoint *endpoint, nekos_results_callback callback, void *userdata);
+
+/**
+ * Start downloading an image asynchronously.
+ *
+ * See \link nekos_download nekos_download \endlink.
+ *
+ * \param [in] async
+ *   Pointer to a \link nekos_async nekos_async \endlink to run the request on.
+ * \param [out] request
+ *   Pointer to store the request handle in, can be NULL. The handle is valid until the completion callback returns.
+ * \param [in] url
+ *   URL of the image to download.
+ * \param [in] callback
+ *   Callback receiving the response.
+ * \param [in] userdata
+ *   User pointer passed to the callback.
+ *
+ * \return
+ *   ::NEKOS_OK \n
+ *   ::NEKOS_MEM_ERR \n
+ *   ::NEKOS_LIBCURL_ERR
+ */
+nekos_status nekos_async_download(nekos_async *async, nekos_async_request **request, const char* url, nekos_response_callback callback, void *userdata);
+
+/**
+ * Drive asynchronous requests.
+ *
+ * This function must be called by the event loop whenever a watched socket is ready,
+ * or with `CURL_SOCKET_TIMEOUT` when the timer expires. Completion callbacks of finished
+ * requests are called from within this function.
+ *
+ * \param [in] async
+ *   Pointer to a \link nekos_async nekos_async \endlink to drive.
+ * \param [in] socket
+ *   Socket that is ready, or `CURL_SOCKET_TIMEOUT`.
+ * \param [in] events
+ *   Bitmask of `CURL_CSELECT_IN`, `CURL_CSELECT_OUT` and `CURL_CSELECT_ERR`, 0 to let libcurl check.
+ *
+ * \return
+ *   ::NEKOS_OK \n
+ *   ::NEKOS_LIBCURL_ERR
+ */
+nekos_status nekos_async_socket_action(nekos_async *async, curl_socket_t socket, int events);
+
+/**
+ * Cancel an asynchronous request.
+ *
+ * This function aborts the request without calling its completion callback.
+ *
+ * \param [in] async
+ *   Pointer to the \link nekos_async nekos_async \endlink running the request.
+ * \param [in] request
+ *   Handle of the request to cancel.
+ */
+void nekos_async_cancel(nekos_async *async, nekos_async_request *request);
+
+/**
+ * Get a list of endpoints/categories.
+ *
+ * This function fetches the `endpoints` endpoint of the api
+ * and parses the response into a list of endpoints.
+ *
+ * It will allocate memory for the list of endpoints and the endpoints themselves.
+ *
+ * \param [out] endpoints
+ *   Pointer to a \link nekos_endpoint_list nekos_endpoint_list \endlink to store the endpoints in.
+ *
+ * \return
+ *   ::NEKOS_OK \n
+ *   ::NEKOS_MEM_ERR \n
+ *   ::NEKOS_LIBCURL_ERR \n
+ *   ::NEKOS_CJSON_ERR \n
+ *   ::NEKOS_RATE_LIMIT_ERR
+ */
+nekos_status nekos_endpoints(nekos_endpoint_list* endpoints);
+
+/**
+ * Get a list of endpoints/categories through a cache file.
+ *
+ * This function behaves like \link nekos_endpoints nekos_endpoints \endlink,
+ * but keeps the `endpoints` response in a cache file between runs.
+ *
+ * A cache younger than `ttl` seconds is used without any network io.
+ * An older cache is revalidated with `If-None-Match`/`If-Modified-Since`,
+ * so an unchanged list only costs a `304 Not Modified` response.
+ * Failing to write the cache file is not an error.
+ *
+ * \param [out] endpoints
+ *   Pointer to a \link nekos_endpoint_list nekos_endpoint_list \endlink to store the endpoints in.
+ * \param [in] cache_path
+ *   Path of the cache file. It is created if it does not exist.
+ * \param [in] ttl
+ *   Amount of seconds the cache is used without revalidation.
+ *
+ * \return
+ *   ::NEKOS_OK \n
+ *   ::NEKOS_MEM_ERR \n
+ *   ::NEKOS_LIBCURL_ERR \n
+ *   ::NEKOS_CJSON_ERR \n
+ *   ::NEKOS_RATE_LIMIT_ERR
+ */
+nekos_status nekos_endpoints_cached(nekos_endpoint_list* endpoints, const char* cache_path, long ttl);
+
+/**
+ * Find a specific endpoint in a list of endpoints/categories.
+ *
+ * This function searches for a specific endpoint in a list of endpoints by name.
+ * The list is searched linearly, use \link nekos_find_indexed_endpoint nekos_find_indexed_endpoint \endlink for repeated lookups.
+ *
+ * \param [in] endpoints
+ *   Pointer to a \link nekos_endpoint_list nekos_endpoint_list \endlink to search in.
+ * \param [in] name
+ *   Name of the endpoint to search for.
+ *
+ * \return
+ *   Pointer to the endpoint if found, NULL otherwise.
+ */
+nekos_endpoint* nekos_find_endpoint(const nekos_endpoint_list* endpoints, const char* name);
+
+/**
+ * Build a hash index for a list of endpoints/categories.
+ *
+ * This function indexes any list, whether it was returned by \link nekos_endpoints nekos_endpoints \endlink or built by hand,
+ * so that \link nekos_find_indexed_endpoint nekos_find_indexed_endpoint \endlink finds endpoints in constant time.
+ *
+ * It will allocate memory for the index, which must be freed with \link nekos_free_endpoint_index nekos_free_endpoint_index \endlink.
+ *
+ * \param [out] index
+ *   Pointer to a \link nekos_endpoint_index nekos_endpoint_index \endlink to store the index in.
+ * \param [in] endpoints
+ *   Pointer to a \link nekos_endpoint_list nekos_endpoint_list \endlink to index.
+ *
+ * \return
+ *   ::NEKOS_OK \n
+ *   ::NEKOS_MEM_ERR
+ */
+nekos_status nekos_index_endpoints(nekos_endpoint_index *index, const nekos_endpoint_list* endpoints);
+
+/**
+ * Find a specific endpoint through a hash index.
+ *
+ * This function looks up an endpoint by name in constant time.
+ *
+ * \param [in] index
+ *   Pointer to a \link nekos_endpoint_index nekos_endpoint_index \endlink to search in.
+ * \param [in] name
+ *   Name of the endpoint to search for.
+ *
+ * \return
+ *   Pointer to the endpoint if found, NULL otherwise.
+ */
+nekos_endpoint* nekos_find_indexed_endpoint(const nekos_endpoint_index *index, const char* name);
+
+/**
+ * Get a list of images from a category.
+ *
+ * This function fetches the specified category endpoint of the api
+ * and parses the response into a list of images.
+ *
+ * It will allocate memory for the list of results, the results themselves, and the source information.
+ *
+ * \param [out] results
+ *   Pointer to a \link nekos_result_list nekos_result_list \endlink to store the results in.
+ * \param [in] endpoint
+ *   Pointer to a \link nekos_endpoint nekos_endpoint \endlink to specify the category.
+ * \param [in] amount
+ *   Amount of images to fetch. Must be between 1 and \link NEKOS_MAX_AMOUNT \endlink.
+ *
+ * \return
+ *   ::NEKOS_OK \n
+ *   ::NEKOS_MEM_ERR \n
+ *   ::NEKOS_LIBCURL_ERR \n
+ *   ::NEKOS_CJSON_ERR \n
+ *   ::NEKOS_INVALID_PARAM_ERR \n
+ *   ::NEKOS_RATE_LIMIT_ERR
+ */
+nekos_status nekos_category(nekos_result_list *results, const nekos_endpoint *endpoint, int amount);
+
+/**
+ * Get a list of unseen images from a category.
+ *
+ * This function fetches full batches of the specified category until it found `amount` images
+ * whose urls are not in the filter, then adds their urls to it. Keep one filter per category
+ * (and per user, if their histories are tracked separately) to skip repeats across calls.
+ *
+ * At most \link NEKOS_UNIQUE_MAX_REQUESTS \endlink requests are made, so fewer images are returned
+ * once the category seems exhausted. If any request fails, nothing is added to the filter.
+ *
+ * The list is allocated in a single block, regardless of the flags of the client.
+ *
+ * \param [out] results
+ *   Pointer to a \link nekos_result_list nekos_result_list \endlink to store the results in.
+ * \param [in] endpoint
+ *   Pointer to a \link nekos_endpoint nekos_endpoint \endlink to specify the category.
+ * \param [in] amount
+ *   Amount of images to fetch. Must be between 1 and \link NEKOS_MAX_AMOUNT \endlink.
+ * \param [in] filter
+ *   Pointer to the \link nekos_seen_filter nekos_seen_filter \endlink of urls already seen.
+ *
+ * \return
+ *   ::NEKOS_OK \n
+ *   ::NEKOS_MEM_ERR \n
+ *   ::NEKOS_LIBCURL_ERR \n
+ *   ::NEKOS_CJSON_ERR \n
+ *   ::NEKOS_INVALID_PARAM_ERR \n
+ *   ::NEKOS_EMPTY_ERR if every image found was already seen \n
+ *   ::NEKOS_RATE_LIMIT_ERR
+ */
+nekos_status nekos_category_unique(nekos_result_list *results, const nekos_endpoint *endpoint, int amount, nekos_seen_filter *filter);
+
+/**
+ * Search for images.
+ *
+ * This function fetches the `search` endpoint of the api
+ * and parses the response into a list of images.
+ *
+ * The search can optionally specify a endpoint/category.
+ *
+ * It will allocate memory for the list of results, the results themselves, and the source information.
+ *
+ * \param [out] results
+ *   Pointer to a \link nekos_result_list nekos_result_list \endlink to store the results in.
+ * \param [in] raw_query
+ *   Query to search for. Must be between \link NEKOS_MIN_QUERY_LEN \endlink and \link NEKOS_MAX_QUERY_LEN \endlink.
+ * \param [in] amount
+ *   Amount of images to fetch. Must be between 1 and \link NEKOS_MAX_AMOUNT \endlink.
+ * \param [in] format
+ *   Format of the images to search for.
+ * \param [in] endpoint
+ *   Pointer to a \link nekos_endpoint nekos_endpoint \endlink to specify a category. Can be NULL.
+ *
+ * \return
+ *   ::NEKOS_OK \n
+ *   ::NEKOS_MEM_ERR \n
+ *   ::NEKOS_LIBCURL_ERR \n
+ *   ::NEKOS_CJSON_ERR \n
+ *   ::NEKOS_INVALID_PARAM_ERR \n
+ *   ::NEKOS_RATE_LIMIT_ERR
+ */
+nekos_status nekos_search(nekos_result_list *results, const char* raw_query, int amount, const nekos_format format, const nekos_endpoint *endpoint);
+
+/**
+ * Download an image.
+ *
+ * This function fetches the specified image url
+ * and stores the response in a \link nekos_http_response nekos_http_response \endlink.
+ *
+ * It will allocate memory for the response text.
+ *
+ * \param [out] http_response
+ *   Pointer to a \link nekos_http_response nekos_http_response \endlink to store the response in.
+ * \param [in] url
+ *   URL of the image to download.
+ *
+ * \return
+ *   ::NEKOS_OK \n
+ *   ::NEKOS_MEM_ERR \n
+ *   ::NEKOS_LIBCURL_ERR \n
+ *   ::NEKOS_RATE_LIMIT_ERR
+ */
+nekos_status nekos_download(nekos_http_response *http_response, const char* url);
+
+/**
+ * Download multiple images in parallel.
+ *
+ * This function fetches all specified image urls simultaneously
+ * and stores each response in a \link nekos_http_response nekos_http_response \endlink.
+ *
+ * It will allocate memory for the text of every successful response.
+ * Every response must be freed with \link nekos_free_http_response nekos_free_http_response \endlink,
+ * failed downloads are left empty and can be freed as well.
+ *
+ * The transfers do not wait for the client's `rate_limiter`, and a 429 response is stored like any other response.
+ *
+ * \param [out] http_responses
+ *   Array of `n` \link nekos_http_response nekos_http_response \endlink to store the responses in.
+ * \param [out] statuses
+ *   Array of `n` \link nekos_status nekos_status \endlink to store the status of each download in.
+ * \param [in] urls
+ *   Array of `n` URLs of the images to download.
+ * \param [in] n
+ *   Amount of images to download.
+ * \param [in] max_parallel
+ *   Maximum amount of simultaneous transfers, 0 for no limit.
+ *
+ * \return
+ *   ::NEKOS_OK if all downloads succeeded, otherwise the status of the first failed download \n
+ *   ::NEKOS_MEM_ERR \n
+ *   ::NEKOS_LIBCURL_ERR \n
+ *   ::NEKOS_INVALID_PARAM_ERR
+ */
+nekos_status nekos_download_many(nekos_http_response *http_responses, nekos_status *statuses, const char **urls, size_t n, int max_parallel);
+
+/**
+ * Download an image in parallel byte ranges.
+ *
+ * This function asks the server for the size of the image and whether it accepts byte ranges.
+ * If it does and the image is larger than `chunk_size`, the image is split into ranges that are fetched
+ * over separate connections, straight into one preallocated buffer at their offsets.
+ * A range that fails is retried from its last received byte. Otherwise the image is downloaded like
+ * \link nekos_download nekos_download \endlink.
+ *
+ * It will allocate memory for the response text, which must be freed with \link nekos_free_http_response nekos_free_http_response \endlink.
+ * Only the total time and size are reported in the timing of a ranged download.
+ *
+ * \param [out] http_response
+ *   Pointer to a \link nekos_http_response nekos_http_response \endlink to store the response in.
+ * \param [in] url
+ *   URL of the image to download.
+ * \param [in] chunk_size
+ *   Size of each byte range, 0 for \link NEKOS_DEFAULT_CHUNK_SIZE \endlink.
+ * \param [in] max_parallel
+ *   Maximum amount of simultaneous ranges, 0 for no limit.
+ *
+ * \return
+ *   ::NEKOS_OK \n
+ *   ::NEKOS_MEM_ERR \n
+ *   ::NEKOS_LIBCURL_ERR \n
+ *   ::NEKOS_INVALID_PARAM_ERR
+ */
+nekos_status nekos_download_ranged(nekos_http_response *http_response, const char* url, size_t chunk_size, int max_parallel);
+
+/**
+ * Download an image into a caller-owned buffer.
+ *
+ * This function fetches the specified image url
+ * and stores the response in the supplied buffer instead of allocating one.
+ *
+ * It does not allocate memory, so the response must not be freed with
+ * \link nekos_free_http_response nekos_free_http_response \endlink.
+ * If the response does not fit, the download is aborted and the response only holds the data received up to that point.
+ *
+ * \param [out] http_response
+ *   Pointer to a \link nekos_http_response nekos_http_response \endlink to store the response in.
+ * \param [in] buffer
+ *   Caller-owned buffer to store the response text in.
+ * \param [in] capacity
+ *   Size of the buffer in bytes.
+ * \param [in] url
+ *   URL of the image to download.
+ *
+ * \return
+ *   ::NEKOS_OK \n
+ *   ::NEKOS_LIBCURL_ERR \n
+ *   ::NEKOS_RATE_LIMIT_ERR \n
+ *   ::NEKOS_BUFFER_ERR
+ */
+nekos_status nekos_download_into(nekos_http_response *http_response, char *buffer, size_t capacity, const char* url);
+
+/**
+ * Stream an image to a sink.
+ *
+ * This function fetches the specified image url
+ * and writes the response to a \link nekos_sink nekos_sink \endlink as it arrives.
+ *
+ * It does not allocate memory for the response, the memory used is bounded by the libcurl buffer size.
+ * If the download fails, the sink may have received part of the response.
+ *
+ * \param [in] sink
+ *   Pointer to a \link nekos_sink nekos_sink \endlink to write the response to.
+ * \param [in] url
+ *   URL of the image to download.
+ *
+ * \return
+ *   ::NEKOS_OK \n
+ *   ::NEKOS_LIBCURL_ERR \n
+ *   ::NEKOS_RATE_LIMIT_ERR \n
+ *   ::NEKOS_IO_ERR
+ */
+nekos_status nekos_download_to(const nekos_sink *sink, const char* url);
+
+/**
+ * Read the metadata of an image.
+ *
+ * This function requests only the first few kilobytes of the image of a result
+ * and reads its format, width and height from the png or gif headers, stopping the transfer as soon as they are known.
+ *
+ * The frames of an animated png are read from its animation chunk.
+ * A gif stores no frame count, so its frames are only counted if `count_frames` is set,
+ * in which case the image is streamed up to its trailer without being buffered.
+ * Otherwise \link nekos_image_info::frames nekos_image_info::frames \endlink is 0 for gifs.
+ *
+ * \param [out] info
+ *   Pointer to a \link nekos_image_info nekos_image_info \endlink to store the metadata in.
+ * \param [in] result
+ *   Pointer to the \link nekos_result nekos_result \endlink to probe.
+ * \param [in] count_frames
+ *   Whether to count the frames of a gif, which reads the whole image.
+ *
+ * \return
+ *   ::NEKOS_OK \n
+ *   ::NEKOS_LIBCURL_ERR \n
+ *   ::NEKOS_INVALID_PARAM_ERR \n
+ *   ::NEKOS_FORMAT_ERR
+ */
+nekos_status nekos_probe(nekos_image_info *info, const nekos_result *result, int count_frames);
+
+#ifndef _WIN32
+
+/**
+ * Initialize a disk cache of images.
+ *
+ * This function scans `dir` once to count the size of the images already cached, trimming them to `max_size`.
+ * The cache must be freed with \link nekos_free_image_cache nekos_free_image_cache \endlink.
+ *
+ * \param [out] cache
+ *   Pointer to a \link nekos_image_cache nekos_image_cache \endlink to initialize.
+ * \param [in] dir
+ *   Existing directory to store cached images in, must outlive the cache.
+ * \param [in] max_size
+ *   Maximum total size of cached images in bytes.
+ *
+ * \return
+ *   ::NEKOS_OK \n
+ *   ::NEKOS_IO_ERR
+ */
+nekos_status nekos_image_cache_init(nekos_image_cache *cache, const char *dir, size_t max_size);
+
+/**
+ * Download an image through a disk cache using a client.
+ *
+ * See \link nekos_download_cached nekos_download_cached \endlink.
+ *
+ * \param [in] client
+ *   Pointer to a \link nekos_client nekos_client \endlink to make the request with.
+ * \param [in] cache
+ *   Pointer to a \link nekos_image_cache nekos_image_cache \endlink to look up and store the image in.
+ * \param [out] http_response
+ *   Pointer to a \link nekos_http_response nekos_http_response \endlink to store the mapped image in.
+ * \param [in] url
+ *   URL of the image to download.
+ *
+ * \return
+ *   ::NEKOS_OK \n
+ *   ::NEKOS_MEM_ERR \n
+ *   ::NEKOS_LIBCURL_ERR \n
+ *   ::NEKOS_IO_ERR
+ */
+nekos_status nekos_client_download_cached(nekos_client *client, nekos_image_cache *cache, nekos_http_response *http_response, const char* url);
+
+/**
+ * Download an image through a disk cache.
+ *
+ * This function maps the cached copy of the image into memory if there is one.
+ * Otherwise it streams the image into the cache, evicts the least recently used images
+ * if the cache grew beyond its maximum size, and maps the new file.
+ * Cache hits only touch the mapped file, and misses only scan the cache directory when they push it over its maximum size.
+ *
+ * The response is always a read-only memory mapping and must be freed with
+ * \link nekos_free_cached_response nekos_free_cached_response \endlink.
+ *
+ * \param [in] cache
+ *   Pointer to a \link nekos_image_cache nekos_image_cache \endlink to look up and store the image in.
+ * \param [out] http_response
+ *   Pointer to a \link nekos_http_response nekos_http_response \endlink to store the mapped image in.
+ * \param [in] url
+ *   URL of the image to download.
+ *
+ * \return
+ *   ::NEKOS_OK \n
+ *   ::NEKOS_MEM_ERR \n
+ *   ::NEKOS_LIBCURL_ERR \n
+ *   ::NEKOS_IO_ERR
+ */
+nekos_status nekos_download_cached(nekos_image_cache *cache, nekos_http_response *http_response, const char* url);
+
+/**
+ * Trim a disk cache of images.
+ *
+ * This function removes the least recently used images until the cache is no larger than its maximum size,
+ * and recounts its size. It is called automatically whenever an added image makes the cache too large.
+ *
+ * \param [in] cache
+ *   Pointer to a \link nekos_image_cache nekos_image_cache \endlink to trim.
+ */
+void nekos_trim_image_cache(nekos_image_cache *cache);
+
+/**
+ * Download an image in parallel byte ranges to a file using a client.
+ *
+ * See \link nekos_download_ranged_file nekos_download_ranged_file \endlink.
+ *
+ * \param [in] client
+ *   Pointer to a \link nekos_client nekos_client \endlink to make the requests with.
+ * \param [in] path
+ *   Path of the file to create.
+ * \param [in] url
+ *   URL of the image to download.
+ * \param [in] chunk_size
+ *   Size of each byte range, 0 for \link NEKOS_DEFAULT_CHUNK_SIZE \endlink.
+ * \param [in] max_parallel
+ *   Maximum amount of simultaneous ranges, 0 for no limit.
+ *
+ * \return
+ *   ::NEKOS_OK \n
+ *   ::NEKOS_MEM_ERR \n
+ *   ::NEKOS_LIBCURL_ERR \n
+ *   ::NEKOS_INVALID_PARAM_ERR \n
+ *   ::NEKOS_IO_ERR
+ */
+nekos_status nekos_client_download_ranged_file(nekos_client *client, const char* path, const char* url, size_t chunk_size, int max_parallel);
+
+/**
+ * Download an image in parallel byte ranges to a file.
+ *
+ * This function works like \link nekos_download_ranged nekos_download_ranged \endlink, but writes the ranges
+ * into a memory mapping of `path` with the suffix `.part`, and records finished ranges in `path` with the suffix `.ranges`.
+ * The partial file is renamed to `path` once complete. If the download fails, calling this function again with the same
+ * arguments only fetches the missing ranges, as long as the image still has the same size and ETag.
+ *
+ * Ranged file downloads rely on POSIX file mapping and are not available on Windows.
+ *
+ * \param [in] path
+ *   Path of the file to create.
+ * \param [in] url
+ *   URL of the image to download.
+ * \param [in] chunk_size
+ *   Size of each byte range, 0 for \link NEKOS_DEFAULT_CHUNK_SIZE \endlink.
+ * \param [in] max_parallel
+ *   Maximum amount of simultaneous ranges, 0 for no limit.
+ *
+ * \return
+ *   ::NEKOS_OK \n
+ *   ::NEKOS_MEM_ERR \n
+ *   ::NEKOS_LIBCURL_ERR \n
+ *   ::NEKOS_INVALID_PARAM_ERR \n
+ *   ::NEKOS_IO_ERR
+ */
+nekos_status nekos_download_ranged_file(const char* path, const char* url, size_t chunk_size, int max_parallel);
+
+#endif // _WIN32
+
+#ifndef _WIN32
+
+/**
+ * Start a background prefetcher for a category.
+ *
+ * This function starts a thread that keeps up to `capacity` results of the category ready.
+ * The first refill starts immediately.
+ *
+ * \param [out] prefetcher
+ *   Pointer to a \link nekos_prefetcher nekos_prefetcher \endlink to initialize.
+ * \param [in] endpoint
+ *   Pointer to a \link nekos_endpoint nekos_endpoint \endlink to specify the category. It is copied.
+ * \param [in] capacity
+ *   Maximum amount of ready results. Must be at least 1.
+ * \param [in] low_water
+ *   Amount of ready results below which the prefetcher refills. Must be between 1 and `capacity`.
+ * \param [in] prefetch_images
+ *   Whether the images are downloaded along with the results.
+ *
+ * \return
+ *   ::NEKOS_OK \n
+ *   ::NEKOS_MEM_ERR \n
+ *   ::NEKOS_LIBCURL_ERR \n
+ *   ::NEKOS_INVALID_PARAM_ERR
+ */
+nekos_status nekos_prefetcher_init(nekos_prefetcher *prefetcher, const nekos_endpoint *endpoint, size_t capacity, size_t low_water, int prefetch_images);
+
+/**
+ * Take a ready result from a prefetcher.
+ *
+ * This function moves the oldest ready result out of the prefetcher, the caller owns it afterwards.
+ * It only takes a lock and copies a struct if a result is ready.
+ *
+ * \param [in] prefetcher
+ *   Pointer to a \link nekos_prefetcher nekos_prefetcher \endlink to take the result from.
+ * \param [out] prefetched
+ *   Pointer to a \link nekos_prefetched nekos_prefetched \endlink to store the result in.
+ * \param [in] wait
+ *   Whether to wait for a refill if no result is ready.
+ *
+ * \return
+ *   ::NEKOS_OK \n
+ *   ::NEKOS_EMPTY_ERR if no result is ready and `wait` is 0 \n
+ *   the status of the failed refill if `wait` is 1 and the refill failed
+ */
+nekos_status nekos_prefetcher_pop(nekos_prefetcher *prefetcher, nekos_prefetched *prefetched, int wait);
+
+/**
+ * Stop a prefetcher.
+ *
+ * This function stops the background thread, waiting for a running refill to complete,
+ * and frees all results that were not taken.
+ *
+ * \param [in] prefetcher
+ *   Pointer to a \link nekos_prefetcher nekos_prefetcher \endlink to free.
+ */
+void nekos_free_prefetcher(nekos_prefetcher *prefetcher);
+
+/**
+ * Initialize a thumbnailer.
+ *
+ * This function starts the download thread and `workers` worker threads.
+ * Every image submitted to the thumbnailer is downscaled to fit each of the sizes.
+ *
+ * \param [out] thumbnailer
+ *   Pointer to a \link nekos_thumbnailer nekos_thumbnailer \endlink to initialize.
+ * \param [in] decoder
+ *   Pointer to the \link nekos_decoder nekos_decoder \endlink to decode images with.
+ * \param [in] sizes
+ *   Array of `size_count` \link nekos_thumbnail_size nekos_thumbnail_size \endlink.
+ * \param [in] size_count
+ *   Amount of thumbnail sizes.
+ * \param [in] workers
+ *   Amount of worker threads, e.g. the amount of cpu cores.
+ *
+ * \return
+ *   ::NEKOS_OK \n
+ *   ::NEKOS_MEM_ERR \n
+ *   ::NEKOS_LIBCURL_ERR \n
+ *   ::NEKOS_INVALID_PARAM_ERR
+ */
+nekos_status nekos_thumbnailer_init(nekos_thumbnailer *thumbnailer, const nekos_decoder *decoder, const nekos_thumbnail_size *sizes, size_t size_count, size_t workers);
+
+/**
+ * Queue an image for download and thumbnailing.
+ *
+ * This function returns immediately, the callback is called from a thread of the thumbnailer once the thumbnails are ready
+ * or the download or decoding failed.
+ *
+ * \param [in] thumbnailer
+ *   Pointer to a \link nekos_thumbnailer nekos_thumbnailer \endlink to queue the image on.
+ * \param [in] url
+ *   URL of the image to download.
+ * \param [in] callback
+ *   Callback receiving the thumbnails.
+ * \param [in] userdata
+ *   User pointer passed to the callback.
+ *
+ * \return
+ *   ::NEKOS_OK \n
+ *   ::NEKOS_MEM_ERR
+ */
+nekos_status nekos_thumbnailer_fetch(nekos_thumbnailer *thumbnailer, const char *url, nekos_thumbnail_callback callback, void *userdata);
+
+/**
+ * Queue a downloaded image for thumbnailing.
+ *
+ * This function returns immediately, the callback is called from a worker thread once the thumbnails are ready
+ * or decoding failed. The thumbnailer takes ownership of the response and frees it after decoding.
+ *
+ * \param [in] thumbnailer
+ *   Pointer to a \link nekos_thumbnailer nekos_thumbnailer \endlink to queue the image on.
+ * \param [in] http_response
+ *   Pointer to a \link nekos_http_response nekos_http_response \endlink holding the image, e.g. from \link nekos_download nekos_download \endlink.
+ *   It stays owned by the caller if queueing fails.
+ * \param [in] callback
+ *   Callback receiving the thumbnails.
+ * \param [in] userdata
+ *   User pointer passed to the callback.
+ *
+ * \return
+ *   ::NEKOS_OK \n
+ *   ::NEKOS_MEM_ERR
+ */
+nekos_status nekos_thumbnailer_submit(nekos_thumbnailer *thumbnailer, nekos_http_response *http_response, nekos_thumbnail_callback callback, void *userdata);
+
+/**
+ * Wait for all queued images of a thumbnailer.
+ *
+ * This function returns once the callbacks of all images queued so far have returned.
+ * It must not be called from within a callback.
+ *
+ * \param [in] thumbnailer
+ *   Pointer to a \link nekos_thumbnailer nekos_thumbnailer \endlink to wait for.
+ */
+void nekos_thumbnailer_wait(nekos_thumbnailer *thumbnailer);
+
+/**
+ * Stop a thumbnailer.
+ *
+ * This function waits for all queued images like \link nekos_thumbnailer_wait nekos_thumbnailer_wait \endlink,
+ * then stops the threads and frees the thumbnailer.
+ *
+ * \param [in] thumbnailer
+ *   Pointer to a \link nekos_thumbnailer nekos_thumbnailer \endlink to free.
+ */
+void nekos_free_thumbnailer(nekos_thumbnailer *thumbnailer);
+
+#endif // _WIN32
+
+/**
+ * Downscale an image.
+ *
+ * This function averages the pixels of the image covered by each pixel of the thumbnail (a box filter),
+ * summing rows with SIMD instructions where available.
+ * The caller sets the size, stride and pixels of the thumbnail, which must not be larger than the image in either dimension.
+ *
+ * \param [in] image
+ *   Pointer to the \link nekos_image nekos_image \endlink to downscale.
+ * \param [in,out] thumbnail
+ *   Pointer to the \link nekos_image nekos_image \endlink to write the thumbnail to.
+ *
+ * \return
+ *   ::NEKOS_OK \n
+ *   ::NEKOS_MEM_ERR \n
+ *   ::NEKOS_INVALID_PARAM_ERR
+ */
+nekos_status nekos_resize_image(const nekos_image *image, nekos_image *thumbnail);
+
+/**
+ * Free thumbnails.
+ *
+ * This function frees the array of thumbnails passed to a \link nekos_thumbnail_callback nekos_thumbnail_callback \endlink
+ * along with their pixels.
+ *
+ * \param [in] thumbnails
+ *   Array of thumbnails to free.
+ */
+void nekos_free_thumbnails(nekos_image *thumbnails);
+
+/**
+ * Get the size of a snapshot.
+ *
+ * \param [in] endpoints
+ *   Pointer to a \link nekos_endpoint_list nekos_endpoint_list \endlink to include, may be NULL.
+ * \param [in] lists
+ *   Array of \link nekos_result_list nekos_result_list \endlink to include, may be NULL if `list_count` is 0.
+ * \param [in] list_count
+ *   Amount of result lists.
+ *
+ * \return
+ *   Size of the snapshot in bytes.
+ */
+size_t nekos_snapshot_size(const nekos_endpoint_list *endpoints, const nekos_result_list *lists, size_t list_count);
+
+/**
+ * Write a snapshot into a buffer.
+ *
+ * This function writes the endpoints and result lists into a caller-supplied buffer,
+ * which can be memory shared with other processes (e.g. mapped before forking workers).
+ * It does not allocate memory, see \link nekos_snapshot_size nekos_snapshot_size \endlink for the size needed.
+ *
+ * \param [out] buffer
+ *   Buffer to write the snapshot to.
+ * \param [in] capacity
+ *   Size of the buffer in bytes.
+ * \param [in] endpoints
+ *   Pointer to a \link nekos_endpoint_list nekos_endpoint_list \endlink to include, may be NULL.
+ * \param [in] lists
+ *   Array of \link nekos_result_list nekos_result_list \endlink to include, may be NULL if `list_count` is 0.
+ * \param [in] list_count
+ *   Amount of result lists.
+ *
+ * \return
+ *   ::NEKOS_OK \n
+ *   ::NEKOS_INVALID_PARAM_ERR if the snapshot would exceed 4 GiB \n
+ *   ::NEKOS_BUFFER_ERR
+ */
+nekos_status nekos_snapshot_write(char *buffer, size_t capacity, const nekos_endpoint_list *endpoints, const nekos_result_list *lists, size_t list_count);
+
+/**
+ * Read a snapshot in place.
+ *
+ * This function checks the header and all offsets of a snapshot once, so the accessor functions can read it without checks.
+ * Nothing is copied or allocated, the snapshot points into the buffer, which must stay unchanged while it is used.
+ *
+ * \param [out] snapshot
+ *   Pointer to a \link nekos_snapshot nekos_snapshot \endlink to initialize.
+ * \param [in] data
+ *   Buffer holding the snapshot.
+ * \param [in] len
+ *   Size of the buffer in bytes.
+ *
+ * \return
+ *   ::NEKOS_OK \n
+ *   ::NEKOS_FORMAT_ERR
+ */
+nekos_status nekos_snapshot_view(nekos_snapshot *snapshot, const char *data, size_t len);
+
+#ifndef _WIN32
+
+/**
+ * Save a snapshot to a file.
+ *
+ * This function writes the snapshot to a temporary file next to `path` and renames it into place,
+ * so processes opening the path always see a complete snapshot. Snapshots opened before keep reading the old file.
+ *
+ * \param [in] path
+ *   Path of the snapshot file.
+ * \param [in] endpoints
+ *   Pointer to a \link nekos_endpoint_list nekos_endpoint_list \endlink to include, may be NULL.
+ * \param [in] lists
+ *   Array of \link nekos_result_list nekos_result_list \endlink to include, may be NULL if `list_count` is 0.
+ * \param [in] list_count
+ *   Amount of result lists.
+ *
+ * \return
+ *   ::NEKOS_OK \n
+ *   ::NEKOS_MEM_ERR \n
+ *   ::NEKOS_INVALID_PARAM_ERR if the snapshot would exceed 4 GiB \n
+ *   ::NEKOS_IO_ERR
+ */
+nekos_status nekos_snapshot_save(const char *path, const nekos_endpoint_list *endpoints, const nekos_result_list *lists, size_t list_count);
+
+/**
+ * Open a snapshot file.
+ *
+ * This function maps the file read-only, all processes opening it share the same pages.
+ * The snapshot must be freed with \link nekos_free_snapshot nekos_free_snapshot \endlink.
+ *
+ * \param [out] snapshot
+ *   Pointer to a \link nekos_snapshot nekos_snapshot \endlink to initialize.
+ * \param [in] path
+ *   Path of the snapshot file.
+ *
+ * \return
+ *   ::NEKOS_OK \n
+ *   ::NEKOS_IO_ERR \n
+ *   ::NEKOS_FORMAT_ERR
+ */
+nekos_status nekos_snapshot_open(nekos_snapshot *snapshot, const char *path);
+
+#endif // _WIN32
+
+/**
+ * Get the amount of endpoints/categories in a snapshot.
+ *
+ * \param [in] snapshot
+ *   Pointer to a \link nekos_snapshot nekos_snapshot \endlink to read.
+ *
+ * \return
+ *   Amount of endpoints/categories.
+ */
+size_t nekos_snapshot_endpoint_count(const nekos_snapshot *snapshot);
+
+/**
+ * Get an endpoint/category of a snapshot.
+ *
+ * \param [in] snapshot
+ *   Pointer to a \link nekos_snapshot nekos_snapshot \endlink to read.
+ * \param [in] index
+ *   Index of the endpoint/category, must be less than \link nekos_snapshot_endpoint_count nekos_snapshot_endpoint_count \endlink.
+ *
+ * \return
+ *   The endpoint/category, its name points into the snapshot.
+ */
+nekos_snapshot_endpoint nekos_snapshot_get_endpoint(const nekos_snapshot *snapshot, size_t index);
+
+/**
+ * Get the amount of result lists in a snapshot.
+ *
+ * \param [in] snapshot
+ *   Pointer to a \link nekos_snapshot nekos_snapshot \endlink to read.
+ *
+ * \return
+ *   Amount of result lists.
+ */
+size_t nekos_snapshot_list_count(const nekos_snapshot *snapshot);
+
+/**
+ * Get the amount of results in a result list of a snapshot.
+ *
+ * \param [in] snapshot
+ *   Pointer to a \link nekos_snapshot nekos_snapshot \endlink to read.
+ * \param [in] list
+ *   Index of the result list, must be less than \link nekos_snapshot_list_count nekos_snapshot_list_count \endlink.
+ *
+ * \return
+ *   Amount of results in the list.
+ */
+size_t nekos_snapshot_result_count(const nekos_snapshot *snapshot, size_t list);
+
+/**
+ * Get a result of a result list of a snapshot.
+ *
+ * \param [in] snapshot
+ *   Pointer to a \link nekos_snapshot nekos_snapshot \endlink to read.
+ * \param [in] list
+ *   Index of the result list, must be less than \link nekos_snapshot_list_count nekos_snapshot_list_count \endlink.
+ * \param [in] index
+ *   Index of the result, must be less than \link nekos_snapshot_result_count nekos_snapshot_result_count \endlink.
+ *
+ * \return
+ *   The result, its strings point into the snapshot.
+ */
+nekos_snapshot_result nekos_snapshot_get_result(const nekos_snapshot *snapshot, size_t list, size_t index);
+
+/**
+ * Free a snapshot.
+ *
+ * This function unmaps a snapshot opened with \link nekos_snapshot_open nekos_snapshot_open \endlink.
+ * It does nothing for a snapshot read from a caller-supplied buffer.
+ *
+ * \param [in] snapshot
+ *   Pointer to a \link nekos_snapshot nekos_snapshot \endlink to free.
+ */
+void nekos_free_snapshot(nekos_snapshot *snapshot);
+
+/**
+ * Free an endpoint.
+ *
+ * This function frees the memory allocated for the endpoint.
+ *
+ * \param [in] endpoint
+ *   Pointer to a \link nekos_endpoint nekos_endpoint \endlink to free.
+*/
+void nekos_free_endpoint(const nekos_endpoint* endpoint);
+
+/**
+ * Free a list of endpoints.
+ *
+ * This function frees the memory allocated for the list of endpoints and the endpoints themselves.
+ *
+ * \param [in] endpoints
+ *   Pointer to a \link nekos_endpoint_list nekos_endpoint_list \endlink to free.
+ */
+void nekos_free_endpoints(const nekos_endpoint_list* endpoints);
+
+/**
+ * Free a hash index of a list of endpoints.
+ *
+ * This function frees the memory allocated for the index only, leaving the endpoints untouched.
+ *
+ * \param [in] index
+ *   Pointer to a \link nekos_endpoint_index nekos_endpoint_index \endlink to free.
+ */
+void nekos_free_endpoint_index(nekos_endpoint_index *index);
+
+/**
+ * Free a result.
+ *
+ * This function frees the memory allocated for the result and the source information.
+ *
+ * It must not be used on results of a list allocated with \link NEKOS_ARENA_RESULTS nekos_client_flag::NEKOS_ARENA_RESULTS \endlink
+ * or \link NEKOS_ZERO_COPY_RESULTS nekos_client_flag::NEKOS_ZERO_COPY_RESULTS \endlink.
+ *
+ * \param [in] result
+ *   Pointer to a \link nekos_result nekos_result \endlink to free.
+ */
+void nekos_free_result(const nekos_result* result);
+
+/**
+ * Free a list of results.
+ *
+ * This function frees the memory allocated for the list of results, the results themselves, and the source information.
+ * Lists allocated with \link NEKOS_ARENA_RESULTS nekos_client_flag::NEKOS_ARENA_RESULTS \endlink or
+ * \link NEKOS_ZERO_COPY_RESULTS nekos_client_flag::NEKOS_ZERO_COPY_RESULTS \endlink are freed with a single call to the free hook.
+ *
+ * \param [in] results
+ *   Pointer to a \link nekos_result_list nekos_result_list \endlink to free.
+ */
+void nekos_free_results(const nekos_result_list* results);
+
+/**
+ * Free an http response.
+ *
+ * This function frees the memory allocated for the response text.
+ *
+ * \param [in] http_response
+ *   Pointer to a \link nekos_http_response nekos_http_response \endlink to free.
+ */
+void nekos_free_http_response(const nekos_http_response* http_response);
+
+#ifndef _WIN32
+
+/**
+ * Free an http response returned by the image cache.
+ *
+ * This function unmaps the memory mapping of the cached image.
+ *
+ * \param [in] http_response
+ *   Pointer to a \link nekos_http_response nekos_http_response \endlink to free.
+ */
+void nekos_free_cached_response(const nekos_http_response* http_response);
+
+/**
+ * Free a disk cache of images.
+ *
+ * This function frees the lock of the cache and leaves the cached images on disk.
+ * It must only be called after all downloads through the cache have finished.
+ *
+ * \param [in] cache
+ *   Pointer to a \link nekos_image_cache nekos_image_cache \endlink to free.
+ */
+void nekos_free_image_cache(nekos_image_cache *cache);
+
+#endif // _WIN32
+
+/**
+ * Free a client.
+ *
+ * This function closes all connections kept alive by the client and frees the libcurl handle.
+ *
+ * \param [in] client
+ *   Pointer to a \link nekos_client nekos_client \endlink to free.
+ */
+void nekos_free_client(nekos_client *client);
+
+/**
+ * Free state shared between clients.
+ *
+ * This function must only be called after all clients using the share have been freed.
+ *
+ * \param [in] share
+ *   Pointer to a \link nekos_share nekos_share \endlink to free.
+ */
+void nekos_free_share(nekos_share *share);
+
+/**
+ * Free an in-memory cache of search results.
+ *
+ * This function must only be called after all clients using the cache stopped using it.
+ *
+ * \param [in] cache
+ *   Pointer to a \link nekos_search_cache nekos_search_cache \endlink to free.
+ */
+void nekos_free_search_cache(nekos_search_cache *cache);
+
+/**
+ * Free a filter of seen result urls.
+ *
+ * \param [in] filter
+ *   Pointer to a \link nekos_seen_filter nekos_seen_filter \endlink to free.
+ */
+void nekos_free_seen_filter(nekos_seen_filter *filter);
+
+/**
+ * Free a rate limiter.
+ *
+ * This function must only be called after all clients using the rate limiter have been freed.
+ *
+ * \param [in] limiter
+ *   Pointer to a \link nekos_rate_limiter nekos_rate_limiter \endlink to free.
+ */
+void nekos_free_rate_limiter(nekos_rate_limiter *limiter);
+
+/**
+ * Free an asynchronous request context.
+ *
+ * This function cancels all in-flight requests without calling their completion callbacks.
+ * It must not be called from within a completion callback.
+ *
+ * \param [in] async
+ *   Pointer to a \link nekos_async nekos_async \endlink to free.
+ */
+void nekos_free_async(nekos_async *async);
+
+#ifdef NEKOSBEST_IMPL
+
+static nekos_hooks nekos_global_hooks = { malloc, realloc, free };
+
+static void* nekos_malloc(size_t size) {
+    return nekos_global_hooks.malloc_fn(size);
+}
+
+static void* nekos_realloc(void *ptr, size_t size) {
+    return nekos_global_hooks.realloc_fn(ptr, size);
+}
+
+static void nekos_free(void *ptr) {
+    nekos_global_hooks.free_fn(ptr);
+}
+
+void nekos_init_hooks(const nekos_hooks *hooks) {
+    nekos_global_hooks.malloc_fn = hooks && hooks->malloc_fn ? hooks->malloc_fn : malloc;
+    nekos_global_hooks.realloc_fn = hooks && hooks->realloc_fn ? hooks->realloc_fn : realloc;
+    nekos_global_hooks.free_fn = hooks && hooks->free_fn ? hooks->free_fn : free;
+}
+
+/// Initial capacity of a response buffer when the server does not send a Content-Length.
+#define NEKOS_INITIAL_BUFFER_SIZE 16384
+
+typedef struct {
+    CURL *curl;
+    nekos_http_response *http_response;
+    size_t cap;
+    int fixed;
+    int overflow;
+} nekos_response_buffer;
+
+typedef struct {
+    CURL *curl;
+    nekos_response_buffer buffer;
+} nekos_transfer;
+
+static int nekos_reserve(nekos_response_buffer *buffer, size_t cap) {
+    if (cap <= buffer->cap)
+        return 1;
+
+    char* new_text = (char*) nekos_realloc(buffer->http_response->text, cap);
+    if (!new_text)
+        return 0;
+
+    buffer->http_response->text = new_text;
+    buffer->cap = cap;
+    return 1;
+}
+
+static size_t nekos_write_callback(const void *ptr, size_t count, size_t nmemb, nekos_response_buffer *buffer) {
+    size_t size = count * nmemb;
+    nekos_http_response *http_response = buffer->http_response;
+    size_t new_len = http_response->len + size;
+
+    if (buffer->fixed) {
+        // caller-owned buffers are never resized
+        if (new_len > buffer->cap) {
+            buffer->overflow = 1;
+            return 0;
+        }
+    } else {
+        // preallocate the whole body on the first chunk if the size is known
+        curl_off_t content_length;
+        if (http_response->len == 0 && curl_easy_getinfo(buffer->curl, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &content_length) == CURLE_OK && content_length > 0)
+            nekos_reserve(buffer, (size_t) content_length + 1);
+
+        // grow response text geometrically
+        if (new_len + 1 > buffer->cap) {
+            size_t new_cap = buffer->cap < NEKOS_INITIAL_BUFFER_SIZE ? NEKOS_INITIAL_BUFFER_SIZE : buffer->cap * 2;
+            if (new_cap < new_len + 1)
+                new_cap = new_len + 1;
+
+            if (!nekos_reserve(buffer, new_cap))
+                return 0; // aborts the transfer, the request frees the response text
+        }
+    }
+
+    // copy new data to response text
+    memcpy(http_response->text + http_response->len, ptr, size);
+    http_response->len = new_len;
+    return size;
+}
+
+typedef struct {
+    const nekos_sink *sink;
+    int failed;
+} nekos_sink_state;
+
+static size_t nekos_sink_callback(const char *ptr, size_t count, size_t nmemb, nekos_sink_state *state) {
+    size_t size = count * nmemb;
+    const nekos_sink *sink = state->sink;
+
+    switch (sink->type) {
+        case NEKOS_SINK_CALLBACK:
+            if (sink->callback(ptr, size, sink->userdata) != 0)
+                return 0; // aborted by the callback, not an io error
+            return size;
+        case NEKOS_SINK_FILE:
+            if (fwrite(ptr, 1, size, sink->file) != size)
+                break;
+            return size;
+        case NEKOS_SINK_FD: {
+            // write until the whole chunk is out
+            size_t written = 0;
+            while (written < size) {
+#ifdef _WIN32
+                int res = _write(sink->fd, ptr + written, (unsigned int) (size - written));
+#else
+                ssize_t res = write(sink->fd, ptr + written, size - written);
+                if (res < 0 && errno == EINTR)
+                    continue;
+#endif
+                if (res <= 0)
+                    break;
+                written += (size_t) res;
+            }
+            if (written != size)
+                break;
+            return size;
+        }
+    }
+
+    state->failed = 1;
+    return 0;
+}
+
+static void nekos_setup_request(CURL *curl, int flags, const nekos_request_policy *policy, nekos_share *share, const char* url) {
+    curl_easy_setopt(curl, CURLOPT_URL, url);
+    curl_easy_setopt(curl, CURLOPT_SHARE, share ? share->share : NULL);
+    curl_easy_setopt(curl, CURLOPT_CA_CACHE_TIMEOUT, 604800L);
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+    if (policy) {
+        curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT_MS, policy->connect_timeout_ms);
+        curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, policy->timeout_ms);
+    }
+
+    // wait for a connection that can be multiplexed rather than opening another one
+    if (flags & NEKOS_HTTP2) {
+        curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, (long) CURL_HTTP_VERSION_2TLS);
+        curl_easy_setopt(curl, CURLOPT_PIPEWAIT, 1L);
+    }
+
+    // images are already compressed, only ask for compressed json
+    if ((flags & NEKOS_COMPRESS_JSON) && strncmp(url, NEKOS_BASE_URL, sizeof(NEKOS_BASE_URL) - 1) == 0)
+        curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, "");
+}
+
+static curl_off_t nekos_now_us(void) {
+#ifdef _WIN32
+    LARGE_INTEGER frequency, counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (curl_off_t) (counter.QuadPart / frequency.QuadPart * 1000000 + counter.QuadPart % frequency.QuadPart * 1000000 / frequency.QuadPart);
+#else
+    // gettimeofday is available in strict c99 mode, unlike clock_gettime
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (curl_off_t) tv.tv_sec * 1000000 + tv.tv_usec;
+#endif
+}
+
+static curl_off_t nekos_elapsed_us(curl_off_t start) {
+    // the clock may step backwards on posix
+    curl_off_t elapsed = nekos_now_us() - start;
+    return elapsed > 0 ? elapsed : 0;
+}
+
+static void nekos_read_timing(CURL *curl, nekos_timing *timing) {
+    curl_off_t size_download = 0;
+    long request_size = 0;
+    memset(timing, 0, sizeof(nekos_timing));
+    curl_easy_getinfo(curl, CURLINFO_NAMELOOKUP_TIME_T, &timing->dns_us);
+    curl_easy_getinfo(curl, CURLINFO_CONNECT_TIME_T, &timing->connect_us);
+    curl_easy_getinfo(curl, CURLINFO_APPCONNECT_TIME_T, &timing->tls_us);
+    curl_easy_getinfo(curl, CURLINFO_STARTTRANSFER_TIME_T, &timing->first_byte_us);
+    curl_easy_getinfo(curl, CURLINFO_TOTAL_TIME_T, &timing->total_us);
+    curl_easy_getinfo(curl, CURLINFO_SIZE_DOWNLOAD_T, &size_download);
+    curl_easy_getinfo(curl, CURLINFO_REQUEST_SIZE, &request_size);
+    timing->bytes_received = size_download;
+    timing->bytes_sent = (curl_off_t) request_size;
+}
+
+static void nekos_record_stats(nekos_stats *stats, nekos_stats_call call, nekos_status status, const nekos_timing *timing) {
+    nekos_call_stats *call_stats = &stats->calls[call];
+    call_stats->count++;
+    if (status != NEKOS_OK)
+        call_stats->errors++;
+
+    call_stats->total.dns_us += timing->dns_us;
+    call_stats->total.connect_us += timing->connect_us;
+    call_stats->total.tls_us += timing->tls_us;
+    call_stats->total.first_byte_us += timing->first_byte_us;
+    call_stats->total.total_us += timing->total_us;
+    call_stats->total.parse_us += timing->parse_us;
+    call_stats->total.bytes_sent += timing->bytes_sent;
+    call_stats->total.bytes_received += timing->bytes_received;
+
+    // bucket by the bit length of the latency
+    unsigned long long latency = (unsigned long long) (timing->total_us + timing->parse_us);
+    size_t bucket = 0;
+    while (latency && bucket < NEKOS_STATS_BUCKETS - 1) {
+        latency >>= 1;
+        bucket++;
+    }
+    call_stats->histogram[bucket]++;
+}
+
+static nekos_status nekos_prepare_request(CURL *curl, int flags, const nekos_request_policy *policy, nekos_share *share, nekos_response_buffer *buffer, nekos_http_response *http_response, const char* url) {
+    // initialize http response object
+    memset(&http_response->timing, 0, sizeof(nekos_timing));
+    http_response->len = 0;
+    http_response->text = (char*) nekos_malloc(1);
+    if (!http_response->text)
+        return NEKOS_MEM_ERR;
+
+    buffer->curl = curl;
+    buffer->http_response = http_response;
+    buffer->cap = 1;
+    buffer->fixed = 0;
+    buffer->overflow = 0;
+
+    // configure curl request
+    nekos_setup_request(curl, flags, policy, share, url);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, nekos_write_callback);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, buffer);
+    return NEKOS_OK;
+}
+
+nekos_status nekos_rate_limiter_init(nekos_rate_limiter *limiter, double rate, double burst) {
+    if (!(rate > 0) || !(burst >= 1))
+        return NEKOS_INVALID_PARAM_ERR;
+
+    limiter->rate = rate;
+    limiter->burst = burst;
+    limiter->max_retries = 3;
+    limiter->tokens = burst;
+    limiter->updated_us = nekos_now_us();
+    limiter->blocked_until_us = 0;
+    limiter->queued = 0;
+    limiter->throttled = 0;
+#ifdef _WIN32
+    InitializeCriticalSection(&limiter->lock);
+    InitializeConditionVariable(&limiter->changed);
+#else
+    pthread_mutex_init(&limiter->lock, NULL);
+    pthread_cond_init(&limiter->changed, NULL);
+#endif
+    return NEKOS_OK;
+}
+
+void nekos_free_rate_limiter(nekos_rate_limiter *limiter) {
+#ifdef _WIN32
+    DeleteCriticalSection(&limiter->lock);
+#else
+    pthread_mutex_destroy(&limiter->lock);
+    pthread_cond_destroy(&limiter->changed);
+#endif
+}
+
+size_t nekos_rate_limiter_queued(nekos_rate_limiter *limiter) {
+#ifdef _WIN32
+    EnterCriticalSection(&limiter->lock);
+    size_t queued = limiter->queued;
+    LeaveCriticalSection(&limiter->lock);
+#else
+    pthread_mutex_lock(&limiter->lock);
+    size_t queued = limiter->queued;
+    pthread_mutex_unlock(&limiter->lock);
+#endif
+    return queued;
+}
+
+static void nekos_rate_refill(nekos_rate_limiter *limiter, curl_off_t now) {
+    if (now > limiter->updated_us) {
+        limiter->tokens += (double) (now - limiter->updated_us) * limiter->rate / 1e6;
+        if (limiter->tokens > limiter->burst)
+            limiter->tokens = limiter->burst;
+    }
+    limiter->updated_us = now;
+}
+
+static void nekos_rate_acquire(nekos_rate_limiter *limiter) {
+#ifdef _WIN32
+    EnterCriticalSection(&limiter->lock);
+#else
+    pthread_mutex_lock(&limiter->lock);
+#endif
+
+    // wait for a token and for any pause requested by the server
+    limiter->queued++;
+    for (;;) {
+        curl_off_t now = nekos_now_us();
+        nekos_rate_refill(limiter, now);
+        if (now >= limiter->blocked_until_us && limiter->tokens >= 1)
+            break;
+
+        curl_off_t wait_us = limiter->blocked_until_us > now
+            ? limiter->blocked_until_us - now
+            : (curl_off_t) ((1 - limiter->tokens) * 1e6 / limiter->rate) + 1;
+#ifdef _WIN32
+        SleepConditionVariableCS(&limiter->changed, &limiter->lock, (DWORD) (wait_us / 1000 + 1));
+#else
+        struct timeval tv;
+        gettimeofday(&tv, NULL);
+        curl_off_t deadline_us = (curl_off_t) tv.tv_sec * 1000000 + tv.tv_usec + wait_us;
+        struct timespec deadline;
+        deadline.tv_sec = (time_t) (deadline_us / 1000000);
+        deadline.tv_nsec = (long) (deadline_us % 1000000) * 1000;
+        pthread_cond_timedwait(&limiter->changed, &limiter->lock, &deadline);
+#endif
+    }
+    limiter->tokens -= 1;
+    limiter->queued--;
+
+#ifdef _WIN32
+    LeaveCriticalSection(&limiter->lock);
+#else
+    pthread_mutex_unlock(&limiter->lock);
+#endif
+}
+
+static long long nekos_days_from_civil(long long y, unsigned m, unsigned d) {
+    // days since 1970-01-01 in the proleptic gregorian calendar
+    y -= m <= 2;
+    long long era = (y >= 0 ? y : y - 399) / 400;
+    unsigned yoe = (unsigned) (y - era * 400);
+    unsigned doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+    unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + (long long) doe - 719468;
+}
+
+static int nekos_header_delay(CURL *curl, const char* name, curl_off_t *delay_us) {
+    struct curl_header *header;
+    if (curl_easy_header(curl, name, 0, CURLH_HEADER, -1, &header) != CURLHE_OK)
+        return 0;
+
+    // seconds, an http date or an iso 8601 timestamp
+    const char *value = header->value;
+    char *end;
+    double number = strtod(value, &end);
+    if (end != value && *end == '\0') {
+        // large numbers are absolute unix timestamps
+        if (number > 1e9)
+            number -= (double) time(NULL);
+        *delay_us = number > 0 ? (curl_off_t) (number * 1e6) : 0;
+        return 1;
+    }
+
+    long long when = (long long) curl_getdate(value, NULL);
+    int year, month, day, hour, minute, second;
+    if (when < 0 && sscanf(value, "%4d-%2d-%2dT%2d:%2d:%2d", &year, &month, &day, &hour, &minute, &second) == 6)
+        when = nekos_days_from_civil(year, (unsigned) month, (unsigned) day) * 86400 + hour * 3600 + minute * 60 + second;
+    if (when < 0)
+        return 0;
+
+    long long delay = when - (long long) time(NULL);
+    *delay_us = delay > 0 ? (curl_off_t) delay * 1000000 : 0;
+    return 1;
+}
+
+static void nekos_rate_feedback(nekos_rate_limiter *limiter, CURL *curl, long response_code) {
+    // read remaining requests and the time until the window resets
+    struct curl_header *header;
+    long remaining = -1;
+    if (curl_easy_header(curl, "x-rate-limit-remaining", 0, CURLH_HEADER, -1, &header) == CURLHE_OK
+        || curl_easy_header(curl, "x-ratelimit-remaining", 0, CURLH_HEADER, -1, &header) == CURLHE_OK)
+        remaining = strtol(header->value, NULL, 10);
+
+    curl_off_t delay_us = -1;
+    if (response_code == 429)
+        nekos_header_delay(curl, "retry-after", &delay_us);
+    if (delay_us < 0 && (response_code == 429 || remaining == 0)
+        && !nekos_header_delay(curl, "x-rate-limit-reset", &delay_us)
+        && !nekos_header_delay(curl, "x-ratelimit-reset", &delay_us)
+        && response_code == 429)
+        delay_us = (curl_off_t) (1e6 / limiter->rate);
+
+#ifdef _WIN32
+    EnterCriticalSection(&limiter->lock);
+#else
+    pthread_mutex_lock(&limiter->lock);
+#endif
+
+    curl_off_t now = nekos_now_us();
+    nekos_rate_refill(limiter, now);
+    if (remaining >= 0 && limiter->tokens > (double) remaining)
+        limiter->tokens = (double) remaining;
+    if (response_code == 429) {
+        limiter->tokens = 0;
+        limiter->throttled++;
+    }
+    if (delay_us >= 0 && now + delay_us > limiter->blocked_until_us)
+        limiter->blocked_until_us = now + delay_us;
+
+    // let waiters recompute their delay
+#ifdef _WIN32
+    WakeAllConditionVariable(&limiter->changed);
+    LeaveCriticalSection(&limiter->lock);
+#else
+    pthread_cond_broadcast(&limiter->changed);
+    pthread_mutex_unlock(&limiter->lock);
+#endif
+}
+
+static int nekos_rate_try_acquire(nekos_rate_limiter *limiter) {
+#ifdef _WIN32
+    EnterCriticalSection(&limiter->lock);
+#else
+    pthread_mutex_lock(&limiter->lock);
+#endif
+
+    curl_off_t now = nekos_now_us();
+    nekos_rate_refill(limiter, now);
+    int acquired = now >= limiter->blocked_until_us && limiter->tokens >= 1;
+    if (acquired)
+        limiter->tokens -= 1;
+
+#ifdef _WIN32
+    LeaveCriticalSection(&limiter->lock);
+#else
+    pthread_mutex_unlock(&limiter->lock);
+#endif
+    return acquired;
+}
+
+/// Minimum amount of requests of a call before its latency percentile is used as hedge delay.
+#define NEKOS_HEDGE_MIN_SAMPLES 20
+
+static long nekos_hedge_delay(nekos_client *client, nekos_stats_call call) {
+    const nekos_request_policy *policy = &client->policy;
+
+    // use the observed latency once there are enough samples
+    const nekos_call_stats *stats = &client->stats.calls[call];
+    if (policy->hedge_percentile > 0 && stats->count >= NEKOS_HEDGE_MIN_SAMPLES) {
+        unsigned long long latency_us = nekos_stats_percentile(stats, policy->hedge_percentile);
+        if (latency_us > 0)
+            return (long) (latency_us / 1000) + 1;
+    }
+
+    return policy->hedge_delay_ms;
+}
+
+static CURLcode nekos_perform_hedged(nekos_client *client, nekos_stats_call call, nekos_http_response *http_response, const char* url, struct curl_slist *headers, long delay_ms) {
+    if (!client->hedge && !(client->hedge = curl_easy_init()))
+        return curl_easy_perform(client->curl);
+
+    CURLM *multi = client->multi;
+    if (curl_multi_add_handle(multi, client->curl) != CURLM_OK)
+        return curl_easy_perform(client->curl);
+
+    nekos_response_buffer hedge_buffer;
+    nekos_http_response hedge_response;
+    hedge_response.text = NULL;
+    curl_off_t start = nekos_now_us();
+    int hedged = 0;
+    int failed = 0;
+    CURL *winner = NULL;
+    CURLcode res = CURLE_OK;
+    while (!winner) {
+        int running;
+        if (curl_multi_perform(multi, &running) != CURLM_OK) {
+            winner = client->curl;
+            res = CURLE_RECV_ERROR;
+            break;
+        }
+
+        // the first successful transfer wins, a failure only if the other one failed too
+        CURLMsg *msg;
+        int msgs_left;
+        while ((msg = curl_multi_info_read(multi, &msgs_left))) {
+            if (msg->msg != CURLMSG_DONE)
+                continue;
+            if (msg->data.result == CURLE_OK || !hedged || failed) {
+                winner = msg->easy_handle;
+                res = msg->data.result;
+                break;
+            }
+            failed = 1;
+        }
+        if (winner)
+            break;
+
+        // send a duplicate once the first request is late
+        long elapsed_ms = (long) (nekos_elapsed_us(start) / 1000);
+        if (!hedged && elapsed_ms >= delay_ms) {
+            hedged = 1;
+            curl_easy_reset(client->hedge);
+            if ((!client->rate_limiter || nekos_rate_try_acquire(client->rate_limiter))
+                && nekos_prepare_request(client->hedge, client->flags, &client->policy, client->share, &hedge_buffer, &hedge_response, url) == NEKOS_OK) {
+                if (headers)
+                    curl_easy_setopt(client->hedge, CURLOPT_HTTPHEADER, headers);
+                if (curl_multi_add_handle(multi, client->hedge) == CURLM_OK) {
+                    client->stats.calls[call].hedged++;
+                } else {
+                    nekos_free(hedge_response.text);
+                    hedge_response.text = NULL;
+                }
+            }
+            if (!hedge_response.text)
+                failed = 1; // no duplicate in flight, the first request decides
+        }
+
+        curl_multi_poll(multi, NULL, 0, hedged ? 1000 : (int) (delay_ms - elapsed_ms), NULL);
+    }
+
+    curl_multi_remove_handle(multi, client->curl);
+    if (hedge_response.text)
+        curl_multi_remove_handle(multi, client->hedge);
+
+    // keep the winning handle as the client's handle, so callers can read its info
+    if (winner == client->hedge) {
+        client->hedge = client->curl;
+        client->curl = winner;
+        nekos_free(http_response->text);
+        *http_response = hedge_response;
+        client->stats.calls[call].hedge_wins++;
+    } else {
+        nekos_free(hedge_response.text);
+    }
+
+    return res;
+}
+
+static int nekos_transient_failure(CURLcode res, long response_code) {
+    switch (res) {
+        case CURLE_OK:
+            return response_code == 500 || response_code == 502 || response_code == 503 || response_code == 504;
+        case CURLE_COULDNT_RESOLVE_HOST:
+        case CURLE_COULDNT_CONNECT:
+        case CURLE_OPERATION_TIMEDOUT:
+        case CURLE_SSL_CONNECT_ERROR:
+        case CURLE_SEND_ERROR:
+        case CURLE_RECV_ERROR:
+        case CURLE_GOT_NOTHING:
+        case CURLE_PARTIAL_FILE:
+        case CURLE_HTTP2:
+        case CURLE_HTTP2_STREAM:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+static void nekos_backoff(nekos_client *client, int retry) {
+    const nekos_request_policy *policy = &client->policy;
+
+    // exponential cap, then full jitter so that retrying clients spread out
+    unsigned long long cap_ms = (unsigned long long) (policy->backoff_ms > 0 ? policy->backoff_ms : 0);
+    for (int i = 0; i < retry && cap_ms < (1ull << 40); i++)
+        cap_ms *= 2;
+    if (policy->max_backoff_ms > 0 && cap_ms > (unsigned long long) policy->max_backoff_ms)
+        cap_ms = (unsigned long long) policy->max_backoff_ms;
+    if (cap_ms == 0)
+        return;
+
+    // splitmix64 of the clock and the client address
+    unsigned long long x = (unsigned long long) nekos_now_us() ^ (unsigned long long) (size_t) client;
+    x += 0x9e3779b97f4a7c15ull;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    x ^= x >> 31;
+
+    // with no transfers on the multi handle this only waits, and works in strict c99
+    curl_multi_poll(client->multi, NULL, 0, (int) (x % (cap_ms + 1)), NULL);
+}
+
+static nekos_status nekos_perform(nekos_client *client, nekos_stats_call call, nekos_http_response *http_response, const char* url, struct curl_slist *headers, CURLcode *res) {
+    // reset options from previous requests (keeps open connections)
+    curl_easy_reset(client->curl);
+
+    // configure curl request
+    nekos_response_buffer buffer;
+    nekos_status status = nekos_prepare_request(client->curl, client->flags, &client->policy, client->share, &buffer, http_response, url);
+    if (status != NEKOS_OK)
+        return status;
+    if (headers)
+        curl_easy_setopt(client->curl, CURLOPT_HTTPHEADER, headers);
+
+    long delay_ms = nekos_hedge_delay(client, call);
+    *res = delay_ms > 0 ? nekos_perform_hedged(client, call, http_response, url, headers, delay_ms) : curl_easy_perform(client->curl);
+    nekos_read_timing(client->curl, &http_response->timing);
+    return NEKOS_OK;
+}
+
+static nekos_status nekos_do_request_with_headers(nekos_client *client, nekos_stats_call call, nekos_http_response *http_response, const char* url, struct curl_slist *headers) {
+    nekos_rate_limiter *limiter = client->rate_limiter;
+    int throttled = 0;
+    int retries = 0;
+    CURLcode res;
+    long response_code;
+    for (;;) {
+        if (limiter)
+            nekos_rate_acquire(limiter);
+        nekos_status status = nekos_perform(client, call, http_response, url, headers, &res);
+        if (status != NEKOS_OK)
+            return status;
+
+        response_code = 0;
+        curl_easy_getinfo(client->curl, CURLINFO_RESPONSE_CODE, &response_code);
+        if (limiter && res == CURLE_OK)
+            nekos_rate_feedback(limiter, client->curl, response_code);
+
+        // retry rejected requests while the rate limiter allows, transient failures while the policy allows
+        if (res == CURLE_OK && response_code == 429) {
+            if (!limiter || throttled++ >= limiter->max_retries)
+                break;
+        } else if (!nekos_transient_failure(res, response_code) || retries >= client->policy.max_retries) {
+            break;
+        } else {
+            nekos_backoff(client, retries++);
+            client->stats.calls[call].retries++;
+        }
+
+        nekos_free(http_response->text);
+    }
+
+    if (res != CURLE_OK || response_code == 429) {
+        nekos_free(http_response->text);
+        http_response->text = NULL;
+        http_response->len = 0;
+        return res != CURLE_OK ? NEKOS_LIBCURL_ERR : NEKOS_RATE_LIMIT_ERR;
+    }
+
+    return NEKOS_OK;
+}
+
+static nekos_status nekos_do_request(nekos_client *client, nekos_stats_call call, nekos_http_response *http_response, const char* url) {
+    return nekos_do_request_with_headers(client, call, http_response, url, NULL);
+}
+
+struct nekos_flight {
+    char *url;
+    nekos_status status;
+    nekos_http_response response; // copy of the response for waiters
+    int done;
+    size_t waiters;
+    nekos_flight *next;
+};
+
+static void nekos_flight_lock(nekos_share *share) {
+#ifdef _WIN32
+    EnterCriticalSection(&share->flight_lock);
+#else
+    pthread_mutex_lock(&share->flight_lock);
+#endif
+}
+
+static void nekos_flight_unlock(nekos_share *share) {
+#ifdef _WIN32
+    LeaveCriticalSection(&share->flight_lock);
+#else
+    pthread_mutex_unlock(&share->flight_lock);
+#endif
+}
+
+static void nekos_release_flight(nekos_flight *flight) {
+    // the last waiter frees the flight, it is already unlinked once done
+    if (--flight->waiters > 0)
+        return;
+
+    nekos_free(flight->response.text);
+    nekos_free(flight->url);
+    nekos_free(flight);
+}
+
+static nekos_status nekos_wait_flight(nekos_share *share, nekos_flight *flight, nekos_http_response *http_response) {
+    while (!flight->done) {
+#ifdef _WIN32
+        SleepConditionVariableCS(&share->flight_done, &share->flight_lock, INFINITE);
+#else
+        pthread_cond_wait(&share->flight_done, &share->flight_lock);
+#endif
+    }
+
+    // copy the response, parsing consumes it
+    nekos_status status = flight->status;
+    http_response->text = NULL;
+    http_response->len = 0;
+    http_response->timing = flight->response.timing;
+    if (status == NEKOS_OK) {
+        http_response->text = (char*) nekos_malloc(flight->response.len ? flight->response.len : 1);
+        if (http_response->text) {
+            memcpy(http_response->text, flight->response.text, flight->response.len);
+            http_response->len = flight->response.len;
+        } else {
+            status = NEKOS_MEM_ERR;
+        }
+    }
+
+    nekos_release_flight(flight);
+    return status;
+}
+
+static nekos_status nekos_coalesced_request(nekos_client *client, nekos_stats_call call, nekos_http_response *http_response, const char* url) {
+    if (!(client->flags & NEKOS_COALESCE_REQUESTS) || !client->share)
+        return nekos_do_request(client, call, http_response, url);
+
+    // join an identical request in flight
+    nekos_share *share = client->share;
+    nekos_flight_lock(share);
+    nekos_flight *flight = share->flights;
+    while (flight && strcmp(flight->url, url) != 0)
+        flight = flight->next;
+    if (flight) {
+        flight->waiters++;
+        nekos_status status = nekos_wait_flight(share, flight, http_response);
+        nekos_flight_unlock(share);
+        client->stats.calls[call].coalesced++;
+        return status;
+    }
+
+    // otherwise lead a new one
+    size_t url_len = strlen(url) + 1;
+    flight = (nekos_flight*) nekos_malloc(sizeof(nekos_flight));
+    char *url_copy = (char*) nekos_malloc(url_len);
+    if (!flight || !url_copy) {
+        nekos_flight_unlock(share);
+        nekos_free(flight);
+        nekos_free(url_copy);
+        return nekos_do_request(client, call, http_response, url);
+    }
+    memcpy(url_copy, url, url_len);
+    memset(flight, 0, sizeof(nekos_flight));
+    flight->url = url_copy;
+    flight->waiters = 1;
+    flight->next = share->flights;
+    share->flights = flight;
+    nekos_flight_unlock(share);
+
+    nekos_status status = nekos_do_request(client, call, http_response, url);
+
+    // publish the result, no new waiters can join once unlinked
+    nekos_flight_lock(share);
+    nekos_flight **link = &share->flights;
+    while (*link != flight)
+        link = &(*link)->next;
+    *link = flight->next;
+
+    flight->status = status;
+    flight->response.timing = http_response->timing;
+    if (status == NEKOS_OK && flight->waiters > 1) {
+        flight->response.text = (char*) nekos_malloc(http_response->len ? http_response->len : 1);
+        if (flight->response.text) {
+            memcpy(flight->response.text, http_response->text, http_response->len);
+            flight->response.len = http_response->len;
+        } else {
+            flight->status = NEKOS_MEM_ERR;
+        }
+    }
+    flight->done = 1;
+#ifdef _WIN32
+    WakeAllConditionVariable(&share->flight_done);
+#else
+    pthread_cond_broadcast(&share->flight_done);
+#endif
+    nekos_release_flight(flight);
+    nekos_flight_unlock(share);
+    return status;
+}
+
+/// Round a size up to pointer alignment, used for placing objects in a result arena.
+#define NEKOS_ARENA_ALIGN(size) (((size) + sizeof(void*) - 1) & ~(sizeof(void*) - 1))
+
+typedef struct {
+    char *base;
+    size_t used;
+} nekos_arena;
+
+static const char* nekos_gif_keys[] = { "url", "anime_name" };
+static const char* nekos_png_keys[] = { "url", "artist_name", "artist_href", "source_url" };
+
+static void* nekos_arena_alloc(nekos_arena *arena, size_t size) {
+    // fall back to the heap if no arena is used
+    if (!arena->base)
+        return nekos_malloc(size);
+
+    void *ptr = arena->base + arena->used;
+    arena->used += NEKOS_ARENA_ALIGN(size);
+    return ptr;
+}
+
+static char* nekos_arena_strdup(nekos_arena *arena, const char* str) {
+    if (!str)
+        return NULL;
+
+    size_t len = strlen(str) + 1;
+    char *copy = (char*) nekos_arena_alloc(arena, len);
+    if (copy)
+        memcpy(copy, str, len);
+    return copy;
+}
+
+/// Maximum nesting depth of json values skipped by the parser.
+#define NEKOS_JSON_MAX_DEPTH 64
+
+typedef struct {
+    char *pos;
+    char *end;
+} nekos_json_reader;
+
+static void nekos_json_skip_whitespace(nekos_json_reader *reader) {
+    while (reader->pos < reader->end && (*reader->pos == ' ' || *reader->pos == '\n' || *reader->pos == '\r' || *reader->pos == '\t'))
+        reader->pos++;
+}
+
+static int nekos_json_consume(nekos_json_reader *reader, char c) {
+    nekos_json_skip_whitespace(reader);
+    if (reader->pos >= reader->end || *reader->pos != c)
+        return 0;
+
+    reader->pos++;
+    return 1;
+}
+
+static int nekos_json_string(nekos_json_reader *reader, char **str, size_t *len) {
+    if (!nekos_json_consume(reader, '"'))
+        return 0;
+
+    // find the closing quote, skipping escaped ones
+    char *search = reader->pos;
+    for (;;) {
+        char *quote = (char*) memchr(search, '"', (size_t) (reader->end - search));
+        if (!quote)
+            return 0;
+
+        char *backslash = quote;
+        while (backslash > reader->pos && backslash[-1] == '\\')
+            backslash--;
+        if ((quote - backslash) % 2 == 0) {
+            *str = reader->pos;
+            *len = (size_t) (quote - reader->pos);
+            reader->pos = quote + 1;
+            return 1;
+        }
+
+        search = quote + 1;
+    }
+}
+
+static int nekos_json_hex4(const char *hex, unsigned long *value) {
+    *value = 0;
+    for (int i = 0; i < 4; i++) {
+        char c = hex[i];
+        int digit = c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : c >= 'A' && c <= 'F' ? c - 'A' + 10 : -1;
+        if (digit < 0)
+            return 0;
+        *value = (*value << 4) | (unsigned long) digit;
+    }
+
+    return 1;
+}
+
+static size_t nekos_json_unescape(char *dst, const char *src, size_t len) {
+    // copy everything up to the first escape at once (dst may equal src)
+    const char *end = src + len;
+    const char *escape = (const char*) memchr(src, '\\', len);
+    size_t out = escape ? (size_t) (escape - src) : len;
+    memmove(dst, src, out);
+    if (!escape)
+        return out;
+
+    // the decoded string is never longer than the escaped one
+    src = escape;
+    while (src < end) {
+        if (*src != '\\') {
+            dst[out++] = *src++;
+            continue;
+        }
+
+        if (end - src < 2)
+            return (size_t) -1;
+        char c = src[1];
+        src += 2;
+        switch (c) {
+            case '"': case '\\': case '/': dst[out++] = c; break;
+            case 'b': dst[out++] = '\b'; break;
+            case 'f': dst[out++] = '\f'; break;
+            case 'n': dst[out++] = '\n'; break;
+            case 'r': dst[out++] = '\r'; break;
+            case 't': dst[out++] = '\t'; break;
+            case 'u': {
+                unsigned long codepoint;
+                if (end - src < 4 || !nekos_json_hex4(src, &codepoint))
+                    return (size_t) -1;
+                src += 4;
+
+                // combine surrogate pairs
+                if (codepoint >= 0xD800 && codepoint <= 0xDBFF) {
+                    unsigned long low;
+                    if (end - src < 6 || src[0] != '\\' || src[1] != 'u' || !nekos_json_hex4(src + 2, &low) || low < 0xDC00 || low > 0xDFFF)
+                        return (size_t) -1;
+                    src += 6;
+                    codepoint = 0x10000 + ((codepoint - 0xD800) << 10) + (low - 0xDC00);
+                } else if (codepoint >= 0xDC00 && codepoint <= 0xDFFF) {
+                    return (size_t) -1;
+                }
+
+                // encode as utf-8
+                if (codepoint < 0x80) {
+                    dst[out++] = (char) codepoint;
+                } else if (codepoint < 0x800) {
+                    dst[out++] = (char) (0xC0 | (codepoint >> 6));
+                    dst[out++] = (char) (0x80 | (codepoint & 0x3F));
+                } else if (codepoint < 0x10000) {
+                    dst[out++] = (char) (0xE0 | (codepoint >> 12));
+                    dst[out++] = (char) (0x80 | ((codepoint >> 6) & 0x3F));
+                    dst[out++] = (char) (0x80 | (codepoint & 0x3F));
+                } else {
+                    dst[out++] = (char) (0xF0 | (codepoint >> 18));
+                    dst[out++] = (char) (0x80 | ((codepoint >> 12) & 0x3F));
+                    dst[out++] = (char) (0x80 | ((codepoint >> 6) & 0x3F));
+                    dst[out++] = (char) (0x80 | (codepoint & 0x3F));
+                }
+                break;
+            }
+            default:
+                return (size_t) -1;
+        }
+    }
+
+    return out;
+}
+
+static int nekos_json_skip(nekos_json_reader *reader, int depth) {
+    nekos_json_skip_whitespace(reader);
+    if (reader->pos >= reader->end || depth > NEKOS_JSON_MAX_DEPTH)
+        return 0;
+
+    char *str;
+    size_t len;
+    char open = *reader->pos;
+    if (open == '"')
+        return nekos_json_string(reader, &str, &len);
+
+    // skip nested objects and arrays
+    if (open == '{' || open == '[') {
+        char close = open == '{' ? '}' : ']';
+        reader->pos++;
+        if (nekos_json_consume(reader, close))
+            return 1;
+
+        do {
+            if (open == '{' && (!nekos_json_string(reader, &str, &len) || !nekos_json_consume(reader, ':')))
+                return 0;
+            if (!nekos_json_skip(reader, depth + 1))
+                return 0;
+        } while (nekos_json_consume(reader, ','));
+
+        return nekos_json_consume(reader, close);
+    }
+
+    // numbers and literals run until the next delimiter
+    char *start = reader->pos;
+    while (reader->pos < reader->end && !memchr(",}] \n\r\t", *reader->pos, 7))
+        reader->pos++;
+    return reader->pos > start;
+}
+
+static int nekos_json_member(nekos_json_reader *reader, int *first, char **key, size_t *key_len) {
+    // returns 1 for the next member of an object, 0 at its end and -1 on errors
+    if (nekos_json_consume(reader, '}'))
+        return 0;
+    if (!*first && !nekos_json_consume(reader, ','))
+        return -1;
+
+    *first = 0;
+    return nekos_json_string(reader, key, key_len) && nekos_json_consume(reader, ':') ? 1 : -1;
+}
+
+static int nekos_json_element(nekos_json_reader *reader, int *first) {
+    // returns 1 for the next element of an array, 0 at its end and -1 on errors
+    if (nekos_json_consume(reader, ']'))
+        return 0;
+    if (!*first && !nekos_json_consume(reader, ','))
+        return -1;
+
+    *first = 0;
+    return 1;
+}
+
+static int nekos_json_end(nekos_json_reader *reader) {
+    nekos_json_skip_whitespace(reader);
+    return reader->pos == reader->end;
+}
+
+typedef struct {
+    size_t offsets[4]; // offsets of the decoded strings in the response, 0 if missing
+    size_t lens[4];
+} nekos_result_fields;
+
+static int nekos_scan_result(nekos_json_reader *reader, char *text, const nekos_format format, nekos_result_fields *fields) {
+    const char **keys = format == NEKOS_GIF ? nekos_gif_keys : nekos_png_keys;
+    size_t key_count = format == NEKOS_GIF ? 2 : 4;
+    memset(fields, 0, sizeof(nekos_result_fields));
+    if (!nekos_json_consume(reader, '{'))
+        return 0;
+
+    int first = 1;
+    int member;
+    char *key;
+    size_t key_len;
+    while ((member = nekos_json_member(reader, &first, &key, &key_len)) == 1) {
+        size_t k;
+        for (k = 0; k < key_count && (strncmp(keys[k], key, key_len) != 0 || keys[k][key_len] != '\0'); k++);
+        if (k == key_count) {
+            if (!nekos_json_skip(reader, 0))
+                return 0;
+            continue;
+        }
+
+        // decode the string in place and terminate it, overwriting at most the closing quote
+        char *value;
+        size_t value_len;
+        if (!nekos_json_string(reader, &value, &value_len))
+            return 0;
+        size_t len = nekos_json_unescape(value, value, value_len);
+        if (len == (size_t) -1)
+            return 0;
+        value[len] = '\0';
+
+        fields->offsets[k] = (size_t) (value - text);
+        fields->lens[k] = len;
+    }
+
+    if (member < 0)
+        return 0;
+    for (size_t k = 0; k < key_count; k++)
+        if (!fields->offsets[k])
+            return 0;
+    return 1;
+}
+
+static nekos_status nekos_scan_results(nekos_json_reader *reader, char *text, const nekos_format format, nekos_result_fields **fields, size_t *count, size_t *capacity, nekos_result_fields *stack_fields) {
+    if (!nekos_json_consume(reader, '{'))
+        return NEKOS_CJSON_ERR;
+
+    // look for the results array, skipping everything else
+    int found = 0;
+    int first = 1;
+    int member;
+    char *key;
+    size_t key_len;
+    while ((member = nekos_json_member(reader, &first, &key, &key_len)) == 1) {
+        if (found || key_len != 7 || memcmp(key, "results", 7) != 0) {
+            if (!nekos_json_skip(reader, 0))
+                return NEKOS_CJSON_ERR;
+            continue;
+        }
+
+        found = 1;
+        if (!nekos_json_consume(reader, '['))
+            return NEKOS_CJSON_ERR;
+
+        int first_element = 1;
+        int element;
+        while ((element = nekos_json_element(reader, &first_element)) == 1) {
+            // grow past the stack buffer if the api ever returns more than expected
+            if (*count == *capacity) {
+                nekos_result_fields *grown = (nekos_result_fields*) (*fields == stack_fields
+                    ? nekos_malloc(*capacity * 2 * sizeof(nekos_result_fields))
+                    : nekos_realloc(*fields, *capacity * 2 * sizeof(nekos_result_fields)));
+                if (!grown)
+                    return NEKOS_MEM_ERR;
+                if (*fields == stack_fields)
+                    memcpy(grown, stack_fields, *count * sizeof(nekos_result_fields));
+                *fields = grown;
+                *capacity *= 2;
+            }
+
+            if (!nekos_scan_result(reader, text, format, &(*fields)[*count]))
+                return NEKOS_CJSON_ERR;
+            (*count)++;
+        }
+
+        if (element < 0)
+            return NEKOS_CJSON_ERR;
+    }
+
+    return member == 0 && found && nekos_json_end(reader) ? NEKOS_OK : NEKOS_CJSON_ERR;
+}
+
+static char* nekos_result_string(nekos_arena *arena, char *text, const nekos_result_fields *fields, size_t k, int zero_copy) {
+    char *value = text + fields->offsets[k];
+    if (zero_copy)
+        return value;
+
+    char *str = (char*) nekos_arena_alloc(arena, fields->lens[k] + 1);
+    if (str)
+        memcpy(str, value, fields->lens[k] + 1);
+    return str;
+}
+
+static nekos_status nekos_parse_results(int flags, nekos_result_list *results, nekos_http_response *http_response, const nekos_format format) {
+    curl_off_t start = nekos_now_us();
+
+    // scan response once, decoding strings in place
+    char *text = http_response->text;
+    nekos_json_reader reader;
+    reader.pos = text;
+    reader.end = text + http_response->len;
+
+    nekos_result_fields stack_fields[NEKOS_MAX_AMOUNT];
+    nekos_result_fields *fields = stack_fields;
+    size_t count = 0;
+    size_t capacity = NEKOS_MAX_AMOUNT;
+    nekos_status status = nekos_scan_results(&reader, text, format, &fields, &count, &capacity, stack_fields);
+
+    size_t key_count = format == NEKOS_GIF ? 2 : 4;
+    size_t source_size = format == NEKOS_GIF ? sizeof(nekos_source_gif) : sizeof(nekos_source_png);
+    int zero_copy = (flags & NEKOS_ZERO_COPY_RESULTS) != 0;
+    nekos_arena arena;
+    arena.base = NULL;
+    arena.used = 0;
+    if (status == NEKOS_OK && zero_copy) {
+        // keep the response and append the list to it
+        size_t base = NEKOS_ARENA_ALIGN(http_response->len);
+        char *block = (char*) nekos_realloc(text, base + NEKOS_ARENA_ALIGN(count * sizeof(nekos_result)) + count * NEKOS_ARENA_ALIGN(source_size));
+        if (block) {
+            text = block;
+            arena.base = block;
+            arena.used = base;
+        } else {
+            status = NEKOS_MEM_ERR;
+        }
+    } else if (status == NEKOS_OK && (flags & NEKOS_ARENA_RESULTS)) {
+        // allocate a block of exactly the size of the list
+        size_t size = NEKOS_ARENA_ALIGN(count * sizeof(nekos_result)) + count * NEKOS_ARENA_ALIGN(source_size);
+        for (size_t i = 0; i < count; i++)
+            for (size_t k = 0; k < key_count; k++)
+                size += NEKOS_ARENA_ALIGN(fields[i].lens[k] + 1);
+        arena.base = (char*) nekos_malloc(size ? size : 1);
+        if (!arena.base)
+            status = NEKOS_MEM_ERR;
+    }
+
+    results->arena = arena.base;
+    results->len = 0;
+    results->responses = NULL;
+    if (status == NEKOS_OK) {
+        results->responses = (nekos_result*) nekos_arena_alloc(&arena, count * sizeof(nekos_result));
+        if (!results->responses && count > 0)
+            status = NEKOS_MEM_ERR;
+    }
+
+    // fill results, only heap allocations can fail here
+    for (size_t i = 0; status == NEKOS_OK && i < count; i++) {
+        nekos_result *result = &results->responses[results->len++];
+        result->format = format;
+        result->url = NULL;
+        if (format == NEKOS_GIF) {
+            result->source.gif = (nekos_source_gif*) nekos_arena_alloc(&arena, sizeof(nekos_source_gif));
+            if (!result->source.gif) {
+                status = NEKOS_MEM_ERR;
+                break;
+            }
+            result->source.gif->anime_name = nekos_result_string(&arena, text, &fields[i], 1, zero_copy);
+        } else {
+            result->source.png = (nekos_source_png*) nekos_arena_alloc(&arena, sizeof(nekos_source_png));
+            if (!result->source.png) {
+                status = NEKOS_MEM_ERR;
+                break;
+            }
+            result->source.png->artist_name = nekos_result_string(&arena, text, &fields[i], 1, zero_copy);
+            result->source.png->artist_href = nekos_result_string(&arena, text, &fields[i], 2, zero_copy);
+            result->source.png->source_url = nekos_result_string(&arena, text, &fields[i], 3, zero_copy);
+        }
+        result->url = nekos_result_string(&arena, text, &fields[i], 0, zero_copy);
+
+        int complete = result->url && (format == NEKOS_GIF
+            ? result->source.gif->anime_name != NULL
+            : result->source.png->artist_name && result->source.png->artist_href && result->source.png->source_url);
+        if (!complete)
+            status = NEKOS_MEM_ERR;
+    }
+
+    // cleanup
+    if (fields != stack_fields)
+        nekos_free(fields);
+    if (status != NEKOS_OK) {
+        if (results->len > 0)
+            nekos_free_results(results);
+        else
+            nekos_free(arena.base);
+        if (arena.base != text)
+            nekos_free(text);
+    } else if (!zero_copy) {
+        nekos_free(text);
+    }
+
+    // report parse time on the response, and on the results if they were parsed
+    http_response->timing.parse_us = nekos_elapsed_us(start);
+    if (status == NEKOS_OK)
+        results->timing = http_response->timing;
+    return status;
+}
+
+static void nekos_share_lock(CURL *curl, curl_lock_data data, curl_lock_access access, void *userptr) {
+    (void) curl;
+    (void) access;
+    nekos_share *share = (nekos_share*) userptr;
+#ifdef _WIN32
+    EnterCriticalSection(&share->locks[data]);
+#else
+    pthread_mutex_lock(&share->locks[data]);
+#endif
+}
+
+static void nekos_share_unlock(CURL *curl, curl_lock_data data, void *userptr) {
+    (void) curl;
+    nekos_share *share = (nekos_share*) userptr;
+#ifdef _WIN32
+    LeaveCriticalSection(&share->locks[data]);
+#else
+    pthread_mutex_unlock(&share->locks[data]);
+#endif
+}
+
+nekos_status nekos_share_init(nekos_share *share) {
+    share->share = curl_share_init();
+    if (!share->share)
+        return NEKOS_LIBCURL_ERR;
+
+    for (int i = 0; i < CURL_LOCK_DATA_LAST; i++) {
+#ifdef _WIN32
+        InitializeCriticalSection(&share->locks[i]);
+#else
+        pthread_mutex_init(&share->locks[i], NULL);
+#endif
+    }
+
+    share->flights = NULL;
+#ifdef _WIN32
+    InitializeCriticalSection(&share->flight_lock);
+    InitializeConditionVariable(&share->flight_done);
+#else
+    pthread_mutex_init(&share->flight_lock, NULL);
+    pthread_cond_init(&share->flight_done, NULL);
+#endif
+
+    // share dns cache, tls sessions and connections between all users
+    CURLSHcode res = curl_share_setopt(share->share, CURLSHOPT_LOCKFUNC, nekos_share_lock);
+    if (res == CURLSHE_OK)
+        res = curl_share_setopt(share->share, CURLSHOPT_UNLOCKFUNC, nekos_share_unlock);
+    if (res == CURLSHE_OK)
+        res = curl_share_setopt(share->share, CURLSHOPT_USERDATA, share);
+    if (res == CURLSHE_OK)
+        res = curl_share_setopt(share->share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    if (res == CURLSHE_OK)
+        res = curl_share_setopt(share->share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    if (res == CURLSHE_OK)
+        res = curl_share_setopt(share->share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+    if (res != CURLSHE_OK) {
+        nekos_free_share(share);
+        return NEKOS_LIBCURL_ERR;
+    }
+
+    return NEKOS_OK;
+}
+
+void nekos_free_share(nekos_share *share) {
+    curl_share_cleanup(share->share);
+    share->share = NULL;
+    for (int i = 0; i < CURL_LOCK_DATA_LAST; i++) {
+#ifdef _WIN32
+        DeleteCriticalSection(&share->locks[i]);
+#else
+        pthread_mutex_destroy(&share->locks[i]);
+#endif
+    }
+
+#ifdef _WIN32
+    DeleteCriticalSection(&share->flight_lock);
+#else
+    pthread_mutex_destroy(&share->flight_lock);
+    pthread_cond_destroy(&share->flight_done);
+#endif
+}
+
+void nekos_free_client(nekos_client *client) {
+    curl_multi_cleanup(client->multi);
+    curl_easy_cleanup(client->curl);
+    curl_easy_cleanup(client->hedge);
+    client->multi = NULL;
+    client->curl = NULL;
+    client->hedge = NULL;
+}
+
+nekos_status nekos_client_init(nekos_client *client) {
+    client->curl = curl_easy_init();
+    client->multi = curl_multi_init();
+    client->flags = 0;
+    client->share = NULL;
+    client->search_cache = NULL;
+    client->rate_limiter = NULL;
+    client->hedge = NULL;
+    memset(&client->policy, 0, sizeof(nekos_request_policy));
+    memset(&client->stats, 0, sizeof(nekos_stats));
+    if (!client->curl || !client->multi) {
+        nekos_free_client(client);
+        return NEKOS_LIBCURL_ERR;
+    }
+
+    // multiplex parallel downloads if NEKOS_HTTP2 is set
+    curl_multi_setopt(client->multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+    return NEKOS_OK;
+}
+
+#ifdef _WIN32
+static INIT_ONCE nekos_default_client_once = INIT_ONCE_STATIC_INIT;
+static DWORD nekos_default_client_key = FLS_OUT_OF_INDEXES;
+#else
+static pthread_once_t nekos_default_client_once = PTHREAD_ONCE_INIT;
+static pthread_key_t nekos_default_client_key;
+static int nekos_default_client_key_ok = 0;
+#endif
+
+#ifdef _WIN32
+static void WINAPI nekos_free_default_client(void *data) {
+#else
+static void nekos_free_default_client(void *data) {
+#endif
+    if (!data)
+        return;
+
+    nekos_free_client((nekos_client*) data);
+    nekos_free(data);
+}
+
+#ifdef _WIN32
+static BOOL CALLBACK nekos_create_default_client_key(PINIT_ONCE once, PVOID param, PVOID *context) {
+    (void) once;
+    (void) param;
+    (void) context;
+    nekos_default_client_key = FlsAlloc(nekos_free_default_client);
+    return TRUE;
+}
+#else
+static void nekos_create_default_client_key(void) {
+    nekos_default_client_key_ok = pthread_key_create(&nekos_default_client_key, nekos_free_default_client) == 0;
+}
+#endif
+
+static nekos_client* nekos_get_default_client(void) {
+#ifdef _WIN32
+    InitOnceExecuteOnce(&nekos_default_client_once, nekos_create_default_client_key, NULL, NULL);
+    if (nekos_default_client_key == FLS_OUT_OF_INDEXES)
+        return NULL;
+    return (nekos_client*) FlsGetValue(nekos_default_client_key);
+#else
+    pthread_once(&nekos_default_client_once, nekos_create_default_client_key);
+    if (!nekos_default_client_key_ok)
+        return NULL;
+    return (nekos_client*) pthread_getspecific(nekos_default_client_key);
+#endif
+}
+
+static int nekos_set_default_client(nekos_client *client) {
+#ifdef _WIN32
+    return FlsSetValue(nekos_default_client_key, client) != 0;
+#else
+    return pthread_setspecific(nekos_default_client_key, client) == 0;
+#endif
+}
+
+nekos_client* nekos_default_client(void) {
+    // lazily initialize the default client of this thread
+    nekos_client *client = nekos_get_default_client();
+    if (client)
+        return client;
+
+#ifdef _WIN32
+    if (nekos_default_client_key == FLS_OUT_OF_INDEXES)
+        return NULL;
+#else
+    if (!nekos_default_client_key_ok)
+        return NULL;
+#endif
+
+    client = (nekos_client*) nekos_malloc(sizeof(nekos_client));
+    if (!client)
+        return NULL;
+    if (nekos_client_init(client) != NEKOS_OK) {
+        nekos_free(client);
+        return NULL;
+    }
+    if (!nekos_set_default_client(client)) {
+        nekos_free_default_client(client);
+        return NULL;
+    }
+
+    return client;
+}
+
+nekos_status nekos_global_init(void) {
+    return curl_global_init(CURL_GLOBAL_DEFAULT) == CURLE_OK ? NEKOS_OK : NEKOS_LIBCURL_ERR;
+}
+
+void nekos_global_cleanup(void) {
+    // libcurl handles must be cleaned up before libcurl itself
+    nekos_client *client = nekos_get_default_client();
+    if (client) {
+        nekos_set_default_client(NULL);
+        nekos_free_default_client(client);
+    }
+
+    curl_global_cleanup();
+}
+
+void nekos_client_get_stats(const nekos_client *client, nekos_stats *stats) {
+    *stats = client->stats;
+}
+
+nekos_status nekos_get_stats(nekos_stats *stats) {
+    nekos_client *client = nekos_default_client();
+    if (!client)
+        return NEKOS_LIBCURL_ERR;
+
+    nekos_client_get_stats(client, stats);
+    return NEKOS_OK;
+}
+
+void nekos_client_reset_stats(nekos_client *client) {
+    memset(&client->stats, 0, sizeof(nekos_stats));
+}
+
+unsigned long long nekos_stats_percentile(const nekos_call_stats *stats, double percentile) {
+    unsigned long long total = 0;
+    for (size_t i = 0; i < NEKOS_STATS_BUCKETS; i++)
+        total += stats->histogram[i];
+    if (total == 0)
+        return 0;
+
+    // find the bucket containing the requested rank
+    double rank = percentile / 100.0 * (double) total;
+    unsigned long long seen = 0;
+    size_t bucket = 0;
+    for (; bucket < NEKOS_STATS_BUCKETS - 1; bucket++) {
+        seen += stats->histogram[bucket];
+        if ((double) seen >= rank && seen > 0)
+            break;
+    }
+
+    return 1ull << bucket;
+}
+
+static nekos_status nekos_scan_endpoints(nekos_json_reader *reader, nekos_endpoint_list* endpoints) {
+    if (!nekos_json_consume(reader, '{'))
+        return NEKOS_CJSON_ERR;
+
+    size_t capacity = 64;
+    endpoints->endpoints = (nekos_endpoint*) nekos_malloc(capacity * sizeof(nekos_endpoint));
+    if (!endpoints->endpoints)
+        return NEKOS_MEM_ERR;
+
+    // every member is an endpoint object keyed by its name
+    int first = 1;
+    int member;
+    char *key;
+    size_t key_len;
+    while ((member = nekos_json_member(reader, &first, &key, &key_len)) == 1) {
+        if (endpoints->len == capacity) {
+            capacity *= 2;
+            nekos_endpoint *grown = (nekos_endpoint*) nekos_realloc(endpoints->endpoints, capacity * sizeof(nekos_endpoint));
+            if (!grown)
+                return NEKOS_MEM_ERR;
+            endpoints->endpoints = grown;
+        }
+
+        // decode name, the response is left untouched
+        char *name = (char*) nekos_malloc(key_len + 1);
+        if (!name)
+            return NEKOS_MEM_ERR;
+        size_t name_len = nekos_json_unescape(name, key, key_len);
+        if (name_len == (size_t) -1) {
+            nekos_free(name);
+            return NEKOS_CJSON_ERR;
+        }
+        name[name_len] = '\0';
+
+        nekos_endpoint *endpoint = &endpoints->endpoints[endpoints->len++];
+        endpoint->name = name;
+
+        // read format, skipping everything else
+        int format = -1;
+        int first_field = 1;
+        int field;
+        if (!nekos_json_consume(reader, '{'))
+            return NEKOS_CJSON_ERR;
+        while ((field = nekos_json_member(reader, &first_field, &key, &key_len)) == 1) {
+            if (key_len != 6 || memcmp(key, "format", 6) != 0) {
+                if (!nekos_json_skip(reader, 0))
+                    return NEKOS_CJSON_ERR;
+                continue;
+            }
+
+            char *value;
+            size_t value_len;
+            if (!nekos_json_string(reader, &value, &value_len))
+                return NEKOS_CJSON_ERR;
+            format = value_len == 3 && memcmp(value, "png", 3) == 0 ? NEKOS_PNG : NEKOS_GIF;
+        }
+
+        if (field < 0 || format < 0)
+            return NEKOS_CJSON_ERR;
+        endpoint->format = (nekos_format) format;
+    }
+
+    return member == 0 && nekos_json_end(reader) ? NEKOS_OK : NEKOS_CJSON_ERR;
+}
+
+static nekos_status nekos_parse_endpoints(nekos_endpoint_list* endpoints, const nekos_http_response *http_response) {
+    // scan response once
+    nekos_json_reader reader;
+    reader.pos = http_response->text;
+    reader.end = http_response->text + http_response->len;
+    endpoints->endpoints = NULL;
+    endpoints->len = 0;
+    nekos_status status = nekos_scan_endpoints(&reader, endpoints);
+    if (status != NEKOS_OK) {
+        nekos_free_endpoints(endpoints);
+        return status;
+    }
+
+    return NEKOS_OK;
+}
+
+nekos_status nekos_client_endpoints(nekos_client *client, nekos_endpoint_list* endpoints) {
+    // make request
+    nekos_http_response http_response;
+    nekos_status http_status = nekos_coalesced_request(client, NEKOS_STATS_ENDPOINTS, &http_response, NEKOS_BASE_URL "endpoints");
+    if (http_status != NEKOS_OK) {
+        nekos_record_stats(&client->stats, NEKOS_STATS_ENDPOINTS, http_status, &http_response.timing);
+        return http_status;
+    }
+
+    // parse response
+    curl_off_t start = nekos_now_us();
+    nekos_status status = nekos_parse_endpoints(endpoints, &http_response);
+    http_response.timing.parse_us = nekos_elapsed_us(start);
+    nekos_record_stats(&client->stats, NEKOS_STATS_ENDPOINTS, status, &http_response.timing);
+    nekos_free(http_response.text);
+    return status;
+}
+
+/// First line of an endpoint cache file.
+#define NEKOS_CACHE_MAGIC "nekos-endpoints-cache 1"
+
+typedef struct {
+    long long fetched;
+    char etag[256];
+    char last_modified[256];
+    nekos_http_response body;
+} nekos_endpoint_cache;
+
+static int nekos_read_cache_line(FILE *file, const char* key, char *value, size_t size) {
+    char line[512];
+    if (!fgets(line, sizeof(line), file))
+        return 0;
+
+    // expect "<key> <value>"
+    size_t key_len = strlen(key);
+    if (strncmp(line, key, key_len) != 0 || line[key_len] != ' ')
+        return 0;
+
+    line[strcspn(line, "\r\n")] = '\0';
+    snprintf(value, size, "%s", line + key_len + 1);
+    return 1;
+}
+
+static int nekos_read_endpoint_cache(const char* path, nekos_endpoint_cache *cache) {
+    cache->body.text = NULL;
+    cache->body.len = 0;
+
+    FILE *file = fopen(path, "rb");
+    if (!file)
+        return 0;
+
+    // read header
+    char magic[64];
+    char fetched[32];
+    int valid = fgets(magic, sizeof(magic), file) && strncmp(magic, NEKOS_CACHE_MAGIC "\n", sizeof(NEKOS_CACHE_MAGIC)) == 0
+        && nekos_read_cache_line(file, "fetched", fetched, sizeof(fetched))
+        && nekos_read_cache_line(file, "etag", cache->etag, sizeof(cache->etag))
+        && nekos_read_cache_line(file, "last-modified", cache->last_modified, sizeof(cache->last_modified));
+
+    // read body
+    long start = ftell(file);
+    long end = -1;
+    if (valid && start >= 0 && fseek(file, 0, SEEK_END) == 0)
+        end = ftell(file);
+    if (end >= start && start >= 0 && fseek(file, start, SEEK_SET) == 0) {
+        cache->body.len = (size_t) (end - start);
+        cache->body.text = (char*) nekos_malloc(cache->body.len + 1);
+        if (!cache->body.text || fread(cache->body.text, 1, cache->body.len, file) != cache->body.len) {
+            nekos_free(cache->body.text);
+            cache->body.text = NULL;
+        }
+    }
+    fclose(file);
+
+    if (!cache->body.text)
+        return 0;
+
+    cache->fetched = strtoll(fetched, NULL, 10);
+    return 1;
+}
+
+static nekos_status nekos_create_temp_file(const char* path, const char* suffix, char **tmp_path, int *fd) {
+    size_t len = strlen(path) + strlen(suffix) + 48;
+    *tmp_path = (char*) nekos_malloc(len);
+    if (!*tmp_path)
+        return NEKOS_MEM_ERR;
+
+    // a fresh name for every call, created exclusively so that concurrent writers never share a file
+    unsigned long long seed = (unsigned long long) nekos_now_us() ^ (unsigned long long) (size_t) *tmp_path;
+    for (int attempt = 0; attempt < 16; attempt++) {
+        seed += 0x9e3779b97f4a7c15ull;
+        unsigned long long x = seed;
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+        x ^= x >> 31;
+
+#ifdef _WIN32
+        snprintf(*tmp_path, len, "%s.%ld.%016llx%s", path, (long) _getpid(), x, suffix);
+        *fd = _open(*tmp_path, _O_WRONLY | _O_CREAT | _O_EXCL | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+        snprintf(*tmp_path, len, "%s.%ld.%016llx%s", path, (long) getpid(), x, suffix);
+        *fd = open(*tmp_path, O_WRONLY | O_CREAT | O_EXCL, 0644);
+#endif
+        if (*fd >= 0)
+            return NEKOS_OK;
+        if (errno != EEXIST)
+            break;
+    }
+
+    nekos_free(*tmp_path);
+    *tmp_path = NULL;
+    return NEKOS_IO_ERR;
+}
+
+static void nekos_write_endpoint_cache(const char* path, const nekos_endpoint_cache *cache, const nekos_http_response *body) {
+    char header[640];
+    int header_len = snprintf(header, sizeof(header), NEKOS_CACHE_MAGIC "\nfetched %lld\netag %s\nlast-modified %s\n", cache->fetched, cache->etag, cache->last_modified);
+    if (header_len <= 0 || (size_t) header_len >= sizeof(header))
+        return;
+
+    // write to a temporary file of our own first so readers never see a partial cache
+    char *tmp_path;
+    nekos_sink sink;
+    sink.type = NEKOS_SINK_FD;
+    if (nekos_create_temp_file(path, ".tmp", &tmp_path, &sink.fd) != NEKOS_OK)
+        return;
+
+    nekos_sink_state state;
+    state.sink = &sink;
+    state.failed = 0;
+    int ok = nekos_sink_callback(header, 1, (size_t) header_len, &state) == (size_t) header_len
+        && (body->len == 0 || nekos_sink_callback(body->text, 1, body->len, &state) == body->len);
+#ifdef _WIN32
+    ok = _close(sink.fd) == 0 && ok;
+#else
+    ok = close(sink.fd) == 0 && ok;
+#endif
+
+#ifdef _WIN32
+    if (ok)
+        remove(path);
+#endif
+    if (!ok || rename(tmp_path, path) != 0)
+        remove(tmp_path);
+    nekos_free(tmp_path);
+}
+
+static void nekos_copy_header(CURL *curl, const char* name, char *value, size_t size) {
+    struct curl_header *header;
+    value[0] = '\0';
+    if (curl_easy_header(curl, name, 0, CURLH_HEADER, -1, &header) == CURLHE_OK && strlen(header->value) < size)
+        strcpy(value, header->value);
+}
+
+nekos_status nekos_client_endpoints_cached(nekos_client *client, nekos_endpoint_list* endpoints, const char* cache_path, long ttl) {
+    nekos_endpoint_cache cache;
+    int cached = nekos_read_endpoint_cache(cache_path, &cache);
+    long long now = (long long) time(NULL);
+
+    // serve fresh cache without network io
+    if (cached && now - cache.fetched < ttl) {
+        nekos_status status = nekos_parse_endpoints(endpoints, &cache.body);
+        if (status == NEKOS_OK) {
+            nekos_free(cache.body.text);
+            return NEKOS_OK;
+        }
+
+        // corrupt cache, fetch unconditionally
+        nekos_free(cache.body.text);
+        cache.body.text = NULL;
+        cached = 0;
+    }
+
+    // revalidate stale cache
+    struct curl_slist *headers = NULL;
+    char header_line[300];
+    if (cached && cache.etag[0]) {
+        snprintf(header_line, sizeof(header_line), "If-None-Match: %s", cache.etag);
+        headers = curl_slist_append(headers, header_line);
+    }
+    if (cached && cache.last_modified[0]) {
+        snprintf(header_line, sizeof(header_line), "If-Modified-Since: %s", cache.last_modified);
+        headers = curl_slist_append(headers, header_line);
+    }
+
+    // make request
+    nekos_http_response http_response;
+    nekos_status http_status = nekos_do_request_with_headers(client, NEKOS_STATS_ENDPOINTS, &http_response, NEKOS_BASE_URL "endpoints", headers);
+    curl_slist_free_all(headers);
+    if (http_status != NEKOS_OK) {
+        nekos_record_stats(&client->stats, NEKOS_STATS_ENDPOINTS, http_status, &http_response.timing);
+        nekos_free(cache.body.text);
+        return http_status;
+    }
+
+    long response_code = 0;
+    curl_easy_getinfo(client->curl, CURLINFO_RESPONSE_CODE, &response_code);
+
+    // cache is still valid, refresh its timestamp
+    curl_off_t start = nekos_now_us();
+    if (cached && response_code == 304) {
+        nekos_free(http_response.text);
+        nekos_status status = nekos_parse_endpoints(endpoints, &cache.body);
+        http_response.timing.parse_us = nekos_elapsed_us(start);
+        nekos_record_stats(&client->stats, NEKOS_STATS_ENDPOINTS, status, &http_response.timing);
+        if (status == NEKOS_OK) {
+            cache.fetched = now;
+            nekos_write_endpoint_cache(cache_path, &cache, &cache.body);
+        }
+        nekos_free(cache.body.text);
+        return status;
+    }
+    nekos_free(cache.body.text);
+
+    // parse response and store it for the next start
+    nekos_status status = nekos_parse_endpoints(endpoints, &http_response);
+    http_response.timing.parse_us = nekos_elapsed_us(start);
+    nekos_record_stats(&client->stats, NEKOS_STATS_ENDPOINTS, status, &http_response.timing);
+    if (status == NEKOS_OK && response_code == 200) {
+        cache.fetched = now;
+        nekos_copy_header(client->curl, "ETag", cache.etag, sizeof(cache.etag));
+        nekos_copy_header(client->curl, "Last-Modified", cache.last_modified, sizeof(cache.last_modified));
+        nekos_write_endpoint_cache(cache_path, &cache, &http_response);
+    }
+
+    nekos_free(http_response.text);
+    return status;
+}
+
+static size_t nekos_hash(const char* str) {
+    // fnv-1a
+    size_t hash = (size_t) 2166136261u;
+    for (; *str; str++) {
+        hash ^= (unsigned char) *str;
+        hash *= (size_t) 16777619u;
+    }
+
+    return hash;
+}
+
+struct nekos_search_cache_entry {
+    char *key; // normalized search parameters
+    size_t hash;
+    nekos_result_list results; // private arena copy of the results
+    curl_off_t expires_us;
+    size_t chain; // next entry in the same bucket, or next free entry
+    size_t newer; // neighbours in recency order
+    size_t older;
+};
+
+nekos_status nekos_search_cache_init(nekos_search_cache *cache, size_t capacity, long ttl_ms) {
+    if (capacity == 0 || ttl_ms < 0)
+        return NEKOS_INVALID_PARAM_ERR;
+
+    // keep chains short with at least one bucket per entry
+    size_t bucket_count = 8;
+    while (bucket_count < capacity)
+        bucket_count *= 2;
+
+    cache->entries = (nekos_search_cache_entry*) nekos_malloc(capacity * sizeof(nekos_search_cache_entry));
+    cache->buckets = (size_t*) nekos_malloc(bucket_count * sizeof(size_t));
+    if (!cache->entries || !cache->buckets) {
+        nekos_free(cache->entries);
+        nekos_free(cache->buckets);
+        return NEKOS_MEM_ERR;
+    }
+    memset(cache->buckets, 0, bucket_count * sizeof(size_t));
+
+    // thread all entries onto the free list
+    for (size_t i = 0; i < capacity; i++)
+        cache->entries[i].chain = i + 1 < capacity ? i + 2 : 0;
+
+    cache->capacity = capacity;
+    cache->ttl_ms = ttl_ms;
+    cache->hits = 0;
+    cache->misses = 0;
+    cache->len = 0;
+    cache->bucket_count = bucket_count;
+    cache->free = 1;
+    cache->newest = 0;
+    cache->oldest = 0;
+    return NEKOS_OK;
+}
+
+static double nekos_log2(double x) {
+    // integer part by scaling into [1, 2), then the fraction bit by bit by squaring
+    double result = 0;
+    while (x < 1) {
+        x *= 2;
+        result -= 1;
+    }
+    while (x >= 2) {
+        x /= 2;
+        result += 1;
+    }
+
+    double bit = 0.5;
+    for (int i = 0; i < 32; i++, bit /= 2) {
+        x *= x;
+        if (x >= 2) {
+            x /= 2;
+            result += bit;
+        }
+    }
+
+    return result;
+}
+
+nekos_status nekos_seen_filter_init(nekos_seen_filter *filter, size_t capacity, double false_positive_rate) {
+    if (capacity == 0 || !(false_positive_rate > 0 && false_positive_rate < 1))
+        return NEKOS_INVALID_PARAM_ERR;
+
+    // optimal size is n * log2(1 / p) / ln 2 bits with log2(1 / p) hashes
+    double bits_per_url = -nekos_log2(false_positive_rate);
+    double bit_count = (double) capacity * bits_per_url * 1.4426950408889634;
+    if (bit_count > 4294967295.0)
+        return NEKOS_INVALID_PARAM_ERR; // indexes are 32-bit
+
+    filter->bit_count = ((size_t) bit_count + 8) & ~(size_t) 7;
+    filter->hash_count = (unsigned int) (bits_per_url + 0.5);
+    if (filter->hash_count < 1)
+        filter->hash_count = 1;
+    filter->bits = (unsigned char*) nekos_malloc(filter->bit_count / 8);
+    if (!filter->bits)
+        return NEKOS_MEM_ERR;
+    memset(filter->bits, 0, filter->bit_count / 8);
+
+    filter->capacity = capacity;
+    filter->len = 0;
+    filter->set_bits = 0;
+    return NEKOS_OK;
+}
+
+static unsigned long long nekos_seen_hash(const char* url) {
+    // fnv-1a, finished with the splitmix64 mixer to spread the bits
+    unsigned long long hash = 14695981039346656037ull;
+    for (; *url; url++) {
+        hash ^= (unsigned char) *url;
+        hash *= 1099511628211ull;
+    }
+
+    hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9ull;
+    hash = (hash ^ (hash >> 27)) * 0x94d049bb133111ebull;
+    return hash ^ (hash >> 31);
+}
+
+static size_t nekos_seen_bit(const nekos_seen_filter *filter, unsigned long long hash, unsigned int i) {
+    // double hashing, mapped onto the bit array by a multiply and shift
+    unsigned long long probe = (hash & 0xffffffffull) + (unsigned long long) i * ((hash >> 32) | 1);
+    return (size_t) (((probe & 0xffffffffull) * filter->bit_count) >> 32);
+}
+
+void nekos_seen_filter_add(nekos_seen_filter *filter, const char* url) {
+    unsigned long long hash = nekos_seen_hash(url);
+    for (unsigned int i = 0; i < filter->hash_count; i++) {
+        size_t bit = nekos_seen_bit(filter, hash, i);
+        unsigned char mask = (unsigned char) (1u << (bit & 7));
+        if (!(filter->bits[bit / 8] & mask)) {
+            filter->bits[bit / 8] |= mask;
+            filter->set_bits++;
+        }
+    }
+
+    filter->len++;
+}
+
+int nekos_seen_filter_contains(const nekos_seen_filter *filter, const char* url) {
+    unsigned long long hash = nekos_seen_hash(url);
+    for (unsigned int i = 0; i < filter->hash_count; i++) {
+        size_t bit = nekos_seen_bit(filter, hash, i);
+        if (!(filter->bits[bit / 8] & (1u << (bit & 7))))
+            return 0;
+    }
+
+    return 1;
+}
+
+size_t nekos_seen_filter_memory(const nekos_seen_filter *filter) {
+    return filter->bit_count / 8;
+}
+
+double nekos_seen_filter_false_positive_rate(const nekos_seen_filter *filter) {
+    double fill = (double) filter->set_bits / (double) filter->bit_count;
+    double rate = 1;
+    for (unsigned int i = 0; i < filter->hash_count; i++)
+        rate *= fill;
+    return rate;
+}
+
+/// Size of the buffer holding the normalized parameters of a search.
+#define NEKOS_SEARCH_KEY_SIZE 512
+
+static int nekos_search_key(char *key, const char* raw_query, int amount, const nekos_format format, const nekos_endpoint *endpoint) {
+    int len = snprintf(key, NEKOS_SEARCH_KEY_SIZE, "%d %d %s\n", format, amount, endpoint ? endpoint->name : "");
+    if (len <= 0 || len >= NEKOS_SEARCH_KEY_SIZE)
+        return 0;
+
+    // append the query trimmed, with single spaces and in lower case
+    size_t pos = (size_t) len;
+    int space = 0;
+    for (const char* c = raw_query; *c; c++) {
+        if (*c == ' ' || (*c >= '\t' && *c <= '\r')) {
+            space = pos > (size_t) len;
+            continue;
+        }
+        if (pos + space + 1 >= NEKOS_SEARCH_KEY_SIZE)
+            return 0;
+        if (space)
+            key[pos++] = ' ';
+        key[pos++] = (*c >= 'A' && *c <= 'Z') ? (char) (*c - 'A' + 'a') : *c;
+        space = 0;
+    }
+    key[pos] = '\0';
+    return 1;
+}
+
+static void nekos_search_cache_unlink(nekos_search_cache *cache, size_t index) {
+    nekos_search_cache_entry *entry = &cache->entries[index - 1];
+
+    // unlink from recency order
+    if (entry->newer)
+        cache->entries[entry->newer - 1].older = entry->older;
+    else
+        cache->newest = entry->older;
+    if (entry->older)
+        cache->entries[entry->older - 1].newer = entry->newer;
+    else
+        cache->oldest = entry->newer;
+}
+
+static void nekos_search_cache_push(nekos_search_cache *cache, size_t index) {
+    nekos_search_cache_entry *entry = &cache->entries[index - 1];
+
+    // make entry the most recently used one
+    entry->newer = 0;
+    entry->older = cache->newest;
+    if (cache->newest)
+        cache->entries[cache->newest - 1].newer = index;
+    else
+        cache->oldest = index;
+    cache->newest = index;
+}
+
+static void nekos_search_cache_remove(nekos_search_cache *cache, size_t index) {
+    nekos_search_cache_entry *entry = &cache->entries[index - 1];
+
+    // unlink from bucket
+    size_t *link = &cache->buckets[entry->hash & (cache->bucket_count - 1)];
+    while (*link != index)
+        link = &cache->entries[*link - 1].chain;
+    *link = entry->chain;
+
+    nekos_search_cache_unlink(cache, index);
+    nekos_free(entry->key);
+    nekos_free_results(&entry->results);
+
+    entry->chain = cache->free;
+    cache->free = index;
+    cache->len--;
+}
+
+static size_t nekos_search_cache_find(nekos_search_cache *cache, const char* key, size_t hash) {
+    for (size_t index = cache->buckets[hash & (cache->bucket_count - 1)]; index; index = cache->entries[index - 1].chain) {
+        nekos_search_cache_entry *entry = &cache->entries[index - 1];
+        if (entry->hash == hash && strcmp(entry->key, key) == 0)
+            return index;
+    }
+
+    return 0;
+}
+
+static nekos_status nekos_copy_results(nekos_result_list *copy, const nekos_result_list *results) {
+    // measure the whole list to place it in a single block
+    size_t size = NEKOS_ARENA_ALIGN(results->len * sizeof(nekos_result));
+    for (size_t i = 0; i < results->len; i++) {
+        const nekos_result *result = &results->responses[i];
+        size += NEKOS_ARENA_ALIGN((result->url ? strlen(result->url) : 0) + 1);
+        if (result->format == NEKOS_GIF) {
+            size += NEKOS_ARENA_ALIGN(sizeof(nekos_source_gif));
+            size += NEKOS_ARENA_ALIGN((result->source.gif->anime_name ? strlen(result->source.gif->anime_name) : 0) + 1);
+        } else {
+            size += NEKOS_ARENA_ALIGN(sizeof(nekos_source_png));
+            size += NEKOS_ARENA_ALIGN((result->source.png->artist_name ? strlen(result->source.png->artist_name) : 0) + 1);
+            size += NEKOS_ARENA_ALIGN((result->source.png->artist_href ? strlen(result->source.png->artist_href) : 0) + 1);
+            size += NEKOS_ARENA_ALIGN((result->source.png->source_url ? strlen(result->source.png->source_url) : 0) + 1);
+        }
+    }
+
+    nekos_arena arena;
+    arena.base = (char*) nekos_malloc(size ? size : 1);
+    arena.used = 0;
+    if (!arena.base)
+        return NEKOS_MEM_ERR;
+
+    copy->arena = arena.base;
+    copy->len = results->len;
+    copy->timing = results->timing;
+    copy->responses = (nekos_result*) nekos_arena_alloc(&arena, results->len * sizeof(nekos_result));
+    for (size_t i = 0; i < results->len; i++) {
+        const nekos_result *result = &results->responses[i];
+        nekos_result *copied = &copy->responses[i];
+        copied->format = result->format;
+        copied->url = nekos_arena_strdup(&arena, result->url);
+        if (result->format == NEKOS_GIF) {
+            copied->source.gif = (nekos_source_gif*) nekos_arena_alloc(&arena, sizeof(nekos_source_gif));
+            copied->source.gif->anime_name = nekos_arena_strdup(&arena, result->source.gif->anime_name);
+        } else {
+            copied->source.png = (nekos_source_png*) nekos_arena_alloc(&arena, sizeof(nekos_source_png));
+            copied->source.png->artist_name = nekos_arena_strdup(&arena, result->source.png->artist_name);
+            copied->source.png->artist_href = nekos_arena_strdup(&arena, result->source.png->artist_href);
+            copied->source.png->source_url = nekos_arena_strdup(&arena, result->source.png->source_url);
+        }
+    }
+
+    return NEKOS_OK;
+}
+
+static int nekos_search_cache_get(nekos_search_cache *cache, nekos_result_list *results, const char* key) {
+    size_t hash = nekos_hash(key);
+    size_t index = nekos_search_cache_find(cache, key, hash);
+    if (index && cache->entries[index - 1].expires_us <= nekos_now_us()) {
+        nekos_search_cache_remove(cache, index);
+        index = 0;
+    }
+
+    // a failed copy falls back to a request
+    if (!index || nekos_copy_results(results, &cache->entries[index - 1].results) != NEKOS_OK) {
+        cache->misses++;
+        return 0;
+    }
+
+    // served without a request
+    memset(&results->timing, 0, sizeof(nekos_timing));
+    nekos_search_cache_unlink(cache, index);
+    nekos_search_cache_push(cache, index);
+    cache->hits++;
+    return 1;
+}
+
+static void nekos_search_cache_put(nekos_search_cache *cache, const nekos_result_list *results, const char* key) {
+    size_t hash = nekos_hash(key);
+    size_t index = nekos_search_cache_find(cache, key, hash);
+    if (index)
+        nekos_search_cache_remove(cache, index);
+
+    // evict the least recently used entry when full
+    if (!cache->free)
+        nekos_search_cache_remove(cache, cache->oldest);
+
+    index = cache->free;
+    nekos_search_cache_entry *entry = &cache->entries[index - 1];
+    size_t key_len = strlen(key) + 1;
+    entry->key = (char*) nekos_malloc(key_len);
+    if (!entry->key)
+        return;
+    if (nekos_copy_results(&entry->results, results) != NEKOS_OK) {
+        nekos_free(entry->key);
+        return;
+    }
+    memcpy(entry->key, key, key_len);
+
+    // move entry from the free list into its bucket
+    cache->free = entry->chain;
+    size_t *bucket = &cache->buckets[hash & (cache->bucket_count - 1)];
+    entry->hash = hash;
+    entry->expires_us = nekos_now_us() + (curl_off_t) cache->ttl_ms * 1000;
+    entry->chain = *bucket;
+    *bucket = index;
+    nekos_search_cache_push(cache, index);
+    cache->len++;
+}
+
+void nekos_free_search_cache(nekos_search_cache *cache) {
+    while (cache->oldest)
+        nekos_search_cache_remove(cache, cache->oldest);
+
+    nekos_free(cache->entries);
+    nekos_free(cache->buckets);
+    cache->entries = NULL;
+    cache->buckets = NULL;
+}
+
+void nekos_free_seen_filter(nekos_seen_filter *filter) {
+    nekos_free(filter->bits);
+    filter->bits = NULL;
+}
+
+nekos_status nekos_index_endpoints(nekos_endpoint_index *index, const nekos_endpoint_list* endpoints) {
+    index->endpoints = endpoints->endpoints;
+    index->buckets = NULL;
+    index->bucket_count = 0;
+
+    // keep load factor at or below 1/2
+    size_t bucket_count = 8;
+    while (bucket_count < endpoints->len * 2)
+        bucket_count *= 2;
+
+    size_t *buckets = (size_t*) nekos_malloc(bucket_count * sizeof(size_t));
+    if (!buckets)
+        return NEKOS_MEM_ERR;
+    memset(buckets, 0, bucket_count * sizeof(size_t));
+
+    // insert endpoints with linear probing
+    for (size_t i = 0; i < endpoints->len; i++) {
+        size_t bucket = nekos_hash(endpoints->endpoints[i].name) & (bucket_count - 1);
+        while (buckets[bucket])
+            bucket = (bucket + 1) & (bucket_count - 1);
+
+        buckets[bucket] = i + 1;
+    }
+
+    index->buckets = buckets;
+    index->bucket_count = bucket_count;
+    return NEKOS_OK;
+}
+
+nekos_endpoint* nekos_find_indexed_endpoint(const nekos_endpoint_index *index, const char* name) {
+    // probe until an empty bucket
+    size_t mask = index->bucket_count - 1;
+    for (size_t bucket = nekos_hash(name) & mask; index->buckets[bucket]; bucket = (bucket + 1) & mask) {
+        nekos_endpoint *endpoint = &index->endpoints[index->buckets[bucket] - 1];
+        if (strcmp(endpoint->name, name) == 0)
+            return endpoint;
+    }
+
+    return NULL;
+}
+
+nekos_endpoint* nekos_find_endpoint(const nekos_endpoint_list* endpoints, const char* name) {
+    for (size_t i = 0; i < endpoints->len; i++) {
+        if (strcmp(endpoints->endpoints[i].name, name) == 0)
+            return &endpoints->endpoints[i];
+    }
+
+    return NULL;
+}
+
+nekos_status nekos_endpoints(nekos_endpoint_list* endpoints) {
+    nekos_client *client = nekos_default_client();
+    if (!client)
+        return NEKOS_LIBCURL_ERR;
+
+    return nekos_client_endpoints(client, endpoints);
+}
+
+nekos_status nekos_endpoints_cached(nekos_endpoint_list* endpoints, const char* cache_path, long ttl) {
+    nekos_client *client = nekos_default_client();
+    if (!client)
+        return NEKOS_LIBCURL_ERR;
+
+    return nekos_client_endpoints_cached(client, endpoints, cache_path, ttl);
+}
+
+/// Size of the buffer for api urls.
+#define NEKOS_URL_SIZE 256
+
+static nekos_status nekos_category_url(char *url, const nekos_endpoint *endpoint, int amount) {
+    // check if amount is valid
+    if (amount < 1 || amount > NEKOS_MAX_AMOUNT)
+        return NEKOS_INVALID_PARAM_ERR;
+
+    // create endpoint url
+    snprintf(url, NEKOS_URL_SIZE, NEKOS_BASE_URL "%s?amount=%d", endpoint->name, amount);
+    return NEKOS_OK;
+}
+
+nekos_status nekos_client_category(nekos_client *client, nekos_result_list *results, const nekos_endpoint *endpoint, int amount) {
+    char url[NEKOS_URL_SIZE];
+    nekos_status url_status = nekos_category_url(url, endpoint, amount);
+    if (url_status != NEKOS_OK)
+        return url_status;
+
+    // make request
+    nekos_http_response http_response;
+    nekos_status status = nekos_do_request(client, NEKOS_STATS_CATEGORY, &http_response, url);
+    if (status == NEKOS_OK)
+        status = nekos_parse_results(client->flags, results, &http_response, endpoint->format);
+
+    nekos_record_stats(&client->stats, NEKOS_STATS_CATEGORY, status, &http_response.timing);
+    return status;
+}
 
 nekos_status nekos_category(nekos_result_list *results, const nekos_endpoint *endpoint, int amount) {
+    nekos_client *client = nekos_default_client();
+    if (!client)
+        return NEKOS_LIBCURL_ERR;
+
+    return nekos_client_category(client, results, endpoint, amount);
+}
+
+nekos_status nekos_client_category_unique(nekos_client *client, nekos_result_list *results, const nekos_endpoint *endpoint, int amount, nekos_seen_filter *filter) {
+    // check if amount is valid
+    if (amount < 1 || amount > NEKOS_MAX_AMOUNT)
+        return NEKOS_INVALID_PARAM_ERR;
+
+    // fetch full batches until enough unseen results were found
+    nekos_result_list batches[NEKOS_UNIQUE_MAX_REQUESTS];
+    nekos_result unseen[NEKOS_MAX_AMOUNT];
+    nekos_result_list found;
+    memset(&found, 0, sizeof(found));
+    found.responses = unseen;
+    size_t batch_count = 0;
+    nekos_status status = NEKOS_OK;
+    while (found.len < (size_t) amount && batch_count < NEKOS_UNIQUE_MAX_REQUESTS) {
+        status = nekos_client_category(client, &batches[batch_count], endpoint, NEKOS_MAX_AMOUNT);
+        if (status != NEKOS_OK)
+            break;
+
+        nekos_result_list *batch = &batches[batch_count++];
+        found.timing = batch->timing;
+        for (size_t i = 0; i < batch->len && found.len < (size_t) amount; i++) {
+            const nekos_result *result = &batch->responses[i];
+            if (!result->url || nekos_seen_filter_contains(filter, result->url))
+                continue;
+
+            // a batch may repeat a result of this call
+            size_t j = 0;
+            while (j < found.len && strcmp(unseen[j].url, result->url) != 0)
+                j++;
+            if (j == found.len)
+                unseen[found.len++] = *result;
+        }
+    }
+
+    // copy the unseen results out of their batches before freeing them
+    if (status == NEKOS_OK && found.len == 0)
+        status = NEKOS_EMPTY_ERR;
+    if (status == NEKOS_OK)
+        status = nekos_copy_results(results, &found);
+    if (status == NEKOS_OK)
+        for (size_t i = 0; i < found.len; i++)
+            nekos_seen_filter_add(filter, unseen[i].url);
+
+    for (size_t i = 0; i < batch_count; i++)
+        nekos_free_results(&batches[i]);
+    return status;
+}
+
+nekos_status nekos_category_unique(nekos_result_list *results, const nekos_endpoint *endpoint, int amount, nekos_seen_filter *filter) {
+    nekos_client *client = nekos_default_client();
+    if (!client)
+        return NEKOS_LIBCURL_ERR;
+
+    return nekos_client_category_unique(client, results, endpoint, amount, filter);
+}
+
+static nekos_status nekos_search_url(CURL *curl, char *url, const char* raw_query, int amount, const nekos_format format, const nekos_endpoint *endpoint) {
     // check if amount is valid
     if (amount < 1 || amount > NEKOS_MAX_AMOUNT)
         return NEKOS_INVALID_PARAM_ERR;
 
-    // create endpoint url
-    char url[96];
-    snprintf(url, 96, NEKOS_BASE_URL "%s?amount=%d", endpoint->name, amount);
+    // url encode query
+    char* query = curl_easy_escape(curl, raw_query, 0);
+    if (!query)
+        return NEKOS_MEM_ERR;
+
+    // check if query is valid
+    size_t query_len = strlen(query);
+    if (query_len < NEKOS_MIN_QUERY_LEN || query_len > NEKOS_MAX_QUERY_LEN) {
+        curl_free(query);
+        return NEKOS_INVALID_PARAM_ERR;
+    }
+
+    // create endpoint url
+    if (endpoint)
+        snprintf(url, NEKOS_URL_SIZE, NEKOS_BASE_URL "search?query=%s&type=%d&amount=%d&category=%s", query, format + 1, amount, endpoint->name);
+    else
+        snprintf(url, NEKOS_URL_SIZE, NEKOS_BASE_URL "search?query=%s&type=%d&amount=%d", query, format + 1, amount);
+
+    curl_free(query);
+    return NEKOS_OK;
+}
+
+nekos_status nekos_client_search(nekos_client *client, nekos_result_list *results, const char* raw_query, int amount, const nekos_format format, const nekos_endpoint *endpoint) {
+    // validate parameters first, so invalid searches don't count as cache misses
+    char url[NEKOS_URL_SIZE];
+    nekos_status url_status = nekos_search_url(client->curl, url, raw_query, amount, format, endpoint);
+    if (url_status != NEKOS_OK)
+        return url_status;
+
+    // serve from the cache
+    char key[NEKOS_SEARCH_KEY_SIZE];
+    int cacheable = client->search_cache && nekos_search_key(key, raw_query, amount, format, endpoint);
+    if (cacheable && nekos_search_cache_get(client->search_cache, results, key)) {
+        nekos_record_stats(&client->stats, NEKOS_STATS_SEARCH, NEKOS_OK, &results->timing);
+        return NEKOS_OK;
+    }
+
+    // make request
+    nekos_http_response http_response;
+    nekos_status status = nekos_coalesced_request(client, NEKOS_STATS_SEARCH, &http_response, url);
+    if (status == NEKOS_OK)
+        status = nekos_parse_results(client->flags, results, &http_response, format);
+    if (status == NEKOS_OK && cacheable)
+        nekos_search_cache_put(client->search_cache, results, key);
+
+    nekos_record_stats(&client->stats, NEKOS_STATS_SEARCH, status, &http_response.timing);
+    return status;
+}
+
+nekos_status nekos_search(nekos_result_list *results, const char* raw_query, int amount, const nekos_format format, const nekos_endpoint *endpoint) {
+    nekos_client *client = nekos_default_client();
+    if (!client)
+        return NEKOS_LIBCURL_ERR;
+
+    return nekos_client_search(client, results, raw_query, amount, format, endpoint);
+}
+
+nekos_status nekos_client_download(nekos_client *client, nekos_http_response *http_response, const char* url) {
+    nekos_status status = nekos_do_request(client, NEKOS_STATS_DOWNLOAD, http_response, url);
+    nekos_record_stats(&client->stats, NEKOS_STATS_DOWNLOAD, status, &http_response->timing);
+    return status;
+}
+
+nekos_status nekos_download(nekos_http_response *http_response, const char* url) {
+    nekos_client *client = nekos_default_client();
+    if (!client)
+        return NEKOS_LIBCURL_ERR;
+
+    return nekos_client_download(client, http_response, url);
+}
+
+nekos_status nekos_client_download_many(nekos_client *client, nekos_http_response *http_responses, nekos_status *statuses, const char **urls, size_t n, int max_parallel) {
+    // check if parallelism is valid
+    if (max_parallel < 0)
+        return NEKOS_INVALID_PARAM_ERR;
+
+    size_t limit = (max_parallel == 0 || (size_t) max_parallel > n) ? n : (size_t) max_parallel;
+
+    // initialize responses so that failed downloads can always be freed
+    for (size_t i = 0; i < n; i++) {
+        http_responses[i].text = NULL;
+        http_responses[i].len = 0;
+        memset(&http_responses[i].timing, 0, sizeof(nekos_timing));
+        statuses[i] = NEKOS_LIBCURL_ERR;
+    }
+
+    // keep track of active transfers
+    nekos_transfer *transfers = (nekos_transfer*) nekos_malloc((n ? n : 1) * sizeof(nekos_transfer));
+    if (!transfers)
+        return NEKOS_MEM_ERR;
+    memset(transfers, 0, (n ? n : 1) * sizeof(nekos_transfer));
+
+    CURLM *multi = client->multi;
+    size_t next = 0;
+    size_t active = 0;
+    CURLMcode mres = CURLM_OK;
+    while ((next < n || active > 0) && mres == CURLM_OK) {
+        // start transfers until the limit is reached
+        while (next < n && active < limit) {
+            size_t i = next++;
+            CURL *curl = curl_easy_init();
+            if (!curl)
+                continue;
+
+            statuses[i] = nekos_prepare_request(curl, client->flags, &client->policy, client->share, &transfers[i].buffer, &http_responses[i], urls[i]);
+            if (statuses[i] != NEKOS_OK) {
+                curl_easy_cleanup(curl);
+                continue;
+            }
+
+            // a handle that was not added never completes, so it must not count as active
+            curl_easy_setopt(curl, CURLOPT_PRIVATE, (void*) &transfers[i]);
+            if (curl_multi_add_handle(multi, curl) != CURLM_OK) {
+                curl_easy_cleanup(curl);
+                nekos_free(http_responses[i].text);
+                http_responses[i].text = NULL;
+                http_responses[i].len = 0;
+                statuses[i] = NEKOS_LIBCURL_ERR;
+                continue;
+            }
+            transfers[i].curl = curl;
+            active++;
+        }
+
+        // drive transfers
+        int running;
+        mres = curl_multi_perform(multi, &running);
+        if (mres == CURLM_OK && running)
+            mres = curl_multi_poll(multi, NULL, 0, 1000, NULL);
+
+        // collect finished transfers
+        CURLMsg *msg;
+        int queued;
+        while ((msg = curl_multi_info_read(multi, &queued))) {
+            if (msg->msg != CURLMSG_DONE)
+                continue;
+
+            char *private_data;
+            curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, &private_data);
+            size_t i = (size_t) ((nekos_transfer*) private_data - transfers);
+
+            if (msg->data.result != CURLE_OK) {
+                nekos_free(http_responses[i].text);
+                http_responses[i].text = NULL;
+                http_responses[i].len = 0;
+                statuses[i] = NEKOS_LIBCURL_ERR;
+            }
+
+            nekos_read_timing(transfers[i].curl, &http_responses[i].timing);
+            nekos_record_stats(&client->stats, NEKOS_STATS_DOWNLOAD, statuses[i], &http_responses[i].timing);
+            curl_multi_remove_handle(multi, transfers[i].curl);
+            curl_easy_cleanup(transfers[i].curl);
+            transfers[i].curl = NULL;
+            active--;
+        }
+    }
+
+    // abort remaining transfers if the multi handle failed
+    for (size_t i = 0; i < n; i++) {
+        if (!transfers[i].curl)
+            continue;
+
+        curl_multi_remove_handle(multi, transfers[i].curl);
+        curl_easy_cleanup(transfers[i].curl);
+        nekos_free(http_responses[i].text);
+        http_responses[i].text = NULL;
+        http_responses[i].len = 0;
+        statuses[i] = NEKOS_LIBCURL_ERR;
+    }
+    nekos_free(transfers);
+
+    // report first failed download
+    for (size_t i = 0; i < n; i++) {
+        if (statuses[i] != NEKOS_OK)
+            return statuses[i];
+    }
+
+    return NEKOS_OK;
+}
+
+nekos_status nekos_download_many(nekos_http_response *http_responses, nekos_status *statuses, const char **urls, size_t n, int max_parallel) {
+    nekos_client *client = nekos_default_client();
+    if (!client)
+        return NEKOS_LIBCURL_ERR;
+
+    return nekos_client_download_many(client, http_responses, statuses, urls, n, max_parallel);
+}
+
+/// Attempts per byte range of a ranged download, each resuming where the previous one stopped.
+#define NEKOS_RANGE_MAX_ATTEMPTS 3
+
+typedef struct {
+    size_t start;
+    size_t end; // exclusive
+    size_t received;
+    int attempts;
+    int done;
+    CURL *curl;
+    char *base;
+} nekos_range;
+
+typedef struct {
+    curl_off_t size;
+    int ranges; // server accepts byte ranges
+    char etag[256];
+} nekos_range_probe;
+
+static nekos_status nekos_probe_ranges(nekos_client *client, const char* url, nekos_range_probe *probe) {
+    CURL *curl = client->curl;
+    curl_easy_reset(curl);
+    nekos_setup_request(curl, client->flags, &client->policy, client->share, url);
+    curl_easy_setopt(curl, CURLOPT_NOBODY, 1L);
+    if (curl_easy_perform(curl) != CURLE_OK)
+        return NEKOS_LIBCURL_ERR;
+
+    long response_code = 0;
+    probe->size = -1;
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &response_code);
+    curl_easy_getinfo(curl, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &probe->size);
+
+    struct curl_header *header;
+    probe->ranges = response_code == 200 && curl_easy_header(curl, "accept-ranges", 0, CURLH_HEADER, -1, &header) == CURLHE_OK
+        && strstr(header->value, "bytes") != NULL;
+    probe->etag[0] = '\0';
+    if (curl_easy_header(curl, "etag", 0, CURLH_HEADER, -1, &header) == CURLHE_OK && strlen(header->value) < sizeof(probe->etag))
+        strcpy(probe->etag, header->value);
+    return NEKOS_OK;
+}
+
+static size_t nekos_range_callback(const void *ptr, size_t count, size_t nmemb, void *userdata) {
+    nekos_range *range = (nekos_range*) userdata;
+    size_t size = count * nmemb;
+
+    // a server ignoring the range would overwrite other ranges
+    long response_code = 0;
+    curl_easy_getinfo(range->curl, CURLINFO_RESPONSE_CODE, &response_code);
+    if (response_code != 206 || size > range->end - range->start - range->received)
+        return 0;
+
+    memcpy(range->base + range->start + range->received, ptr, size);
+    range->received += size;
+    return size;
+}
+
+static nekos_status nekos_start_range(nekos_client *client, nekos_range *range, const char* url) {
+    range->curl = curl_easy_init();
+    if (!range->curl)
+        return NEKOS_LIBCURL_ERR;
+
+    // resume after the bytes received by previous attempts
+    char bytes[64];
+    snprintf(bytes, sizeof(bytes), "%llu-%llu", (unsigned long long) (range->start + range->received), (unsigned long long) (range->end - 1));
+    nekos_setup_request(range->curl, client->flags, &client->policy, client->share, url);
+    curl_easy_setopt(range->curl, CURLOPT_RANGE, bytes);
+
+    // separate connections, each with its own tcp window
+    curl_easy_setopt(range->curl, CURLOPT_HTTP_VERSION, (long) CURL_HTTP_VERSION_1_1);
+    curl_easy_setopt(range->curl, CURLOPT_WRITEFUNCTION, nekos_range_callback);
+    curl_easy_setopt(range->curl, CURLOPT_WRITEDATA, range);
+    curl_easy_setopt(range->curl, CURLOPT_PRIVATE, (void*) range);
+    if (curl_multi_add_handle(client->multi, range->curl) != CURLM_OK) {
+        curl_easy_cleanup(range->curl);
+        range->curl = NULL;
+        return NEKOS_LIBCURL_ERR;
+    }
+
+    range->attempts++;
+    return NEKOS_OK;
+}
+
+static nekos_status nekos_fetch_ranges(nekos_client *client, const char* url, nekos_range *ranges, size_t count, int max_parallel, void (*on_done)(void *userdata), void *userdata) {
+    size_t limit = (max_parallel == 0 || (size_t) max_parallel > count) ? count : (size_t) max_parallel;
+    size_t active = 0;
+    nekos_status status = NEKOS_OK;
+    CURLMcode mres = CURLM_OK;
+    for (;;) {
+        // start pending ranges until the limit is reached
+        for (size_t i = 0; i < count && active < limit && status == NEKOS_OK; i++) {
+            if (ranges[i].done || ranges[i].curl)
+                continue;
+            status = nekos_start_range(client, &ranges[i], url);
+            if (status == NEKOS_OK)
+                active++;
+        }
+        if (active == 0 || mres != CURLM_OK)
+            break;
+
+        // drive transfers
+        int running;
+        mres = curl_multi_perform(client->multi, &running);
+        if (mres == CURLM_OK && running)
+            mres = curl_multi_poll(client->multi, NULL, 0, 1000, NULL);
+
+        // collect finished ranges, retrying incomplete ones from where they stopped
+        CURLMsg *msg;
+        int queued;
+        while ((msg = curl_multi_info_read(client->multi, &queued))) {
+            if (msg->msg != CURLMSG_DONE)
+                continue;
+
+            char *private_data;
+            curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, &private_data);
+            nekos_range *range = (nekos_range*) private_data;
+            CURLcode result = msg->data.result;
+            curl_multi_remove_handle(client->multi, range->curl);
+            curl_easy_cleanup(range->curl);
+            range->curl = NULL;
+            active--;
+
+            if (result == CURLE_OK && range->start + range->received == range->end) {
+                range->done = 1;
+                if (on_done)
+                    on_done(userdata);
+            } else if (range->attempts >= NEKOS_RANGE_MAX_ATTEMPTS) {
+                status = NEKOS_LIBCURL_ERR;
+            }
+        }
+    }
+
+    // abort remaining transfers after a failure
+    for (size_t i = 0; i < count; i++) {
+        if (!ranges[i].curl)
+            continue;
+        curl_multi_remove_handle(client->multi, ranges[i].curl);
+        curl_easy_cleanup(ranges[i].curl);
+        ranges[i].curl = NULL;
+    }
+
+    return mres != CURLM_OK ? NEKOS_LIBCURL_ERR : status;
+}
+
+static nekos_range* nekos_split_ranges(char *base, size_t size, size_t chunk_size, size_t *count) {
+    *count = (size + chunk_size - 1) / chunk_size;
+    nekos_range *ranges = (nekos_range*) nekos_malloc(*count * sizeof(nekos_range));
+    if (!ranges)
+        return NULL;
+
+    for (size_t i = 0; i < *count; i++) {
+        ranges[i].start = i * chunk_size;
+        ranges[i].end = ranges[i].start + chunk_size < size ? ranges[i].start + chunk_size : size;
+        ranges[i].received = 0;
+        ranges[i].attempts = 0;
+        ranges[i].done = 0;
+        ranges[i].curl = NULL;
+        ranges[i].base = base;
+    }
+
+    return ranges;
+}
+
+nekos_status nekos_client_download_ranged(nekos_client *client, nekos_http_response *http_response, const char* url, size_t chunk_size, int max_parallel) {
+    if (max_parallel < 0)
+        return NEKOS_INVALID_PARAM_ERR;
+    if (chunk_size == 0)
+        chunk_size = NEKOS_DEFAULT_CHUNK_SIZE;
+
+    // small images and servers without range support take a single stream
+    curl_off_t start = nekos_now_us();
+    nekos_range_probe probe;
+    nekos_status status = nekos_probe_ranges(client, url, &probe);
+    if (status != NEKOS_OK || !probe.ranges || probe.size <= (curl_off_t) chunk_size)
+        return nekos_client_download(client, http_response, url);
+
+    // fetch all ranges into one preallocated buffer
+    size_t size = (size_t) probe.size;
+    size_t count;
+    memset(&http_response->timing, 0, sizeof(nekos_timing));
+    http_response->len = 0;
+    http_response->text = (char*) nekos_malloc(size);
+    nekos_range *ranges = http_response->text ? nekos_split_ranges(http_response->text, size, chunk_size, &count) : NULL;
+    if (!ranges) {
+        nekos_free(http_response->text);
+        http_response->text = NULL;
+        return NEKOS_MEM_ERR;
+    }
+
+    status = nekos_fetch_ranges(client, url, ranges, count, max_parallel, NULL, NULL);
+    nekos_free(ranges);
+    http_response->timing.total_us = nekos_elapsed_us(start);
+    if (status == NEKOS_OK) {
+        http_response->len = size;
+        http_response->timing.bytes_received = (curl_off_t) size;
+    } else {
+        nekos_free(http_response->text);
+        http_response->text = NULL;
+    }
+
+    nekos_record_stats(&client->stats, NEKOS_STATS_DOWNLOAD, status, &http_response->timing);
+    return status;
+}
+
+nekos_status nekos_download_ranged(nekos_http_response *http_response, const char* url, size_t chunk_size, int max_parallel) {
+    nekos_client *client = nekos_default_client();
+    if (!client)
+        return NEKOS_LIBCURL_ERR;
+
+    return nekos_client_download_ranged(client, http_response, url, chunk_size, max_parallel);
+}
+
+struct nekos_async_request {
+    CURL *curl;
+    nekos_stats_call call;
+    nekos_response_buffer buffer;
+    nekos_http_response http_response;
+    nekos_format format;
+    nekos_results_callback results_callback;
+    nekos_response_callback response_callback;
+    void *userdata;
+    nekos_async_request *prev;
+    nekos_async_request *next;
+};
+
+static int nekos_async_socket_function(CURL *curl, curl_socket_t socket, int what, void *userp, void *socketp) {
+    (void) curl;
+    (void) socketp;
+    nekos_async *async = (nekos_async*) userp;
+    async->socket_callback(socket, what, async->userdata);
+    return 0;
+}
+
+static int nekos_async_timer_function(CURLM *multi, long timeout_ms, void *userp) {
+    (void) multi;
+    nekos_async *async = (nekos_async*) userp;
+    async->timer_callback(timeout_ms, async->userdata);
+    return 0;
+}
+
+nekos_status nekos_async_init(nekos_async *async, nekos_socket_callback socket_callback, nekos_timer_callback timer_callback, void *userdata) {
+    async->multi = curl_multi_init();
+    if (!async->multi)
+        return NEKOS_LIBCURL_ERR;
+
+    async->flags = 0;
+    async->socket_callback = socket_callback;
+    async->timer_callback = timer_callback;
+    async->userdata = userdata;
+    async->requests = NULL;
+    async->in_flight = 0;
+    memset(&async->stats, 0, sizeof(nekos_stats));
+    async->share = NULL;
+    memset(&async->policy, 0, sizeof(nekos_request_policy));
+
+    // multiplex requests if NEKOS_HTTP2 is set
+    curl_multi_setopt(async->multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+
+    // forward socket and timer changes to the event loop
+    curl_multi_setopt(async->multi, CURLMOPT_SOCKETFUNCTION, nekos_async_socket_function);
+    curl_multi_setopt(async->multi, CURLMOPT_SOCKETDATA, async);
+    curl_multi_setopt(async->multi, CURLMOPT_TIMERFUNCTION, nekos_async_timer_function);
+    curl_multi_setopt(async->multi, CURLMOPT_TIMERDATA, async);
+    return NEKOS_OK;
+}
+
+static nekos_async_request* nekos_async_new_request(void) {
+    nekos_async_request *request = (nekos_async_request*) nekos_malloc(sizeof(nekos_async_request));
+    if (!request)
+        return NULL;
+
+    memset(request, 0, sizeof(nekos_async_request));
+    request->curl = curl_easy_init();
+    if (!request->curl) {
+        nekos_free(request);
+        return NULL;
+    }
+
+    return request;
+}
+
+static void nekos_async_unlink(nekos_async *async, nekos_async_request *request) {
+    if (request->prev)
+        request->prev->next = request->next;
+    else
+        async->requests = request->next;
+    if (request->next)
+        request->next->prev = request->prev;
+
+    curl_multi_remove_handle(async->multi, request->curl);
+    curl_easy_cleanup(request->curl);
+    async->in_flight--;
+}
+
+static nekos_status nekos_async_start(nekos_async *async, nekos_async_request **handle, nekos_async_request *request, const char* url) {
+    nekos_status status = nekos_prepare_request(request->curl, async->flags, &async->policy, async->share, &request->buffer, &request->http_response, url);
+    if (status != NEKOS_OK) {
+        curl_easy_cleanup(request->curl);
+        nekos_free(request);
+        return status;
+    }
+
+    curl_easy_setopt(request->curl, CURLOPT_PRIVATE, (void*) request);
+    if (curl_multi_add_handle(async->multi, request->curl) != CURLM_OK) {
+        nekos_free(request->http_response.text);
+        curl_easy_cleanup(request->curl);
+        nekos_free(request);
+        return NEKOS_LIBCURL_ERR;
+    }
+
+    // link into the list of in-flight requests
+    request->next = async->requests;
+    if (async->requests)
+        async->requests->prev = request;
+    async->requests = request;
+    async->in_flight++;
+
+    if (handle)
+        *handle = request;
+    return NEKOS_OK;
+}
+
+nekos_status nekos_async_category(nekos_async *async, nekos_async_request **request, const nekos_endpoint *endpoint, int amount, nekos_results_callback callback, void *userdata) {
+    char url[NEKOS_URL_SIZE];
+    nekos_status url_status = nekos_category_url(url, endpoint, amount);
+    if (url_status != NEKOS_OK)
+        return url_status;
+
+    nekos_async_request *new_request = nekos_async_new_request();
+    if (!new_request)
+        return NEKOS_MEM_ERR;
+
+    new_request->call = NEKOS_STATS_CATEGORY;
+    new_request->format = endpoint->format;
+    new_request->results_callback = callback;
+    new_request->userdata = userdata;
+    return nekos_async_start(async, request, new_request, url);
+}
+
+nekos_status nekos_async_search(nekos_async *async, nekos_async_request **request, const char* raw_query, int amount, const nekos_format format, const nekos_endpoint *endpoint, nekos_results_callback callback, void *userdata) {
+    nekos_async_request *new_request = nekos_async_new_request();
+    if (!new_request)
+        return NEKOS_MEM_ERR;
+
+    char url[NEKOS_URL_SIZE];
+    nekos_status url_status = nekos_search_url(new_request->curl, url, raw_query, amount, format, endpoint);
+    if (url_status != NEKOS_OK) {
+        curl_easy_cleanup(new_request->curl);
+        nekos_free(new_request);
+        return url_status;
+    }
+
+    new_request->call = NEKOS_STATS_SEARCH;
+    new_request->format = format;
+    new_request->results_callback = callback;
+    new_request->userdata = userdata;
+    return nekos_async_start(async, request, new_request, url);
+}
+
+nekos_status nekos_async_download(nekos_async *async, nekos_async_request **request, const char* url, nekos_response_callback callback, void *userdata) {
+    nekos_async_request *new_request = nekos_async_new_request();
+    if (!new_request)
+        return NEKOS_MEM_ERR;
+
+    new_request->call = NEKOS_STATS_DOWNLOAD;
+    new_request->response_callback = callback;
+    new_request->userdata = userdata;
+    return nekos_async_start(async, request, new_request, url);
+}
+
+static void nekos_async_finish(nekos_async *async, nekos_async_request *request, CURLcode result) {
+    nekos_read_timing(request->curl, &request->http_response.timing);
+    nekos_async_unlink(async, request);
+
+    nekos_status status = result == CURLE_OK ? NEKOS_OK : NEKOS_LIBCURL_ERR;
+    if (status != NEKOS_OK) {
+        nekos_free(request->http_response.text);
+        request->http_response.text = NULL;
+        request->http_response.len = 0;
+    }
+
+    // hand results to the completion callback
+    if (request->results_callback) {
+        nekos_result_list results;
+        if (status == NEKOS_OK)
+            status = nekos_parse_results(async->flags, &results, &request->http_response, request->format);
+        nekos_record_stats(&async->stats, request->call, status, &request->http_response.timing);
+        request->results_callback(status, status == NEKOS_OK ? &results : NULL, request->userdata);
+    } else {
+        nekos_record_stats(&async->stats, request->call, status, &request->http_response.timing);
+        request->response_callback(status, status == NEKOS_OK ? &request->http_response : NULL, request->userdata);
+    }
+
+    nekos_free(request);
+}
+
+nekos_status nekos_async_socket_action(nekos_async *async, curl_socket_t socket, int events) {
+    int running;
+    CURLMcode mres = curl_multi_socket_action(async->multi, socket, events, &running);
+
+    // dispatch finished requests
+    CURLMsg *msg;
+    int queued;
+    while ((msg = curl_multi_info_read(async->multi, &queued))) {
+        if (msg->msg != CURLMSG_DONE)
+            continue;
+
+        char *private_data;
+        curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, &private_data);
+        nekos_async_finish(async, (nekos_async_request*) private_data, msg->data.result);
+    }
+
+    return mres == CURLM_OK ? NEKOS_OK : NEKOS_LIBCURL_ERR;
+}
+
+void nekos_async_cancel(nekos_async *async, nekos_async_request *request) {
+    nekos_async_unlink(async, request);
+    nekos_free(request->http_response.text);
+    nekos_free(request);
+}
+
+static long nekos_download_response_code(nekos_client *client, CURL *curl) {
+    long response_code = 0;
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &response_code);
+    if (client->rate_limiter && response_code != 0)
+        nekos_rate_feedback(client->rate_limiter, curl, response_code);
+    return response_code;
+}
+
+typedef struct {
+    CURL *curl;
+    nekos_sink_state state;
+} nekos_download_sink_state;
+
+static size_t nekos_download_sink_callback(const char *ptr, size_t count, size_t nmemb, nekos_download_sink_state *download) {
+    // the body of a rejected request never reaches the sink
+    long response_code = 0;
+    curl_easy_getinfo(download->curl, CURLINFO_RESPONSE_CODE, &response_code);
+    if (response_code == 429)
+        return count * nmemb;
+
+    return nekos_sink_callback(ptr, count, nmemb, &download->state);
+}
+
+nekos_status nekos_client_download_into(nekos_client *client, nekos_http_response *http_response, char *buffer, size_t capacity, const char* url) {
+    // reset options from previous requests (keeps open connections)
+    CURL *curl = client->curl;
+    curl_easy_reset(curl);
+
+    // point response at caller-owned buffer
+    http_response->text = buffer;
+    http_response->len = 0;
+    memset(&http_response->timing, 0, sizeof(nekos_timing));
+
+    nekos_response_buffer response_buffer;
+    response_buffer.curl = curl;
+    response_buffer.http_response = http_response;
+    response_buffer.cap = capacity;
+    response_buffer.fixed = 1;
+    response_buffer.overflow = 0;
+
+    // configure curl request
+    nekos_setup_request(curl, client->flags, &client->policy, client->share, url);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, nekos_write_callback);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response_buffer);
+
+    // make request, retrying rejected ones while the rate limiter allows
+    nekos_rate_limiter *limiter = client->rate_limiter;
+    int throttled = 0;
+    CURLcode res;
+    long response_code;
+    for (;;) {
+        if (limiter)
+            nekos_rate_acquire(limiter);
+        http_response->len = 0;
+        response_buffer.overflow = 0;
+        res = curl_easy_perform(curl);
+        response_code = nekos_download_response_code(client, curl);
+        if (response_code != 429 || !limiter || throttled++ >= limiter->max_retries)
+            break;
+    }
+    nekos_read_timing(curl, &http_response->timing);
+
+    nekos_status status = response_code == 429 ? NEKOS_RATE_LIMIT_ERR : response_buffer.overflow ? NEKOS_BUFFER_ERR : res != CURLE_OK ? NEKOS_LIBCURL_ERR : NEKOS_OK;
+    if (status == NEKOS_RATE_LIMIT_ERR)
+        http_response->len = 0;
+    nekos_record_stats(&client->stats, NEKOS_STATS_DOWNLOAD, status, &http_response->timing);
+    return status;
+}
+
+nekos_status nekos_download_into(nekos_http_response *http_response, char *buffer, size_t capacity, const char* url) {
+    nekos_client *client = nekos_default_client();
+    if (!client)
+        return NEKOS_LIBCURL_ERR;
+
+    return nekos_client_download_into(client, http_response, buffer, capacity, url);
+}
+
+nekos_status nekos_client_download_to(nekos_client *client, const nekos_sink *sink, const char* url) {
+    // reset options from previous requests (keeps open connections)
+    CURL *curl = client->curl;
+    curl_easy_reset(curl);
+
+    // configure curl request
+    nekos_download_sink_state download;
+    download.curl = curl;
+    download.state.sink = sink;
+    download.state.failed = 0;
+    nekos_setup_request(curl, client->flags, &client->policy, client->share, url);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, nekos_download_sink_callback);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &download);
+
+    // make request, retrying rejected ones while the rate limiter allows
+    nekos_rate_limiter *limiter = client->rate_limiter;
+    int throttled = 0;
+    CURLcode res;
+    long response_code;
+    for (;;) {
+        if (limiter)
+            nekos_rate_acquire(limiter);
+        res = curl_easy_perform(curl);
+        response_code = nekos_download_response_code(client, curl);
+        if (response_code != 429 || !limiter || throttled++ >= limiter->max_retries)
+            break;
+    }
+    nekos_timing timing;
+    nekos_read_timing(curl, &timing);
+    nekos_status status = response_code == 429 ? NEKOS_RATE_LIMIT_ERR : download.state.failed ? NEKOS_IO_ERR : res != CURLE_OK ? NEKOS_LIBCURL_ERR : NEKOS_OK;
+    nekos_record_stats(&client->stats, NEKOS_STATS_DOWNLOAD, status, &timing);
+    return status;
+}
+
+nekos_status nekos_download_to(const nekos_sink *sink, const char* url) {
+    nekos_client *client = nekos_default_client();
+    if (!client)
+        return NEKOS_LIBCURL_ERR;
+
+    return nekos_client_download_to(client, sink, url);
+}
+
+/// Bytes requested by a probe, enough for the headers of nearly all images.
+#define NEKOS_PROBE_RANGE "0-4095"
+
+typedef enum {
+    NEKOS_PROBE_SIGNATURE,
+    NEKOS_PROBE_PNG_CHUNK,
+    NEKOS_PROBE_PNG_IHDR,
+    NEKOS_PROBE_PNG_ACTL,
+    NEKOS_PROBE_GIF_SCREEN,
+    NEKOS_PROBE_GIF_BLOCK,
+    NEKOS_PROBE_GIF_LABEL,
+    NEKOS_PROBE_GIF_IMAGE,
+    NEKOS_PROBE_GIF_CODE_SIZE,
+    NEKOS_PROBE_GIF_SUB_BLOCK
+} nekos_probe_field;
+
+typedef struct {
+    nekos_image_info *info;
+    int count_frames;
+    nekos_probe_field field; // field being collected
+    unsigned char bytes[9]; // bytes of the field collected so far
+    size_t len;
+    size_t need; // size of the field
+    unsigned long skip; // bytes to pass over before the field
+    unsigned long chunk_left; // bytes of the current png chunk after the field, including its crc
+    int sized;
+    int done;
+    int failed;
+} nekos_probe_state;
+
+static unsigned long nekos_read_be32(const unsigned char *bytes) {
+    return ((unsigned long) bytes[0] << 24) | ((unsigned long) bytes[1] << 16) | ((unsigned long) bytes[2] << 8) | bytes[3];
+}
+
+static void nekos_probe_expect(nekos_probe_state *state, nekos_probe_field field, size_t need, unsigned long skip) {
+    state->field = field;
+    state->need = need;
+    state->len = 0;
+    state->skip = skip;
+}
+
+static void nekos_probe_parse(nekos_probe_state *state) {
+    nekos_image_info *info = state->info;
+    const unsigned char *bytes = state->bytes;
+    switch (state->field) {
+        case NEKOS_PROBE_SIGNATURE:
+            // the 8-byte png signature is checked up to its line endings
+            if (memcmp(bytes, "\x89PNG\r\n", 6) == 0) {
+                info->format = NEKOS_PNG;
+                nekos_probe_expect(state, NEKOS_PROBE_PNG_CHUNK, 8, 2);
+            } else if (memcmp(bytes, "GIF87a", 6) == 0 || memcmp(bytes, "GIF89a", 6) == 0) {
+                info->format = NEKOS_GIF;
+                nekos_probe_expect(state, NEKOS_PROBE_GIF_SCREEN, 7, 0);
+            } else {
+                state->failed = 1;
+            }
+            break;
+        case NEKOS_PROBE_PNG_CHUNK: {
+            // length and type of the chunk, its data and crc follow
+            unsigned long len = nekos_read_be32(bytes);
+            if (memcmp(bytes + 4, "IHDR", 4) == 0 && len >= 8) {
+                state->chunk_left = len - 8 + 4;
+                nekos_probe_expect(state, NEKOS_PROBE_PNG_IHDR, 8, 0);
+            } else if (memcmp(bytes + 4, "acTL", 4) == 0 && len >= 4) {
+                nekos_probe_expect(state, NEKOS_PROBE_PNG_ACTL, 4, 0);
+            } else if (memcmp(bytes + 4, "IDAT", 4) == 0) {
+                // animation chunks come before the image data
+                info->frames = 1;
+                state->done = 1;
+            } else if (!state->sized) {
+                state->failed = 1; // ihdr must be the first chunk
+            } else {
+                nekos_probe_expect(state, NEKOS_PROBE_PNG_CHUNK, 8, len + 4);
+            }
+            break;
+        }
+        case NEKOS_PROBE_PNG_IHDR:
+            info->width = (unsigned int) nekos_read_be32(bytes);
+            info->height = (unsigned int) nekos_read_be32(bytes + 4);
+            state->sized = 1;
+            nekos_probe_expect(state, NEKOS_PROBE_PNG_CHUNK, 8, state->chunk_left);
+            break;
+        case NEKOS_PROBE_PNG_ACTL:
+            info->frames = (unsigned int) nekos_read_be32(bytes);
+            state->done = 1;
+            break;
+        case NEKOS_PROBE_GIF_SCREEN:
+            // logical screen descriptor, followed by the global color table
+            info->width = (unsigned int) (bytes[0] | (bytes[1] << 8));
+            info->height = (unsigned int) (bytes[2] | (bytes[3] << 8));
+            state->sized = 1;
+            if (!state->count_frames)
+                state->done = 1;
+            else
+                nekos_probe_expect(state, NEKOS_PROBE_GIF_BLOCK, 1, (bytes[4] & 0x80) ? 3ul << ((bytes[4] & 0x07) + 1) : 0);
+            break;
+        case NEKOS_PROBE_GIF_BLOCK:
+            if (bytes[0] == 0x21)
+                nekos_probe_expect(state, NEKOS_PROBE_GIF_LABEL, 1, 0);
+            else if (bytes[0] == 0x2c)
+                nekos_probe_expect(state, NEKOS_PROBE_GIF_IMAGE, 9, 0);
+            else if (bytes[0] == 0x3b)
+                state->done = 1; // trailer
+            else
+                state->failed = 1;
+            break;
+        case NEKOS_PROBE_GIF_LABEL:
+            // extension data is skipped like image data
+            nekos_probe_expect(state, NEKOS_PROBE_GIF_SUB_BLOCK, 1, 0);
+            break;
+        case NEKOS_PROBE_GIF_IMAGE:
+            // image descriptor, followed by the local color table
+            info->frames++;
+            nekos_probe_expect(state, NEKOS_PROBE_GIF_CODE_SIZE, 1, (bytes[8] & 0x80) ? 3ul << ((bytes[8] & 0x07) + 1) : 0);
+            break;
+        case NEKOS_PROBE_GIF_CODE_SIZE:
+            nekos_probe_expect(state, NEKOS_PROBE_GIF_SUB_BLOCK, 1, 0);
+            break;
+        case NEKOS_PROBE_GIF_SUB_BLOCK:
+            // a sub-block of length 0 ends the block
+            if (bytes[0] == 0)
+                nekos_probe_expect(state, NEKOS_PROBE_GIF_BLOCK, 1, 0);
+            else
+                nekos_probe_expect(state, NEKOS_PROBE_GIF_SUB_BLOCK, 1, bytes[0]);
+            break;
+    }
+}
+
+static size_t nekos_probe_callback(const char *ptr, size_t count, size_t nmemb, void *userdata) {
+    nekos_probe_state *state = (nekos_probe_state*) userdata;
+    size_t size = count * nmemb;
+    state->info->bytes_read += size;
+
+    // feed the headers through the parser without buffering the image
+    size_t offset = 0;
+    while (offset < size && !state->done && !state->failed) {
+        size_t available = size - offset;
+        if (state->skip > 0) {
+            size_t skipped = state->skip < available ? (size_t) state->skip : available;
+            state->skip -= skipped;
+            offset += skipped;
+            continue;
+        }
+
+        size_t copied = state->need - state->len < available ? state->need - state->len : available;
+        memcpy(state->bytes + state->len, ptr + offset, copied);
+        state->len += copied;
+        offset += copied;
+        if (state->len == state->need)
+            nekos_probe_parse(state);
+    }
+
+    return state->done || state->failed ? 0 : size; // aborts the transfer once the metadata is known
+}
+
+nekos_status nekos_client_probe(nekos_client *client, nekos_image_info *info, const nekos_result *result, int count_frames) {
+    if (!result || !result->url)
+        return NEKOS_INVALID_PARAM_ERR;
+
+    // reset options from previous requests (keeps open connections)
+    CURL *curl = client->curl;
+    curl_easy_reset(curl);
+
+    // configure curl request
+    memset(info, 0, sizeof(nekos_image_info));
+    info->format = result->format;
+    nekos_probe_state state;
+    memset(&state, 0, sizeof(state));
+    state.info = info;
+    state.count_frames = count_frames;
+    nekos_probe_expect(&state, NEKOS_PROBE_SIGNATURE, 6, 0);
+    nekos_setup_request(curl, client->flags, &client->policy, client->share, result->url);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, nekos_probe_callback);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &state);
+    if (!count_frames)
+        curl_easy_setopt(curl, CURLOPT_RANGE, NEKOS_PROBE_RANGE); // servers without range support send the whole image, cut short by the callback
+
+    // make request
+    CURLcode res = curl_easy_perform(curl);
+    nekos_timing timing;
+    nekos_read_timing(curl, &timing);
+    long response_code = 0;
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &response_code);
+
+    // the transfer is aborted on purpose once the parser stopped
+    nekos_status status;
+    if (res != CURLE_OK && !(res == CURLE_WRITE_ERROR && (state.done || state.failed)))
+        status = NEKOS_LIBCURL_ERR;
+    else if (response_code < 200 || response_code >= 300)
+        status = NEKOS_LIBCURL_ERR;
+    else if (state.failed || !state.sized)
+        status = NEKOS_FORMAT_ERR;
+    else
+        status = NEKOS_OK;
+
+    nekos_record_stats(&client->stats, NEKOS_STATS_DOWNLOAD, status, &timing);
+    return status;
+}
+
+nekos_status nekos_probe(nekos_image_info *info, const nekos_result *result, int count_frames) {
+    nekos_client *client = nekos_default_client();
+    if (!client)
+        return NEKOS_LIBCURL_ERR;
+
+    return nekos_client_probe(client, info, result, count_frames);
+}
+
+#ifndef _WIN32
+
+/// Suffix of files created by the image cache.
+#define NEKOS_IMAGE_CACHE_SUFFIX ".nekoscache"
+
+static char* nekos_image_cache_path(const nekos_image_cache *cache, const char* url) {
+    // fnv-1a 64-bit of the url
+    unsigned long long hash = 14695981039346656037ull;
+    for (const char* c = url; *c; c++) {
+        hash ^= (unsigned char) *c;
+        hash *= 1099511628211ull;
+    }
+
+    size_t len = strlen(cache->dir) + 1 + 16 + sizeof(NEKOS_IMAGE_CACHE_SUFFIX);
+    char *path = (char*) nekos_malloc(len);
+    if (path)
+        snprintf(path, len, "%s/%016llx" NEKOS_IMAGE_CACHE_SUFFIX, cache->dir, hash);
+    return path;
+}
+
+static nekos_status nekos_map_file(const char* path, nekos_http_response *http_response) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return NEKOS_IO_ERR;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return NEKOS_IO_ERR;
+    }
+
+    void *map = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return NEKOS_IO_ERR;
+
+    http_response->text = (char*) map;
+    http_response->len = (size_t) st.st_size;
+    memset(&http_response->timing, 0, sizeof(nekos_timing));
+    return NEKOS_OK;
+}
+
+typedef struct {
+    char *name;
+    off_t size;
+    time_t used;
+} nekos_cache_entry;
+
+static int nekos_compare_cache_entries(const void *a, const void *b) {
+    time_t used_a = ((const nekos_cache_entry*) a)->used;
+    time_t used_b = ((const nekos_cache_entry*) b)->used;
+    return (used_a > used_b) - (used_a < used_b);
+}
+
+static int nekos_trim_image_dir(const char *dir_path, size_t max_size, unsigned long long *size) {
+    DIR *dir = opendir(dir_path);
+    if (!dir)
+        return 0;
+
+    // collect files created by the cache
+    size_t suffix_len = strlen(NEKOS_IMAGE_CACHE_SUFFIX);
+    size_t dir_len = strlen(dir_path);
+    nekos_cache_entry *entries = NULL;
+    size_t len = 0, cap = 0;
+    unsigned long long total = 0;
+    struct dirent *dirent;
+    while ((dirent = readdir(dir))) {
+        size_t name_len = strlen(dirent->d_name);
+        if (name_len <= suffix_len || strcmp(dirent->d_name + name_len - suffix_len, NEKOS_IMAGE_CACHE_SUFFIX) != 0)
+            continue;
+
+        if (len == cap) {
+            size_t new_cap = cap ? cap * 2 : 64;
+            nekos_cache_entry *new_entries = (nekos_cache_entry*) nekos_realloc(entries, new_cap * sizeof(nekos_cache_entry));
+            if (!new_entries)
+                break;
+            entries = new_entries;
+            cap = new_cap;
+        }
+
+        char *path = (char*) nekos_malloc(dir_len + name_len + 2);
+        if (!path)
+            break;
+        snprintf(path, dir_len + name_len + 2, "%s/%s", dir_path, dirent->d_name);
+
+        struct stat st;
+        if (stat(path, &st) != 0) {
+            nekos_free(path);
+            continue;
+        }
+
+        entries[len].name = path;
+        entries[len].size = st.st_size;
+        entries[len].used = st.st_mtime;
+        total += (unsigned long long) st.st_size;
+        len++;
+    }
+    closedir(dir);
+
+    // remove least recently used files first, an empty cache has no entries to sort
+    if (len > 0)
+        qsort(entries, len, sizeof(nekos_cache_entry), nekos_compare_cache_entries);
+    for (size_t i = 0; i < len; i++) {
+        if (total > max_size && remove(entries[i].name) == 0)
+            total -= (unsigned long long) entries[i].size;
+        nekos_free(entries[i].name);
+    }
+    nekos_free(entries);
+
+    *size = total;
+    return 1;
+}
+
+nekos_status nekos_image_cache_init(nekos_image_cache *cache, const char *dir, size_t max_size) {
+    cache->dir = dir;
+    cache->max_size = max_size;
+    cache->size = 0;
+    if (!nekos_trim_image_dir(dir, max_size, &cache->size))
+        return NEKOS_IO_ERR;
+
+    pthread_mutex_init(&cache->lock, NULL);
+    return NEKOS_OK;
+}
+
+void nekos_trim_image_cache(nekos_image_cache *cache) {
+    pthread_mutex_lock(&cache->lock);
+    nekos_trim_image_dir(cache->dir, cache->max_size, &cache->size);
+    pthread_mutex_unlock(&cache->lock);
+}
+
+nekos_status nekos_client_download_cached(nekos_client *client, nekos_image_cache *cache, nekos_http_response *http_response, const char* url) {
+    char *path = nekos_image_cache_path(cache, url);
+    if (!path)
+        return NEKOS_MEM_ERR;
+
+    // map cached image and mark it as recently used
+    if (nekos_map_file(path, http_response) == NEKOS_OK) {
+        utime(path, NULL);
+        nekos_free(path);
+        return NEKOS_OK;
+    }
+
+    // stream image into a temporary file
+    char *tmp_path;
+    nekos_sink sink;
+    sink.type = NEKOS_SINK_FD;
+    nekos_status status = nekos_create_temp_file(path, ".part", &tmp_path, &sink.fd);
+    if (status != NEKOS_OK) {
+        nekos_free(path);
+        return status;
+    }
+
+    status = nekos_client_download_to(client, &sink, url);
+    long response_code = 0;
+    curl_easy_getinfo(client->curl, CURLINFO_RESPONSE_CODE, &response_code);
+    if (close(sink.fd) != 0 && status == NEKOS_OK)
+        status = NEKOS_IO_ERR;
+    if (status == NEKOS_OK && (response_code < 200 || response_code >= 300))
+        status = NEKOS_LIBCURL_ERR;
+
+    // publish the complete file
+    if (status == NEKOS_OK && rename(tmp_path, path) != 0)
+        status = NEKOS_IO_ERR;
+    if (status != NEKOS_OK)
+        remove(tmp_path);
+    nekos_free(tmp_path);
+
+    if (status == NEKOS_OK) {
+        status = nekos_map_file(path, http_response);
+        if (status == NEKOS_OK)
+            nekos_read_timing(client->curl, &http_response->timing);
+
+        // count the new image, and only scan the directory once the cache is too large
+        struct stat st;
+        pthread_mutex_lock(&cache->lock);
+        if (stat(path, &st) == 0)
+            cache->size += (unsigned long long) st.st_size;
+        if (cache->size > cache->max_size)
+            nekos_trim_image_dir(cache->dir, cache->max_size, &cache->size);
+        pthread_mutex_unlock(&cache->lock);
+    }
+
+    nekos_free(path);
+    return status;
+}
+
+nekos_status nekos_download_cached(nekos_image_cache *cache, nekos_http_response *http_response, const char* url) {
+    nekos_client *client = nekos_default_client();
+    if (!client)
+        return NEKOS_LIBCURL_ERR;
+
+    return nekos_client_download_cached(client, cache, http_response, url);
+}
+
+/// First line of the progress file of a ranged download.
+#define NEKOS_RANGES_MAGIC "nekos-ranges 1"
+
+typedef struct {
+    const char *path;
+    const nekos_range_probe *probe;
+    size_t chunk_size;
+    nekos_range *ranges;
+    size_t count;
+} nekos_range_progress;
+
+static void nekos_write_range_progress(void *userdata) {
+    nekos_range_progress *progress = (nekos_range_progress*) userdata;
+
+    // a lost update only costs refetching a range
+    FILE *file = fopen(progress->path, "wb");
+    if (!file)
+        return;
+    fprintf(file, NEKOS_RANGES_MAGIC "\nsize: %lld\nchunk: %llu\netag: %s\n", (long long) progress->probe->size, (unsigned long long) progress->chunk_size, progress->probe->etag);
+    for (size_t i = 0; i < progress->count; i++)
+        fputc(progress->ranges[i].done ? '1' : '0', file);
+    fputc('\n', file);
+    fclose(file);
+}
+
+static void nekos_read_range_progress(nekos_range_progress *progress) {
+    FILE *file = fopen(progress->path, "rb");
+    if (!file)
+        return;
+
+    // resume only the same version of the same image split the same way
+    char header[512];
+    char expected[512];
+    int len = snprintf(expected, sizeof(expected), NEKOS_RANGES_MAGIC "\nsize: %lld\nchunk: %llu\netag: %s\n", (long long) progress->probe->size, (unsigned long long) progress->chunk_size, progress->probe->etag);
+    int valid = len > 0 && (size_t) len < sizeof(expected)
+        && fread(header, 1, (size_t) len, file) == (size_t) len && memcmp(header, expected, (size_t) len) == 0;
+
+    for (size_t i = 0; i < progress->count && valid; i++)
+        progress->ranges[i].done = fgetc(file) == '1';
+    if (!valid) {
+        for (size_t i = 0; i < progress->count; i++)
+            progress->ranges[i].done = 0;
+    }
+    fclose(file);
+}
+
+nekos_status nekos_client_download_ranged_file(nekos_client *client, const char* path, const char* url, size_t chunk_size, int max_parallel) {
+    if (max_parallel < 0)
+        return NEKOS_INVALID_PARAM_ERR;
+    if (chunk_size == 0)
+        chunk_size = NEKOS_DEFAULT_CHUNK_SIZE;
+
+    size_t path_len = strlen(path);
+    char *part_path = (char*) nekos_malloc(2 * path_len + 16);
+    if (!part_path)
+        return NEKOS_MEM_ERR;
+    char *progress_path = part_path + path_len + 8;
+    snprintf(part_path, path_len + 8, "%s.part", path);
+    snprintf(progress_path, path_len + 8, "%s.ranges", path);
+
+    curl_off_t start = nekos_now_us();
+    nekos_range_probe probe;
+    nekos_status status = nekos_probe_ranges(client, url, &probe);
+    if (status != NEKOS_OK) {
+        nekos_free(part_path);
+        return status;
+    }
+
+    // stream small images and servers without range support into a temporary file of our own,
+    // only ranged downloads need the stable name to resume
+    if (!probe.ranges || probe.size <= (curl_off_t) chunk_size) {
+        nekos_free(part_path);
+        char *tmp_path;
+        nekos_sink sink;
+        sink.type = NEKOS_SINK_FD;
+        status = nekos_create_temp_file(path, ".part", &tmp_path, &sink.fd);
+        if (status != NEKOS_OK)
+            return status;
+
+        status = nekos_client_download_to(client, &sink, url);
+        if (close(sink.fd) != 0 && status == NEKOS_OK)
+            status = NEKOS_IO_ERR;
+        if (status == NEKOS_OK && rename(tmp_path, path) != 0)
+            status = NEKOS_IO_ERR;
+        if (status != NEKOS_OK)
+            remove(tmp_path);
+        nekos_free(tmp_path);
+        return status;
+    }
+
+    // map the partial file at its full size, keeping ranges of an interrupted download
+    size_t size = (size_t) probe.size;
+    int fd = open(part_path, O_RDWR | O_CREAT, 0644);
+    struct stat st;
+    int resumable = fd >= 0 && fstat(fd, &st) == 0 && st.st_size == probe.size;
+    if (fd >= 0 && !resumable) {
+        close(fd);
+        fd = open(part_path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    }
+
+    // extend a new file by writing its last byte, ftruncate is not available in strict c99
+    char *map = (char*) MAP_FAILED;
+    if (fd >= 0 && (resumable || (lseek(fd, probe.size - 1, SEEK_SET) >= 0 && write(fd, "", 1) == 1)))
+        map = (char*) mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (fd >= 0)
+        close(fd);
+    if (map == MAP_FAILED) {
+        nekos_free(part_path);
+        return NEKOS_IO_ERR;
+    }
+
+    nekos_range_progress progress;
+    progress.path = progress_path;
+    progress.probe = &probe;
+    progress.chunk_size = chunk_size;
+    progress.ranges = nekos_split_ranges(map, size, chunk_size, &progress.count);
+    if (!progress.ranges) {
+        munmap(map, size);
+        nekos_free(part_path);
+        return NEKOS_MEM_ERR;
+    }
+    if (resumable)
+        nekos_read_range_progress(&progress);
+
+    // fetch missing ranges straight into the mapping, recording each finished one
+    status = nekos_fetch_ranges(client, url, progress.ranges, progress.count, max_parallel, nekos_write_range_progress, &progress);
+    if (msync(map, size, MS_SYNC) != 0 && status == NEKOS_OK)
+        status = NEKOS_IO_ERR;
+    munmap(map, size);
+    nekos_free(progress.ranges);
+
+    // publish the complete file, an incomplete one is resumed by the next call
+    if (status == NEKOS_OK) {
+        status = rename(part_path, path) == 0 ? NEKOS_OK : NEKOS_IO_ERR;
+        remove(progress_path);
+    }
+    nekos_free(part_path);
+
+    nekos_timing timing;
+    memset(&timing, 0, sizeof(nekos_timing));
+    timing.total_us = nekos_elapsed_us(start);
+    timing.bytes_received = status == NEKOS_OK ? probe.size : 0;
+    nekos_record_stats(&client->stats, NEKOS_STATS_DOWNLOAD, status, &timing);
+    return status;
+}
+
+nekos_status nekos_download_ranged_file(const char* path, const char* url, size_t chunk_size, int max_parallel) {
+    nekos_client *client = nekos_default_client();
+    if (!client)
+        return NEKOS_LIBCURL_ERR;
+
+    return nekos_client_download_ranged_file(client, path, url, chunk_size, max_parallel);
+}
+
+static void nekos_free_prefetched(nekos_prefetched *prefetched) {
+    nekos_free_result(&prefetched->result);
+    nekos_free(prefetched->image.text);
+}
+
+static void* nekos_prefetcher_thread(void *arg) {
+    nekos_prefetcher *prefetcher = (nekos_prefetcher*) arg;
+
+    pthread_mutex_lock(&prefetcher->mutex);
+    while (1) {
+        // sleep until the ring buffer runs low
+        while (!prefetcher->stop && (prefetcher->len >= prefetcher->low_water || prefetcher->failed))
+            pthread_cond_wait(&prefetcher->refill, &prefetcher->mutex);
+        if (prefetcher->stop)
+            break;
+
+        size_t amount = prefetcher->capacity - prefetcher->len;
+        if (amount > NEKOS_MAX_AMOUNT)
+            amount = NEKOS_MAX_AMOUNT;
+        pthread_mutex_unlock(&prefetcher->mutex);
+
+        // fetch batch without holding the lock
+        nekos_result_list results;
+        nekos_http_response images[NEKOS_MAX_AMOUNT];
+        nekos_status status = nekos_client_category(&prefetcher->client, &results, &prefetcher->endpoint, (int) amount);
+        if (status == NEKOS_OK && results.len == 0) {
+            nekos_free_results(&results);
+            status = NEKOS_EMPTY_ERR;
+        }
+
+        size_t count = status == NEKOS_OK ? results.len : 0;
+        if (count > NEKOS_MAX_AMOUNT)
+            count = NEKOS_MAX_AMOUNT;
+        for (size_t i = 0; i < count; i++) {
+            images[i].text = NULL;
+            images[i].len = 0;
+        }
+        if (count && prefetcher->prefetch_images) {
+            const char *urls[NEKOS_MAX_AMOUNT];
+            nekos_status statuses[NEKOS_MAX_AMOUNT];
+            for (size_t i = 0; i < count; i++)
+                urls[i] = results.responses[i].url;
+
+            // failed downloads leave empty images behind
+            nekos_client_download_many(&prefetcher->client, images, statuses, urls, count, 0);
+        }
+
+        // move results into the ring buffer
+        pthread_mutex_lock(&prefetcher->mutex);
+        for (size_t i = 0; i < count; i++) {
+            nekos_prefetched prefetched;
+            prefetched.result = results.responses[i];
+            prefetched.image = images[i];
+            if (prefetcher->len == prefetcher->capacity) {
+                nekos_free_prefetched(&prefetched);
+                continue;
+            }
+
+            prefetcher->ring[(prefetcher->head + prefetcher->len) % prefetcher->capacity] = prefetched;
+            prefetcher->len++;
+        }
+        if (status == NEKOS_OK) {
+            for (size_t i = count; i < results.len; i++)
+                nekos_free_result(&results.responses[i]);
+            nekos_free(results.responses);
+        }
+
+        prefetcher->attempts++;
+        prefetcher->last_status = status;
+        prefetcher->failed = status != NEKOS_OK;
+        pthread_cond_broadcast(&prefetcher->ready);
+    }
+    pthread_mutex_unlock(&prefetcher->mutex);
+
+    return NULL;
+}
+
+nekos_status nekos_prefetcher_init(nekos_prefetcher *prefetcher, const nekos_endpoint *endpoint, size_t capacity, size_t low_water, int prefetch_images) {
+    // check if parameters are valid
+    if (capacity < 1 || low_water < 1 || low_water > capacity)
+        return NEKOS_INVALID_PARAM_ERR;
+
+    // copy endpoint
+    prefetcher->endpoint.format = endpoint->format;
+    prefetcher->endpoint.name = (char*) nekos_malloc(strlen(endpoint->name) + 1);
+    if (!prefetcher->endpoint.name)
+        return NEKOS_MEM_ERR;
+    strcpy(prefetcher->endpoint.name, endpoint->name);
 
-    // make request
-    nekos_http_response http_response;
-    nekos_status http_status = nekos_do_request(&http_response, url);
-    if (http_status != NEKOS_OK)
-        return http_status;
+    // allocate ring buffer
+    prefetcher->ring = (nekos_prefetched*) nekos_malloc(capacity * sizeof(nekos_prefetched));
+    if (!prefetcher->ring) {
+        nekos_free(prefetcher->endpoint.name);
+        return NEKOS_MEM_ERR;
+    }
 
-    // parse response
-    cJSON *json = cJSON_ParseWithLength(http_response.text, http_response.len);
-    if (!json || !cJSON_IsObject(json))
-        return NEKOS_CJSON_ERR;
+    // results are moved out one by one, so they must not live in an arena
+    nekos_status status = nekos_client_init(&prefetcher->client);
+    if (status != NEKOS_OK) {
+        nekos_free(prefetcher->ring);
+        nekos_free(prefetcher->endpoint.name);
+        return status;
+    }
 
-    // parse json
-    cJSON *results_obj = cJSON_GetObjectItemCaseSensitive(json, "results");
-    results->len = cJSON_GetArraySize(results_obj);
-    results->responses = (nekos_result*) malloc(results->len * sizeof(nekos_result));
+    prefetcher->prefetch_images = prefetch_images;
+    prefetcher->capacity = capacity;
+    prefetcher->head = 0;
+    prefetcher->len = 0;
+    prefetcher->low_water = low_water;
+    prefetcher->attempts = 0;
+    prefetcher->last_status = NEKOS_OK;
+    prefetcher->failed = 0;
+    prefetcher->stop = 0;
+    pthread_mutex_init(&prefetcher->mutex, NULL);
+    pthread_cond_init(&prefetcher->refill, NULL);
+    pthread_cond_init(&prefetcher->ready, NULL);
 
-    // iterate through responses
-    const cJSON *response_obj;
-    size_t i = 0;
-    cJSON_ArrayForEach(response_obj, results_obj) {
-        results->responses[i].url = nekos_jsondup(response_obj, "url");
-        results->responses[i].format = endpoint->format;
-        if (endpoint->format == NEKOS_GIF) {
-            results->responses[i].source.gif = (nekos_source_gif*) malloc(sizeof(nekos_source_gif));
-            results->responses[i].source.gif->anime_name = nekos_jsondup(response_obj, "anime_name");
-        } else {
-            results->responses[i].source.png = (nekos_source_png*) malloc(sizeof(nekos_source_png));
-            results->responses[i].source.png->artist_name = nekos_jsondup(response_obj, "artist_name");
-            results->responses[i].source.png->artist_href = nekos_jsondup(response_obj, "artist_href");
-            results->responses[i].source.png->source_url = nekos_jsondup(response_obj, "source_url");
+    // start background thread
+    if (pthread_create(&prefetcher->thread, NULL, nekos_prefetcher_thread, prefetcher) != 0) {
+        pthread_cond_destroy(&prefetcher->ready);
+        pthread_cond_destroy(&prefetcher->refill);
+        pthread_mutex_destroy(&prefetcher->mutex);
+        nekos_free_client(&prefetcher->client);
+        nekos_free(prefetcher->ring);
+        nekos_free(prefetcher->endpoint.name);
+        return NEKOS_MEM_ERR;
+    }
+
+    return NEKOS_OK;
+}
+
+nekos_status nekos_prefetcher_pop(nekos_prefetcher *prefetcher, nekos_prefetched *prefetched, int wait) {
+    pthread_mutex_lock(&prefetcher->mutex);
+
+    // wait for refill attempts until one yields results
+    while (prefetcher->len == 0 && wait && !prefetcher->stop) {
+        size_t attempt = prefetcher->attempts;
+        prefetcher->failed = 0;
+        pthread_cond_signal(&prefetcher->refill);
+        while (prefetcher->attempts == attempt && !prefetcher->stop)
+            pthread_cond_wait(&prefetcher->ready, &prefetcher->mutex);
+
+        if (prefetcher->len == 0 && prefetcher->last_status != NEKOS_OK) {
+            nekos_status status = prefetcher->last_status;
+            pthread_mutex_unlock(&prefetcher->mutex);
+            return status;
         }
-        i++;
     }
 
-    // cleanup
-    cJSON_Delete(json);
-    free(http_response.text);
+    // every pop allows a paused refill to retry
+    prefetcher->failed = 0;
+    if (prefetcher->len == 0) {
+        pthread_cond_signal(&prefetcher->refill);
+        pthread_mutex_unlock(&prefetcher->mutex);
+        return NEKOS_EMPTY_ERR;
+    }
+
+    // take oldest result
+    *prefetched = prefetcher->ring[prefetcher->head];
+    prefetcher->head = (prefetcher->head + 1) % prefetcher->capacity;
+    prefetcher->len--;
+    if (prefetcher->len < prefetcher->low_water)
+        pthread_cond_signal(&prefetcher->refill);
+
+    pthread_mutex_unlock(&prefetcher->mutex);
     return NEKOS_OK;
 }
 
-nekos_status nekos_search(nekos_result_list *results, const char* raw_query, int amount, const nekos_format format, const nekos_endpoint *endpoint) {
-    // check if amount is valid
-    if (amount < 1 || amount > NEKOS_MAX_AMOUNT)
-        return NEKOS_INVALID_PARAM_ERR;
+void nekos_free_prefetcher(nekos_prefetcher *prefetcher) {
+    // stop background thread
+    pthread_mutex_lock(&prefetcher->mutex);
+    prefetcher->stop = 1;
+    pthread_cond_broadcast(&prefetcher->refill);
+    pthread_cond_broadcast(&prefetcher->ready);
+    pthread_mutex_unlock(&prefetcher->mutex);
+    pthread_join(prefetcher->thread, NULL);
 
-    // url encode query
-    char* query = curl_easy_escape(NULL, raw_query, 0);
+    // free results that were not taken
+    for (size_t i = 0; i < prefetcher->len; i++)
+        nekos_free_prefetched(&prefetcher->ring[(prefetcher->head + i) % prefetcher->capacity]);
 
-    // check if query is valid
-    size_t query_len = strlen(query);
-    if (query_len < NEKOS_MIN_QUERY_LEN || query_len > NEKOS_MAX_QUERY_LEN)
+    pthread_cond_destroy(&prefetcher->ready);
+    pthread_cond_destroy(&prefetcher->refill);
+    pthread_mutex_destroy(&prefetcher->mutex);
+    nekos_free_client(&prefetcher->client);
+    nekos_free(prefetcher->ring);
+    nekos_free(prefetcher->endpoint.name);
+}
+
+#endif // _WIN32
+
+static void nekos_accumulate_row(uint32_t *sums, const unsigned char *row, size_t len) {
+    size_t i = 0;
+#ifdef __SSE2__
+    // widen 16 bytes at a time to 32-bit lanes
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 16 <= len; i += 16) {
+        __m128i bytes = _mm_loadu_si128((const __m128i*) (row + i));
+        __m128i low = _mm_unpacklo_epi8(bytes, zero);
+        __m128i high = _mm_unpackhi_epi8(bytes, zero);
+        __m128i *out = (__m128i*) (sums + i);
+        _mm_storeu_si128(out, _mm_add_epi32(_mm_loadu_si128(out), _mm_unpacklo_epi16(low, zero)));
+        _mm_storeu_si128(out + 1, _mm_add_epi32(_mm_loadu_si128(out + 1), _mm_unpackhi_epi16(low, zero)));
+        _mm_storeu_si128(out + 2, _mm_add_epi32(_mm_loadu_si128(out + 2), _mm_unpacklo_epi16(high, zero)));
+        _mm_storeu_si128(out + 3, _mm_add_epi32(_mm_loadu_si128(out + 3), _mm_unpackhi_epi16(high, zero)));
+    }
+#endif
+    for (; i < len; i++)
+        sums[i] += row[i];
+}
+
+static void nekos_resize_rows(const nekos_image *image, nekos_image *thumbnail, uint32_t *sums) {
+    size_t len = (size_t) image->width * 4;
+    for (unsigned int y = 0; y < thumbnail->height; y++) {
+        // sum the image rows covered by the thumbnail row
+        size_t first_row = (size_t) ((unsigned long long) y * image->height / thumbnail->height);
+        size_t last_row = (size_t) ((unsigned long long) (y + 1) * image->height / thumbnail->height);
+        memset(sums, 0, len * sizeof(uint32_t));
+        for (size_t row = first_row; row < last_row; row++)
+            nekos_accumulate_row(sums, image->pixels + row * image->stride, len);
+
+        // average the columns covered by each thumbnail pixel
+        unsigned char *out = thumbnail->pixels + (size_t) y * thumbnail->stride;
+        for (unsigned int x = 0; x < thumbnail->width; x++) {
+            size_t first = (size_t) ((unsigned long long) x * image->width / thumbnail->width);
+            size_t last = (size_t) ((unsigned long long) (x + 1) * image->width / thumbnail->width);
+            unsigned long long count = (unsigned long long) (last - first) * (last_row - first_row);
+            for (int channel = 0; channel < 4; channel++) {
+                unsigned long long sum = 0;
+                for (size_t column = first; column < last; column++)
+                    sum += sums[column * 4 + (size_t) channel];
+                out[(size_t) x * 4 + (size_t) channel] = (unsigned char) ((sum + count / 2) / count);
+            }
+        }
+    }
+}
+
+nekos_status nekos_resize_image(const nekos_image *image, nekos_image *thumbnail) {
+    // check if parameters are valid
+    if (!image->pixels || !thumbnail->pixels || thumbnail->width < 1 || thumbnail->height < 1
+        || thumbnail->width > image->width || thumbnail->height > image->height
+        || image->stride < (size_t) image->width * 4 || thumbnail->stride < (size_t) thumbnail->width * 4)
         return NEKOS_INVALID_PARAM_ERR;
 
-    // create endpoint url
-    char url[256];
-    if (endpoint)
-        snprintf(url, 256, NEKOS_BASE_URL "search?query=%s&type=%d&amount=%d&category=%s", query, format + 1, amount, endpoint->name);
-    else
-        snprintf(url, 256, NEKOS_BASE_URL "search?query=%s&type=%d&amount=%d", query, format + 1, amount);
+    uint32_t *sums = (uint32_t*) nekos_malloc((size_t) image->width * 4 * sizeof(uint32_t));
+    if (!sums)
+        return NEKOS_MEM_ERR;
 
-    // make request
+    nekos_resize_rows(image, thumbnail, sums);
+    nekos_free(sums);
+    return NEKOS_OK;
+}
+
+void nekos_free_thumbnails(nekos_image *thumbnails) {
+    nekos_free(thumbnails);
+}
+
+#ifndef _WIN32
+
+/// Amount of downloaded images per worker that may wait for decoding before downloads pause.
+#define NEKOS_THUMBNAIL_BACKLOG 2
+
+struct nekos_thumbnail_job {
+    nekos_thumbnail_job *next;
+    char *url; // NULL if the image was submitted downloaded
     nekos_http_response http_response;
-    nekos_status http_status = nekos_do_request(&http_response, url);
-    if (http_status != NEKOS_OK)
-        return http_status;
+    nekos_thumbnail_callback callback;
+    void *userdata;
+};
 
-    // parse response
-    cJSON *json = cJSON_ParseWithLength(http_response.text, http_response.len);
-    if (!json || !cJSON_IsObject(json))
-        return NEKOS_CJSON_ERR;
+static void nekos_thumbnail_fit(const nekos_image *image, const nekos_thumbnail_size *size, nekos_image *thumbnail) {
+    // keep the aspect ratio, never upscale
+    unsigned long long width = image->width, height = image->height;
+    if (width > size->width || height > size->height) {
+        if (width * size->height > height * size->width) {
+            height = (height * size->width + width / 2) / width;
+            width = size->width;
+        } else {
+            width = (width * size->height + height / 2) / height;
+            height = size->height;
+        }
+    }
 
-    // parse json
-    cJSON *results_obj = cJSON_GetObjectItemCaseSensitive(json, "results");
-    results->len = cJSON_GetArraySize(results_obj);
-    results->responses = (nekos_result*) malloc(results->len * sizeof(nekos_result));
+    thumbnail->width = width ? (unsigned int) width : 1;
+    thumbnail->height = height ? (unsigned int) height : 1;
+    thumbnail->stride = (size_t) thumbnail->width * 4;
+}
 
-    // iterate through responses
-    const cJSON *response_obj;
-    size_t i = 0;
-    cJSON_ArrayForEach(response_obj, results_obj) {
-        results->responses[i].url = nekos_jsondup(response_obj, "url");
-        results->responses[i].format = format;
-        if (format == NEKOS_GIF) {
-            results->responses[i].source.gif = (nekos_source_gif*) malloc(sizeof(nekos_source_gif));
-            results->responses[i].source.gif->anime_name = nekos_jsondup(response_obj, "anime_name");
+static nekos_status nekos_make_thumbnails(nekos_thumbnailer *thumbnailer, const nekos_http_response *http_response, nekos_image **thumbnails) {
+    nekos_image image;
+    memset(&image, 0, sizeof(image));
+    if (thumbnailer->decoder.decode(http_response->text, http_response->len, &image, thumbnailer->decoder.userdata) != 0)
+        return NEKOS_FORMAT_ERR;
+
+    nekos_status status = NEKOS_FORMAT_ERR;
+    if (image.pixels && image.width > 0 && image.height > 0 && image.stride >= (size_t) image.width * 4) {
+        // one block holding the thumbnail structs followed by their pixels
+        size_t size = thumbnailer->size_count * sizeof(nekos_image);
+        for (size_t i = 0; i < thumbnailer->size_count; i++) {
+            nekos_image fitted;
+            nekos_thumbnail_fit(&image, &thumbnailer->sizes[i], &fitted);
+            size += fitted.stride * fitted.height;
+        }
+
+        *thumbnails = (nekos_image*) nekos_malloc(size);
+        uint32_t *sums = (uint32_t*) nekos_malloc((size_t) image.width * 4 * sizeof(uint32_t));
+        status = *thumbnails && sums ? NEKOS_OK : NEKOS_MEM_ERR;
+        if (status == NEKOS_OK) {
+            unsigned char *pixels = (unsigned char*) (*thumbnails + thumbnailer->size_count);
+            for (size_t i = 0; i < thumbnailer->size_count; i++) {
+                nekos_image *thumbnail = &(*thumbnails)[i];
+                nekos_thumbnail_fit(&image, &thumbnailer->sizes[i], thumbnail);
+                thumbnail->pixels = pixels;
+                pixels += thumbnail->stride * thumbnail->height;
+                nekos_resize_rows(&image, thumbnail, sums);
+            }
         } else {
-            results->responses[i].source.png = (nekos_source_png*) malloc(sizeof(nekos_source_png));
-            results->responses[i].source.png->artist_name = nekos_jsondup(response_obj, "artist_name");
-            results->responses[i].source.png->artist_href = nekos_jsondup(response_obj, "artist_href");
-            results->responses[i].source.png->source_url = nekos_jsondup(response_obj, "source_url");
+            nekos_free(*thumbnails);
+            *thumbnails = NULL;
         }
+        nekos_free(sums);
+    }
+
+    if (thumbnailer->decoder.release)
+        thumbnailer->decoder.release(&image, thumbnailer->decoder.userdata);
+    return status;
+}
+
+static void nekos_finish_thumbnail_job(nekos_thumbnailer *thumbnailer, nekos_thumbnail_job *job, nekos_status status, nekos_image *thumbnails) {
+    job->callback(status, thumbnails, job->userdata);
+    nekos_free(job->url);
+    nekos_free(job);
+
+    pthread_mutex_lock(&thumbnailer->mutex);
+    thumbnailer->pending--;
+    pthread_cond_broadcast(&thumbnailer->done);
+    pthread_mutex_unlock(&thumbnailer->mutex);
+}
 
-        i++;
+static void* nekos_thumbnail_worker(void *arg) {
+    nekos_thumbnailer *thumbnailer = (nekos_thumbnailer*) arg;
+
+    pthread_mutex_lock(&thumbnailer->mutex);
+    while (1) {
+        while (!thumbnailer->stop && !thumbnailer->decodes)
+            pthread_cond_wait(&thumbnailer->work, &thumbnailer->mutex);
+        if (!thumbnailer->decodes)
+            break;
+
+        // take oldest downloaded image, making room for another download
+        nekos_thumbnail_job *job = thumbnailer->decodes;
+        thumbnailer->decodes = job->next;
+        if (!thumbnailer->decodes)
+            thumbnailer->decodes_tail = NULL;
+        thumbnailer->decode_len--;
+        pthread_cond_broadcast(&thumbnailer->work);
+        pthread_mutex_unlock(&thumbnailer->mutex);
+
+        // decode and downscale without holding the lock
+        nekos_image *thumbnails = NULL;
+        nekos_status status = nekos_make_thumbnails(thumbnailer, &job->http_response, &thumbnails);
+        nekos_free_http_response(&job->http_response);
+        nekos_finish_thumbnail_job(thumbnailer, job, status, thumbnails);
+
+        pthread_mutex_lock(&thumbnailer->mutex);
+    }
+    pthread_mutex_unlock(&thumbnailer->mutex);
+
+    return NULL;
+}
+
+static void nekos_queue_decode(nekos_thumbnailer *thumbnailer, nekos_thumbnail_job *job) {
+    job->next = NULL;
+    if (thumbnailer->decodes_tail)
+        thumbnailer->decodes_tail->next = job;
+    else
+        thumbnailer->decodes = job;
+    thumbnailer->decodes_tail = job;
+    thumbnailer->decode_len++;
+}
+
+static void* nekos_thumbnail_downloader(void *arg) {
+    nekos_thumbnailer *thumbnailer = (nekos_thumbnailer*) arg;
+
+    pthread_mutex_lock(&thumbnailer->mutex);
+    while (1) {
+        // sleep until urls are queued and the workers keep up
+        while (!thumbnailer->stop && (!thumbnailer->downloads || thumbnailer->decode_len >= thumbnailer->worker_count * NEKOS_THUMBNAIL_BACKLOG))
+            pthread_cond_wait(&thumbnailer->work, &thumbnailer->mutex);
+        if (thumbnailer->stop)
+            break;
+
+        nekos_thumbnail_job *batch[NEKOS_MAX_AMOUNT];
+        const char *urls[NEKOS_MAX_AMOUNT];
+        size_t count = 0;
+        while (thumbnailer->downloads && count < NEKOS_MAX_AMOUNT) {
+            batch[count] = thumbnailer->downloads;
+            urls[count] = batch[count]->url;
+            thumbnailer->downloads = batch[count]->next;
+            count++;
+        }
+        if (!thumbnailer->downloads)
+            thumbnailer->downloads_tail = NULL;
+        pthread_mutex_unlock(&thumbnailer->mutex);
+
+        // download batch in parallel without holding the lock
+        nekos_http_response responses[NEKOS_MAX_AMOUNT];
+        nekos_status statuses[NEKOS_MAX_AMOUNT];
+        nekos_client_download_many(&thumbnailer->client, responses, statuses, urls, count, 0);
+        for (size_t i = 0; i < count; i++)
+            if (statuses[i] != NEKOS_OK)
+                nekos_finish_thumbnail_job(thumbnailer, batch[i], statuses[i], NULL);
+
+        pthread_mutex_lock(&thumbnailer->mutex);
+        for (size_t i = 0; i < count; i++) {
+            if (statuses[i] != NEKOS_OK)
+                continue;
+            batch[i]->http_response = responses[i];
+            nekos_queue_decode(thumbnailer, batch[i]);
+        }
+        pthread_cond_broadcast(&thumbnailer->work);
+    }
+    pthread_mutex_unlock(&thumbnailer->mutex);
+
+    return NULL;
+}
+
+static void nekos_stop_thumbnailer(nekos_thumbnailer *thumbnailer, size_t workers) {
+    pthread_mutex_lock(&thumbnailer->mutex);
+    thumbnailer->stop = 1;
+    pthread_cond_broadcast(&thumbnailer->work);
+    pthread_mutex_unlock(&thumbnailer->mutex);
+    for (size_t i = 0; i < workers; i++)
+        pthread_join(thumbnailer->workers[i], NULL);
+}
+
+nekos_status nekos_thumbnailer_init(nekos_thumbnailer *thumbnailer, const nekos_decoder *decoder, const nekos_thumbnail_size *sizes, size_t size_count, size_t workers) {
+    // check if parameters are valid
+    if (!decoder->decode || size_count < 1 || workers < 1)
+        return NEKOS_INVALID_PARAM_ERR;
+    for (size_t i = 0; i < size_count; i++)
+        if (sizes[i].width < 1 || sizes[i].height < 1)
+            return NEKOS_INVALID_PARAM_ERR;
+
+    // copy sizes and allocate thread handles
+    thumbnailer->sizes = (nekos_thumbnail_size*) nekos_malloc(size_count * sizeof(nekos_thumbnail_size));
+    thumbnailer->workers = (pthread_t*) nekos_malloc(workers * sizeof(pthread_t));
+    if (!thumbnailer->sizes || !thumbnailer->workers) {
+        nekos_free(thumbnailer->workers);
+        nekos_free(thumbnailer->sizes);
+        return NEKOS_MEM_ERR;
+    }
+    memcpy(thumbnailer->sizes, sizes, size_count * sizeof(nekos_thumbnail_size));
+
+    nekos_status status = nekos_client_init(&thumbnailer->client);
+    if (status != NEKOS_OK) {
+        nekos_free(thumbnailer->workers);
+        nekos_free(thumbnailer->sizes);
+        return status;
+    }
+
+    thumbnailer->decoder = *decoder;
+    thumbnailer->size_count = size_count;
+    thumbnailer->worker_count = workers;
+    thumbnailer->downloads = NULL;
+    thumbnailer->downloads_tail = NULL;
+    thumbnailer->decodes = NULL;
+    thumbnailer->decodes_tail = NULL;
+    thumbnailer->decode_len = 0;
+    thumbnailer->pending = 0;
+    thumbnailer->stop = 0;
+    pthread_mutex_init(&thumbnailer->mutex, NULL);
+    pthread_cond_init(&thumbnailer->work, NULL);
+    pthread_cond_init(&thumbnailer->done, NULL);
+
+    // start threads, stopping the ones already started if one fails
+    size_t started = 0;
+    while (started < workers && pthread_create(&thumbnailer->workers[started], NULL, nekos_thumbnail_worker, thumbnailer) == 0)
+        started++;
+    if (started < workers || pthread_create(&thumbnailer->downloader, NULL, nekos_thumbnail_downloader, thumbnailer) != 0) {
+        nekos_stop_thumbnailer(thumbnailer, started);
+        pthread_cond_destroy(&thumbnailer->done);
+        pthread_cond_destroy(&thumbnailer->work);
+        pthread_mutex_destroy(&thumbnailer->mutex);
+        nekos_free_client(&thumbnailer->client);
+        nekos_free(thumbnailer->workers);
+        nekos_free(thumbnailer->sizes);
+        return NEKOS_MEM_ERR;
     }
 
-    // cleanup
-    cJSON_Delete(json);
-    free(http_response.text);
-    curl_free(query);
     return NEKOS_OK;
 }
 
-nekos_status nekos_download(nekos_http_response *http_response, const char* url) {
-    return nekos_do_request(http_response, url);
+nekos_status nekos_thumbnailer_fetch(nekos_thumbnailer *thumbnailer, const char *url, nekos_thumbnail_callback callback, void *userdata) {
+    nekos_thumbnail_job *job = (nekos_thumbnail_job*) nekos_malloc(sizeof(nekos_thumbnail_job));
+    char *url_copy = (char*) nekos_malloc(strlen(url) + 1);
+    if (!job || !url_copy) {
+        nekos_free(url_copy);
+        nekos_free(job);
+        return NEKOS_MEM_ERR;
+    }
+    strcpy(url_copy, url);
+
+    job->next = NULL;
+    job->url = url_copy;
+    job->callback = callback;
+    job->userdata = userdata;
+
+    pthread_mutex_lock(&thumbnailer->mutex);
+    if (thumbnailer->downloads_tail)
+        thumbnailer->downloads_tail->next = job;
+    else
+        thumbnailer->downloads = job;
+    thumbnailer->downloads_tail = job;
+    thumbnailer->pending++;
+    pthread_cond_broadcast(&thumbnailer->work);
+    pthread_mutex_unlock(&thumbnailer->mutex);
+    return NEKOS_OK;
+}
+
+nekos_status nekos_thumbnailer_submit(nekos_thumbnailer *thumbnailer, nekos_http_response *http_response, nekos_thumbnail_callback callback, void *userdata) {
+    nekos_thumbnail_job *job = (nekos_thumbnail_job*) nekos_malloc(sizeof(nekos_thumbnail_job));
+    if (!job)
+        return NEKOS_MEM_ERR;
+
+    job->url = NULL;
+    job->http_response = *http_response;
+    job->callback = callback;
+    job->userdata = userdata;
+
+    pthread_mutex_lock(&thumbnailer->mutex);
+    nekos_queue_decode(thumbnailer, job);
+    thumbnailer->pending++;
+    pthread_cond_broadcast(&thumbnailer->work);
+    pthread_mutex_unlock(&thumbnailer->mutex);
+    return NEKOS_OK;
+}
+
+void nekos_thumbnailer_wait(nekos_thumbnailer *thumbnailer) {
+    pthread_mutex_lock(&thumbnailer->mutex);
+    while (thumbnailer->pending > 0)
+        pthread_cond_wait(&thumbnailer->done, &thumbnailer->mutex);
+    pthread_mutex_unlock(&thumbnailer->mutex);
+}
+
+void nekos_free_thumbnailer(nekos_thumbnailer *thumbnailer) {
+    // finish queued images, then stop the threads
+    nekos_thumbnailer_wait(thumbnailer);
+    nekos_stop_thumbnailer(thumbnailer, thumbnailer->worker_count);
+    pthread_join(thumbnailer->downloader, NULL);
+
+    pthread_cond_destroy(&thumbnailer->done);
+    pthread_cond_destroy(&thumbnailer->work);
+    pthread_mutex_destroy(&thumbnailer->mutex);
+    nekos_free_client(&thumbnailer->client);
+    nekos_free(thumbnailer->workers);
+    nekos_free(thumbnailer->sizes);
+}
+
+#endif // _WIN32
+
+#define NEKOS_SNAPSHOT_HEADER_SIZE 32
+#define NEKOS_SNAPSHOT_ENDPOINT_SIZE 8
+#define NEKOS_SNAPSHOT_LIST_SIZE 8
+#define NEKOS_SNAPSHOT_RESULT_SIZE 20
+
+static size_t nekos_snapshot_string_size(const char *str) {
+    return str ? strlen(str) + 1 : 0;
+}
+
+static void nekos_snapshot_put(char *buffer, size_t offset, size_t value) {
+    uint32_t word = (uint32_t) value;
+    memcpy(buffer + offset, &word, sizeof(word));
+}
+
+static uint32_t nekos_snapshot_get(const char *data, size_t offset) {
+    uint32_t word;
+    memcpy(&word, data + offset, sizeof(word));
+    return word;
+}
+
+static size_t nekos_snapshot_put_string(char *buffer, size_t *end, const char *str) {
+    if (!str)
+        return 0;
+
+    size_t offset = *end;
+    size_t len = strlen(str) + 1;
+    memcpy(buffer + offset, str, len);
+    *end += len;
+    return offset;
+}
+
+static const char* nekos_snapshot_string(const nekos_snapshot *snapshot, size_t offset) {
+    return offset ? snapshot->data + offset : NULL;
+}
+
+size_t nekos_snapshot_size(const nekos_endpoint_list *endpoints, const nekos_result_list *lists, size_t list_count) {
+    size_t size = NEKOS_SNAPSHOT_HEADER_SIZE + 1;
+    if (endpoints) {
+        size += endpoints->len * NEKOS_SNAPSHOT_ENDPOINT_SIZE;
+        for (size_t i = 0; i < endpoints->len; i++)
+            size += nekos_snapshot_string_size(endpoints->endpoints[i].name);
+    }
+
+    size += list_count * NEKOS_SNAPSHOT_LIST_SIZE;
+    for (size_t l = 0; l < list_count; l++) {
+        size += lists[l].len * NEKOS_SNAPSHOT_RESULT_SIZE;
+        for (size_t i = 0; i < lists[l].len; i++) {
+            const nekos_result *result = &lists[l].responses[i];
+            size += nekos_snapshot_string_size(result->url);
+            if (result->format == NEKOS_GIF && result->source.gif) {
+                size += nekos_snapshot_string_size(result->source.gif->anime_name);
+            } else if (result->format == NEKOS_PNG && result->source.png) {
+                size += nekos_snapshot_string_size(result->source.png->artist_name);
+                size += nekos_snapshot_string_size(result->source.png->artist_href);
+                size += nekos_snapshot_string_size(result->source.png->source_url);
+            }
+        }
+    }
+
+    return size;
+}
+
+nekos_status nekos_snapshot_write(char *buffer, size_t capacity, const nekos_endpoint_list *endpoints, const nekos_result_list *lists, size_t list_count) {
+    size_t size = nekos_snapshot_size(endpoints, lists, list_count);
+    if (size > UINT32_MAX)
+        return NEKOS_INVALID_PARAM_ERR;
+    if (size > capacity)
+        return NEKOS_BUFFER_ERR;
+
+    // lay out the tables, the strings follow them
+    size_t endpoint_count = endpoints ? endpoints->len : 0;
+    size_t result_count = 0;
+    for (size_t l = 0; l < list_count; l++)
+        result_count += lists[l].len;
+    size_t endpoint_table = NEKOS_SNAPSHOT_HEADER_SIZE;
+    size_t list_table = endpoint_table + endpoint_count * NEKOS_SNAPSHOT_ENDPOINT_SIZE;
+    size_t result_table = list_table + list_count * NEKOS_SNAPSHOT_LIST_SIZE;
+    size_t end = result_table + result_count * NEKOS_SNAPSHOT_RESULT_SIZE;
+
+    memcpy(buffer, NEKOS_SNAPSHOT_MAGIC, 8);
+    nekos_snapshot_put(buffer, 8, NEKOS_SNAPSHOT_VERSION);
+    nekos_snapshot_put(buffer, 12, size);
+    nekos_snapshot_put(buffer, 16, endpoint_count);
+    nekos_snapshot_put(buffer, 20, endpoint_table);
+    nekos_snapshot_put(buffer, 24, list_count);
+    nekos_snapshot_put(buffer, 28, list_table);
+
+    for (size_t i = 0; i < endpoint_count; i++) {
+        size_t record = endpoint_table + i * NEKOS_SNAPSHOT_ENDPOINT_SIZE;
+        nekos_snapshot_put(buffer, record, nekos_snapshot_put_string(buffer, &end, endpoints->endpoints[i].name));
+        nekos_snapshot_put(buffer, record + 4, (size_t) endpoints->endpoints[i].format);
+    }
+
+    size_t record = result_table;
+    for (size_t l = 0; l < list_count; l++) {
+        nekos_snapshot_put(buffer, list_table + l * NEKOS_SNAPSHOT_LIST_SIZE, lists[l].len);
+        nekos_snapshot_put(buffer, list_table + l * NEKOS_SNAPSHOT_LIST_SIZE + 4, record);
+        for (size_t i = 0; i < lists[l].len; i++, record += NEKOS_SNAPSHOT_RESULT_SIZE) {
+            const nekos_result *result = &lists[l].responses[i];
+            size_t sources[3] = { 0, 0, 0 };
+            size_t url = nekos_snapshot_put_string(buffer, &end, result->url);
+            if (result->format == NEKOS_GIF && result->source.gif) {
+                sources[0] = nekos_snapshot_put_string(buffer, &end, result->source.gif->anime_name);
+            } else if (result->format == NEKOS_PNG && result->source.png) {
+                sources[0] = nekos_snapshot_put_string(buffer, &end, result->source.png->artist_name);
+                sources[1] = nekos_snapshot_put_string(buffer, &end, result->source.png->artist_href);
+                sources[2] = nekos_snapshot_put_string(buffer, &end, result->source.png->source_url);
+            }
+
+            nekos_snapshot_put(buffer, record, (size_t) result->format);
+            nekos_snapshot_put(buffer, record + 4, url);
+            for (int s = 0; s < 3; s++)
+                nekos_snapshot_put(buffer, record + 8 + 4 * (size_t) s, sources[s]);
+        }
+    }
+
+    buffer[end] = '\0';
+    return NEKOS_OK;
+}
+
+static int nekos_snapshot_valid_table(size_t size, size_t offset, size_t count, size_t record_size) {
+    return offset >= NEKOS_SNAPSHOT_HEADER_SIZE && offset <= size && count <= (size - offset) / record_size;
+}
+
+static int nekos_snapshot_valid_string(size_t size, size_t offset, int optional) {
+    return offset ? offset >= NEKOS_SNAPSHOT_HEADER_SIZE && offset < size : optional;
+}
+
+nekos_status nekos_snapshot_view(nekos_snapshot *snapshot, const char *data, size_t len) {
+    // check the header
+    if (len < NEKOS_SNAPSHOT_HEADER_SIZE + 1 || memcmp(data, NEKOS_SNAPSHOT_MAGIC, 8) != 0 || nekos_snapshot_get(data, 8) != NEKOS_SNAPSHOT_VERSION)
+        return NEKOS_FORMAT_ERR;
+    size_t size = nekos_snapshot_get(data, 12);
+    if (size < NEKOS_SNAPSHOT_HEADER_SIZE + 1 || size > len || data[size - 1] != '\0')
+        return NEKOS_FORMAT_ERR;
+
+    // check every offset once, so the accessors need not
+    size_t endpoint_count = nekos_snapshot_get(data, 16);
+    size_t endpoint_table = nekos_snapshot_get(data, 20);
+    if (!nekos_snapshot_valid_table(size, endpoint_table, endpoint_count, NEKOS_SNAPSHOT_ENDPOINT_SIZE))
+        return NEKOS_FORMAT_ERR;
+    for (size_t i = 0; i < endpoint_count; i++) {
+        size_t record = endpoint_table + i * NEKOS_SNAPSHOT_ENDPOINT_SIZE;
+        if (!nekos_snapshot_valid_string(size, nekos_snapshot_get(data, record), 0) || nekos_snapshot_get(data, record + 4) > NEKOS_GIF)
+            return NEKOS_FORMAT_ERR;
+    }
+
+    size_t list_count = nekos_snapshot_get(data, 24);
+    size_t list_table = nekos_snapshot_get(data, 28);
+    if (!nekos_snapshot_valid_table(size, list_table, list_count, NEKOS_SNAPSHOT_LIST_SIZE))
+        return NEKOS_FORMAT_ERR;
+    for (size_t l = 0; l < list_count; l++) {
+        size_t result_count = nekos_snapshot_get(data, list_table + l * NEKOS_SNAPSHOT_LIST_SIZE);
+        size_t result_table = nekos_snapshot_get(data, list_table + l * NEKOS_SNAPSHOT_LIST_SIZE + 4);
+        if (!nekos_snapshot_valid_table(size, result_table, result_count, NEKOS_SNAPSHOT_RESULT_SIZE))
+            return NEKOS_FORMAT_ERR;
+        for (size_t i = 0; i < result_count; i++) {
+            size_t record = result_table + i * NEKOS_SNAPSHOT_RESULT_SIZE;
+            if (nekos_snapshot_get(data, record) > NEKOS_GIF || !nekos_snapshot_valid_string(size, nekos_snapshot_get(data, record + 4), 0))
+                return NEKOS_FORMAT_ERR;
+            for (size_t s = 0; s < 3; s++)
+                if (!nekos_snapshot_valid_string(size, nekos_snapshot_get(data, record + 8 + 4 * s), 1))
+                    return NEKOS_FORMAT_ERR;
+        }
+    }
+
+    snapshot->data = data;
+    snapshot->len = size;
+    snapshot->mapped = 0;
+    return NEKOS_OK;
+}
+
+#ifndef _WIN32
+
+nekos_status nekos_snapshot_save(const char *path, const nekos_endpoint_list *endpoints, const nekos_result_list *lists, size_t list_count) {
+    size_t size = nekos_snapshot_size(endpoints, lists, list_count);
+    if (size > UINT32_MAX)
+        return NEKOS_INVALID_PARAM_ERR;
+
+    char *buffer = (char*) nekos_malloc(size);
+    if (!buffer)
+        return NEKOS_MEM_ERR;
+    nekos_snapshot_write(buffer, size, endpoints, lists, list_count);
+
+    char *tmp_path;
+    nekos_sink sink;
+    sink.type = NEKOS_SINK_FD;
+    nekos_status status = nekos_create_temp_file(path, ".tmp", &tmp_path, &sink.fd);
+    if (status != NEKOS_OK) {
+        nekos_free(buffer);
+        return status;
+    }
+
+    // publish the complete file, readers of the old one keep their mapping
+    nekos_sink_state state;
+    state.sink = &sink;
+    state.failed = 0;
+    int written = nekos_sink_callback(buffer, 1, size, &state) == size;
+    if (close(sink.fd) != 0 || !written || rename(tmp_path, path) != 0) {
+        remove(tmp_path);
+        status = NEKOS_IO_ERR;
+    }
+
+    nekos_free(tmp_path);
+    nekos_free(buffer);
+    return status;
+}
+
+nekos_status nekos_snapshot_open(nekos_snapshot *snapshot, const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return NEKOS_IO_ERR;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return NEKOS_IO_ERR;
+    }
+
+    // shared, so all processes read the same pages of the page cache
+    void *map = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return NEKOS_IO_ERR;
+
+    nekos_status status = nekos_snapshot_view(snapshot, (const char*) map, (size_t) st.st_size);
+    if (status == NEKOS_OK && snapshot->len != (size_t) st.st_size)
+        status = NEKOS_FORMAT_ERR;
+    if (status != NEKOS_OK) {
+        munmap(map, (size_t) st.st_size);
+        return status;
+    }
+
+    snapshot->mapped = 1;
+    return NEKOS_OK;
+}
+
+#endif // _WIN32
+
+size_t nekos_snapshot_endpoint_count(const nekos_snapshot *snapshot) {
+    return nekos_snapshot_get(snapshot->data, 16);
+}
+
+nekos_snapshot_endpoint nekos_snapshot_get_endpoint(const nekos_snapshot *snapshot, size_t index) {
+    size_t record = nekos_snapshot_get(snapshot->data, 20) + index * NEKOS_SNAPSHOT_ENDPOINT_SIZE;
+    nekos_snapshot_endpoint endpoint;
+    endpoint.name = nekos_snapshot_string(snapshot, nekos_snapshot_get(snapshot->data, record));
+    endpoint.format = (nekos_format) nekos_snapshot_get(snapshot->data, record + 4);
+    return endpoint;
+}
+
+size_t nekos_snapshot_list_count(const nekos_snapshot *snapshot) {
+    return nekos_snapshot_get(snapshot->data, 24);
+}
+
+size_t nekos_snapshot_result_count(const nekos_snapshot *snapshot, size_t list) {
+    return nekos_snapshot_get(snapshot->data, nekos_snapshot_get(snapshot->data, 28) + list * NEKOS_SNAPSHOT_LIST_SIZE);
+}
+
+nekos_snapshot_result nekos_snapshot_get_result(const nekos_snapshot *snapshot, size_t list, size_t index) {
+    size_t table = nekos_snapshot_get(snapshot->data, nekos_snapshot_get(snapshot->data, 28) + list * NEKOS_SNAPSHOT_LIST_SIZE + 4);
+    size_t record = table + index * NEKOS_SNAPSHOT_RESULT_SIZE;
+    nekos_snapshot_result result;
+    memset(&result, 0, sizeof(result));
+    result.format = (nekos_format) nekos_snapshot_get(snapshot->data, record);
+    result.url = nekos_snapshot_string(snapshot, nekos_snapshot_get(snapshot->data, record + 4));
+    if (result.format == NEKOS_GIF) {
+        result.anime_name = nekos_snapshot_string(snapshot, nekos_snapshot_get(snapshot->data, record + 8));
+    } else {
+        result.artist_name = nekos_snapshot_string(snapshot, nekos_snapshot_get(snapshot->data, record + 8));
+        result.artist_href = nekos_snapshot_string(snapshot, nekos_snapshot_get(snapshot->data, record + 12));
+        result.source_url = nekos_snapshot_string(snapshot, nekos_snapshot_get(snapshot->data, record + 16));
+    }
+    return result;
+}
+
+void nekos_free_snapshot(nekos_snapshot *snapshot) {
+#ifndef _WIN32
+    if (snapshot->mapped)
+        munmap((void*) snapshot->data, snapshot->len);
+#endif
+    snapshot->data = NULL;
+    snapshot->len = 0;
+    snapshot->mapped = 0;
 }
 
 void nekos_free_endpoint(const nekos_endpoint* endpoint) {
-    free(endpoint->name);
+    nekos_free(endpoint->name);
 }
 
 void nekos_free_endpoints(const nekos_endpoint_list* endpoints) {
     for (size_t i = 0; i < endpoints->len; i++)
         nekos_free_endpoint(&endpoints->endpoints[i]);
 
-    free(endpoints->endpoints);
+    nekos_free(endpoints->endpoints);
+}
+
+void nekos_free_endpoint_index(nekos_endpoint_index *index) {
+    nekos_free(index->buckets);
+    index->buckets = NULL;
+    index->bucket_count = 0;
 }
 
 void nekos_free_result(const nekos_result* result) {
-    free(result->url);
-    if (result->format == NEKOS_GIF) {
-        free(result->source.gif->anime_name);
-        free(result->source.gif);
-    } else {
-        free(result->source.png->artist_name);
-        free(result->source.png->artist_href);
-        free(result->source.png->source_url);
-        free(result->source.png);
+    nekos_free(result->url);
+    if (result->format == NEKOS_GIF && result->source.gif) {
+        nekos_free(result->source.gif->anime_name);
+        nekos_free(result->source.gif);
+    } else if (result->format == NEKOS_PNG && result->source.png) {
+        nekos_free(result->source.png->artist_name);
+        nekos_free(result->source.png->artist_href);
+        nekos_free(result->source.png->source_url);
+        nekos_free(result->source.png);
     }
 }
 
 void nekos_free_results(const nekos_result_list* results) {
+    // arena lists are a single block
+    if (results->arena) {
+        nekos_free(results->arena);
+        return;
+    }
+
     for (size_t i = 0; i < results->len; i++)
         nekos_free_result(&results->responses[i]);
 
-    free(results->responses);
+    nekos_free(results->responses);
 }
 
 void nekos_free_http_response(const nekos_http_response* http_response) {
-    free(http_response->text);
+    nekos_free(http_response->text);
+}
+
+void nekos_free_async(nekos_async *async) {
+    while (async->requests)
+        nekos_async_cancel(async, async->requests);
+
+    curl_multi_cleanup(async->multi);
+    async->multi = NULL;
+}
+
+#ifndef _WIN32
+
+void nekos_free_cached_response(const nekos_http_response* http_response) {
+    if (http_response->text)
+        munmap(http_response->text, http_response->len);
 }
 
+void nekos_free_image_cache(nekos_image_cache *cache) {
+    pthread_mutex_destroy(&cache->lock);
+}
+
+#endif // _WIN32
+
 #endif // NEKOSBEST_IMPL
 
 #ifdef __cplusplus
 }
-#endif
+
+#if __cplusplus >= 201402L
+
+/// Struct for an endpoint/category known at compile time.
+struct nekos_known_endpoint {
+    const char *name; ///< Name of the endpoint/category.
+    nekos_format format; ///< Format of the endpoint/category.
+};
+
+/**
+ * Table of the endpoints/categories known when this header was written, sorted by name.
+ *
+ * Use \link nekos_endpoints nekos_endpoints \endlink to get the current list from the api.
+ */
+constexpr nekos_known_endpoint nekos_known_endpoints[] = {
+    { "angry", NEKOS_GIF }, { "baka", NEKOS_GIF }, { "bite", NEKOS_GIF }, { "blush", NEKOS_GIF },
+    { "bored", NEKOS_GIF }, { "cry", NEKOS_GIF }, { "cuddle", NEKOS_GIF }, { "dance", NEKOS_GIF },
+    { "facepalm", NEKOS_GIF }, { "feed", NEKOS_GIF }, { "handhold", NEKOS_GIF }, { "handshake", NEKOS_GIF },
+    { "happy", NEKOS_GIF }, { "highfive", NEKOS_GIF }, { "hug", NEKOS_GIF }, { "husbando", NEKOS_PNG },
+    { "kick", NEKOS_GIF }, { "kiss", NEKOS_GIF }, { "kitsune", NEKOS_PNG }, { "laugh", NEKOS_GIF },
+    { "lurk", NEKOS_GIF }, { "neko", NEKOS_PNG }, { "nod", NEKOS_GIF }, { "nom", NEKOS_GIF },
+    { "nope", NEKOS_GIF }, { "pat", NEKOS_GIF }, { "peck", NEKOS_GIF }, { "poke", NEKOS_GIF },
+    { "pout", NEKOS_GIF }, { "punch", NEKOS_GIF }, { "run", NEKOS_GIF }, { "shoot", NEKOS_GIF },
+    { "shrug", NEKOS_GIF }, { "slap", NEKOS_GIF }, { "sleep", NEKOS_GIF }, { "smile", NEKOS_GIF },
+    { "smug", NEKOS_GIF }, { "stare", NEKOS_GIF }, { "think", NEKOS_GIF }, { "thumbsup", NEKOS_GIF },
+    { "tickle", NEKOS_GIF }, { "waifu", NEKOS_PNG }, { "wave", NEKOS_GIF }, { "wink", NEKOS_GIF },
+    { "yawn", NEKOS_GIF }, { "yeet", NEKOS_GIF }
+};
+
+/// Compare two strings at compile time, like strcmp.
+constexpr int nekos_constexpr_strcmp(const char *a, const char *b) {
+    while (*a && *a == *b) {
+        a++;
+        b++;
+    }
+
+    return (unsigned char) *a - (unsigned char) *b;
+}
+
+/**
+ * Find a known endpoint/category by name.
+ *
+ * Lookups of string literals in a constexpr context are resolved at compile time.
+ *
+ * \param [in] name
+ *   Name of the endpoint to search for.
+ *
+ * \return
+ *   Pointer to the known endpoint if found, nullptr otherwise.
+ */
+constexpr const nekos_known_endpoint* nekos_find_known_endpoint(const char *name) {
+    // binary search over the sorted table
+    size_t low = 0;
+    size_t high = sizeof(nekos_known_endpoints) / sizeof(nekos_known_endpoints[0]);
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        int cmp = nekos_constexpr_strcmp(nekos_known_endpoints[mid].name, name);
+        if (cmp == 0)
+            return &nekos_known_endpoints[mid];
+        if (cmp < 0)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+
+    return nullptr;
+}
+
+#endif // __cplusplus >= 201402L
+
+#endif // __cplusplus
 
 #endif // NEKOSBEST_H
@@ -0,0 +1,412 @@
+/**
+ * \file nekosbest.hpp
+ * C++20 companion header for nekosbest.h.
+ *
+ * Wraps the C api in move-only RAII types with `std::string_view` accessors
+ * and provides awaitables for coroutine-based callers.
+ *
+ * Functions throw \link nekos::error nekos::error \endlink instead of returning a ::nekos_status.
+ */
+#ifndef NEKOSBEST_HPP
+#define NEKOSBEST_HPP
+
+#if __cplusplus < 202002L
+#error "nekosbest.hpp requires C++20"
+#endif
+
+#include "nekosbest.h"
+
+#include <coroutine>
+#include <cstddef>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+
+namespace nekos {
+
+/// Exception thrown when a function of the C api fails.
+class error : public std::runtime_error {
+public:
+    explicit error(nekos_status status) : std::runtime_error(describe(status)), status_(status) {}
+
+    /// Status returned by the failing function.
+    nekos_status status() const noexcept { return status_; }
+
+private:
+    static const char *describe(nekos_status status) noexcept {
+        switch (status) {
+            case NEKOS_MEM_ERR: return "nekosbest: out of memory";
+            case NEKOS_LIBCURL_ERR: return "nekosbest: request failed";
+            case NEKOS_CJSON_ERR: return "nekosbest: invalid response";
+            case NEKOS_INVALID_PARAM_ERR: return "nekosbest: invalid parameter";
+            case NEKOS_IO_ERR: return "nekosbest: i/o error";
+            case NEKOS_BUFFER_ERR: return "nekosbest: buffer too small";
+            case NEKOS_EMPTY_ERR: return "nekosbest: no result available";
+            case NEKOS_RATE_LIMIT_ERR: return "nekosbest: rate limited";
+            case NEKOS_FORMAT_ERR: return "nekosbest: unrecognized image";
+            default: return "nekosbest: unknown error";
+        }
+    }
+
+    nekos_status status_;
+};
+
+/// Throw a \link nekos::error nekos::error \endlink if the status is not ::NEKOS_OK.
+inline void check(nekos_status status) {
+    if (status != NEKOS_OK)
+        throw error(status);
+}
+
+namespace detail {
+
+inline std::string_view view(const char *str) noexcept {
+    return str ? std::string_view(str) : std::string_view();
+}
+
+} // namespace detail
+
+/// Non-owning view of an endpoint/category.
+class endpoint {
+public:
+    explicit endpoint(const nekos_endpoint &endpoint) noexcept : endpoint_(&endpoint) {}
+
+    std::string_view name() const noexcept { return detail::view(endpoint_->name); }
+    nekos_format format() const noexcept { return endpoint_->format; }
+    const nekos_endpoint &get() const noexcept { return *endpoint_; }
+
+private:
+    const nekos_endpoint *endpoint_;
+};
+
+/// Non-owning view of a result image, valid as long as the owning \link nekos::result_list nekos::result_list \endlink.
+class result {
+public:
+    explicit result(const nekos_result &result) noexcept : result_(&result) {}
+
+    nekos_format format() const noexcept { return result_->format; }
+    std::string_view url() const noexcept { return detail::view(result_->url); }
+
+    // source information, empty if it does not apply to the format
+    std::string_view anime_name() const noexcept { return format() == NEKOS_GIF ? detail::view(result_->source.gif->anime_name) : std::string_view(); }
+    std::string_view artist_name() const noexcept { return format() == NEKOS_PNG ? detail::view(result_->source.png->artist_name) : std::string_view(); }
+    std::string_view artist_href() const noexcept { return format() == NEKOS_PNG ? detail::view(result_->source.png->artist_href) : std::string_view(); }
+    std::string_view source_url() const noexcept { return format() == NEKOS_PNG ? detail::view(result_->source.png->source_url) : std::string_view(); }
+
+    const nekos_result &get() const noexcept { return *result_; }
+
+private:
+    const nekos_result *result_;
+};
+
+/// Iterator over a contiguous array of C structs yielding views.
+template <typename View, typename Raw>
+class view_iterator {
+public:
+    using value_type = View;
+    using difference_type = std::ptrdiff_t;
+
+    view_iterator() noexcept = default;
+    explicit view_iterator(const Raw *ptr) noexcept : ptr_(ptr) {}
+
+    View operator*() const noexcept { return View(*ptr_); }
+    view_iterator &operator++() noexcept { ++ptr_; return *this; }
+    view_iterator operator++(int) noexcept { view_iterator copy = *this; ++ptr_; return copy; }
+    bool operator==(const view_iterator &other) const noexcept = default;
+
+private:
+    const Raw *ptr_ = nullptr;
+};
+
+/// Owning list of endpoints/categories.
+class endpoint_list {
+public:
+    using iterator = view_iterator<endpoint, nekos_endpoint>;
+
+    endpoint_list() noexcept = default;
+    explicit endpoint_list(const nekos_endpoint_list &list) noexcept : list_(list) {
+        // without an index, lookups fall back to a linear scan
+        nekos_index_endpoints(&index_, &list_);
+    }
+    endpoint_list(endpoint_list &&other) noexcept
+        : list_(std::exchange(other.list_, nekos_endpoint_list{})), index_(std::exchange(other.index_, nekos_endpoint_index{})) {}
+    endpoint_list &operator=(endpoint_list &&other) noexcept {
+        if (this != &other) {
+            reset();
+            list_ = std::exchange(other.list_, nekos_endpoint_list{});
+            index_ = std::exchange(other.index_, nekos_endpoint_index{});
+        }
+        return *this;
+    }
+    ~endpoint_list() { reset(); }
+
+    std::size_t size() const noexcept { return list_.len; }
+    bool empty() const noexcept { return list_.len == 0; }
+    endpoint operator[](std::size_t index) const noexcept { return endpoint(list_.endpoints[index]); }
+    iterator begin() const noexcept { return iterator(list_.endpoints); }
+    iterator end() const noexcept { return iterator(list_.endpoints + list_.len); }
+
+    /// Find an endpoint by name in constant time, NULL if it does not exist.
+    const nekos_endpoint *find(const char *name) const noexcept {
+        return index_.buckets ? nekos_find_indexed_endpoint(&index_, name) : nekos_find_endpoint(&list_, name);
+    }
+
+    const nekos_endpoint_list &get() const noexcept { return list_; }
+
+private:
+    void reset() noexcept {
+        nekos_free_endpoint_index(&index_);
+        if (list_.endpoints)
+            nekos_free_endpoints(&list_);
+        list_ = nekos_endpoint_list{};
+    }
+
+    nekos_endpoint_list list_{};
+    nekos_endpoint_index index_{};
+};
+
+/// Owning list of result images.
+class result_list {
+public:
+    using iterator = view_iterator<result, nekos_result>;
+
+    result_list() noexcept = default;
+    explicit result_list(const nekos_result_list &list) noexcept : list_(list) {}
+    result_list(result_list &&other) noexcept : list_(std::exchange(other.list_, nekos_result_list{})) {}
+    result_list &operator=(result_list &&other) noexcept {
+        if (this != &other) {
+            reset();
+            list_ = std::exchange(other.list_, nekos_result_list{});
+        }
+        return *this;
+    }
+    ~result_list() { reset(); }
+
+    std::size_t size() const noexcept { return list_.len; }
+    bool empty() const noexcept { return list_.len == 0; }
+    result operator[](std::size_t index) const noexcept { return result(list_.responses[index]); }
+    iterator begin() const noexcept { return iterator(list_.responses); }
+    iterator end() const noexcept { return iterator(list_.responses + list_.len); }
+
+    /// Timing of the request the list was parsed from.
+    const nekos_timing &timing() const noexcept { return list_.timing; }
+
+    const nekos_result_list &get() const noexcept { return list_; }
+
+private:
+    void reset() noexcept {
+        if (list_.responses || list_.arena)
+            nekos_free_results(&list_);
+        list_ = nekos_result_list{};
+    }
+
+    nekos_result_list list_{};
+};
+
+/// Owning http response.
+class http_response {
+public:
+    http_response() noexcept = default;
+    explicit http_response(const nekos_http_response &response) noexcept : response_(response) {}
+    http_response(http_response &&other) noexcept : response_(std::exchange(other.response_, nekos_http_response{})) {}
+    http_response &operator=(http_response &&other) noexcept {
+        if (this != &other) {
+            reset();
+            response_ = std::exchange(other.response_, nekos_http_response{});
+        }
+        return *this;
+    }
+    ~http_response() { reset(); }
+
+    /// Body of the response, not null-terminated.
+    std::string_view data() const noexcept { return std::string_view(response_.text, response_.len); }
+    std::size_t size() const noexcept { return response_.len; }
+
+    /// Timing of the request.
+    const nekos_timing &timing() const noexcept { return response_.timing; }
+
+    const nekos_http_response &get() const noexcept { return response_; }
+
+private:
+    void reset() noexcept {
+        if (response_.text)
+            nekos_free_http_response(&response_);
+        response_ = nekos_http_response{};
+    }
+
+    nekos_http_response response_{};
+};
+
+/// Owning blocking client, see \link nekos_client nekos_client \endlink.
+class client {
+public:
+    client() { check(nekos_client_init(&client_)); }
+    client(const client &) = delete;
+    client &operator=(const client &) = delete;
+    ~client() { nekos_free_client(&client_); }
+
+    endpoint_list endpoints() {
+        nekos_endpoint_list list;
+        check(nekos_client_endpoints(&client_, &list));
+        return endpoint_list(list);
+    }
+
+    result_list category(const nekos_endpoint &endpoint, int amount) {
+        nekos_result_list list;
+        check(nekos_client_category(&client_, &list, &endpoint, amount));
+        return result_list(list);
+    }
+
+    result_list search(const char *query, int amount, nekos_format format, const nekos_endpoint *endpoint = nullptr) {
+        nekos_result_list list;
+        check(nekos_client_search(&client_, &list, query, amount, format, endpoint));
+        return result_list(list);
+    }
+
+    http_response download(const char *url) {
+        nekos_http_response response;
+        check(nekos_client_download(&client_, &response, url));
+        return http_response(response);
+    }
+
+    http_response download(const result &image) { return download(image.get().url); }
+
+    nekos_image_info probe(const result &image, bool count_frames = false) {
+        nekos_image_info info;
+        check(nekos_client_probe(&client_, &info, &image.get(), count_frames));
+        return info;
+    }
+
+    /// Snapshot of the cumulative statistics of this client.
+    nekos_stats stats() const noexcept { return client_.stats; }
+
+    nekos_client *get() noexcept { return &client_; }
+
+private:
+    nekos_client client_;
+};
+
+/**
+ * Awaitable for an asynchronous request.
+ *
+ * The request is started when the awaitable is created and cancelled if it is destroyed before completing.
+ * The awaiting coroutine is resumed from within \link nekos::async_context::socket_action nekos::async_context::socket_action \endlink.
+ */
+template <typename T>
+class awaitable {
+public:
+    awaitable(const awaitable &) = delete;
+    awaitable &operator=(const awaitable &) = delete;
+    ~awaitable() {
+        if (!done_)
+            nekos_async_cancel(async_, request_);
+    }
+
+    bool await_ready() const noexcept { return done_; }
+    void await_suspend(std::coroutine_handle<> handle) noexcept { handle_ = handle; }
+    T await_resume() {
+        check(status_);
+        return std::move(value_);
+    }
+
+protected:
+    explicit awaitable(nekos_async *async) noexcept : async_(async) {}
+
+    // record the status of starting the request
+    void started(nekos_status status) noexcept {
+        status_ = status;
+        done_ = status != NEKOS_OK;
+    }
+
+    // resuming must come last, the coroutine may destroy this awaitable
+    void complete(nekos_status status) noexcept {
+        status_ = status;
+        done_ = true;
+        if (handle_)
+            handle_.resume();
+    }
+
+    nekos_async *async_;
+    nekos_async_request *request_ = nullptr;
+    nekos_status status_ = NEKOS_OK;
+    bool done_ = false;
+    T value_;
+    std::coroutine_handle<> handle_;
+};
+
+/// Awaitable for an asynchronous category or search request.
+class results_awaitable : public awaitable<result_list> {
+public:
+    results_awaitable(nekos_async *async, const nekos_endpoint &endpoint, int amount) noexcept : awaitable(async) {
+        started(nekos_async_category(async, &request_, &endpoint, amount, on_results, this));
+    }
+
+    results_awaitable(nekos_async *async, const char *query, int amount, nekos_format format, const nekos_endpoint *endpoint) noexcept : awaitable(async) {
+        started(nekos_async_search(async, &request_, query, amount, format, endpoint, on_results, this));
+    }
+
+private:
+    static void on_results(nekos_status status, nekos_result_list *results, void *userdata) {
+        results_awaitable *self = static_cast<results_awaitable*>(userdata);
+        if (results)
+            self->value_ = result_list(*results);
+        self->complete(status);
+    }
+};
+
+/// Awaitable for an asynchronous download.
+class response_awaitable : public awaitable<http_response> {
+public:
+    response_awaitable(nekos_async *async, const char *url) noexcept : awaitable(async) {
+        started(nekos_async_download(async, &request_, url, on_response, this));
+    }
+
+private:
+    static void on_response(nekos_status status, nekos_http_response *response, void *userdata) {
+        response_awaitable *self = static_cast<response_awaitable*>(userdata);
+        if (response)
+            self->value_ = nekos::http_response(*response);
+        self->complete(status);
+    }
+};
+
+/**
+ * Owning asynchronous request context, see \link nekos_async nekos_async \endlink.
+ *
+ * The context is neither copyable nor movable, since libcurl keeps a pointer to it.
+ * It must outlive all awaitables created from it and must not be destroyed by a coroutine resumed from it.
+ */
+class async_context {
+public:
+    async_context(nekos_socket_callback socket_callback, nekos_timer_callback timer_callback, void *userdata) {
+        check(nekos_async_init(&async_, socket_callback, timer_callback, userdata));
+    }
+    async_context(const async_context &) = delete;
+    async_context &operator=(const async_context &) = delete;
+    ~async_context() { nekos_free_async(&async_); }
+
+    /// Drive requests, see \link nekos_async_socket_action nekos_async_socket_action \endlink.
+    void socket_action(curl_socket_t socket, int events) { check(nekos_async_socket_action(&async_, socket, events)); }
+
+    std::size_t in_flight() const noexcept { return async_.in_flight; }
+
+    /// Snapshot of the cumulative statistics of this context.
+    nekos_stats stats() const noexcept { return async_.stats; }
+
+    results_awaitable category(const nekos_endpoint &endpoint, int amount) { return results_awaitable(&async_, endpoint, amount); }
+
+    results_awaitable search(const char *query, int amount, nekos_format format, const nekos_endpoint *endpoint = nullptr) {
+        return results_awaitable(&async_, query, amount, format, endpoint);
+    }
+
+    response_awaitable download(const char *url) { return response_awaitable(&async_, url); }
+    response_awaitable download(const result &image) { return download(image.get().url); }
+
+    nekos_async *get() noexcept { return &async_; }
+
+private:
+    nekos_async async_;
+};
+
+} // namespace nekos
+
+#endif // NEKOSBEST_HPP
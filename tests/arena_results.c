@@ -0,0 +1,55 @@
+#define NEKOSBEST_IMPL
+#include <nekosbest.h>
+#include "tests_common.h"
+
+static size_t allocations = 0;
+
+static void* counting_malloc(size_t size) {
+    allocations++;
+    return malloc(size);
+}
+
+int main() {
+    fprintf(stderr, WHITE BOLD "Fetching image info into an arena... ");
+
+    // count allocations made by the library
+    nekos_hooks hooks = { counting_malloc, NULL, NULL };
+    nekos_init_hooks(&hooks);
+
+    // create client
+    nekos_client client;
+    nekos_status status = nekos_client_init(&client);
+    if (status != NEKOS_OK) {
+        fprintf(stderr, RED "failed!" BOLD " Error code: %d\n", status);
+        return EXIT_FAILURE;
+    }
+    client.flags |= NEKOS_ARENA_RESULTS;
+
+    // create endpoint
+    nekos_endpoint endpoint;
+    endpoint.name = "neko";
+    endpoint.format = NEKOS_PNG;
+
+    // get images
+    nekos_result_list results;
+    status = nekos_client_category(&client, &results, &endpoint, NEKOS_MAX_AMOUNT);
+    if (status != NEKOS_OK) {
+        fprintf(stderr, RED "failed!" BOLD " Error code: %d\n", status);
+        nekos_free_client(&client);
+        return EXIT_FAILURE;
+    }
+
+    // check that the list is a single block
+    if (!results.arena) {
+        fprintf(stderr, RED "failed!" BOLD " Results were not allocated in an arena.\n");
+        return EXIT_FAILURE;
+    }
+    fprintf(stderr, GREEN "success.\n");
+    fprintf(stderr, WHITE BOLD "-> %ld results in %ld allocation(s) including the response\n", results.len, allocations);
+
+    // free results
+    nekos_free_results(&results);
+    nekos_free_client(&client);
+
+    return EXIT_SUCCESS;
+}
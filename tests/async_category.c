@@ -0,0 +1,118 @@
+#define NEKOSBEST_IMPL
+#include <nekosbest.h>
+#include "tests_common.h"
+
+#include <poll.h>
+
+#define MAX_SOCKETS 16
+
+// minimal poll() based event loop
+typedef struct {
+    struct pollfd fds[MAX_SOCKETS];
+    int nfds;
+    long timeout_ms;
+} event_loop;
+
+static void socket_callback(curl_socket_t socket, int what, void *userdata) {
+    event_loop *loop = (event_loop*) userdata;
+    int i;
+    for (i = 0; i < loop->nfds && loop->fds[i].fd != socket; i++);
+
+    if (what == CURL_POLL_REMOVE) {
+        if (i < loop->nfds)
+            loop->fds[i] = loop->fds[--loop->nfds];
+        return;
+    }
+
+    if (i == loop->nfds) {
+        if (loop->nfds == MAX_SOCKETS)
+            return;
+        loop->nfds++;
+    }
+
+    loop->fds[i].fd = socket;
+    loop->fds[i].events = (short) (((what & CURL_POLL_IN) ? POLLIN : 0) | ((what & CURL_POLL_OUT) ? POLLOUT : 0));
+}
+
+static void timer_callback(long timeout_ms, void *userdata) {
+    ((event_loop*) userdata)->timeout_ms = timeout_ms;
+}
+
+static void results_callback(nekos_status status, nekos_result_list *results, void *userdata) {
+    int *pending = (int*) userdata;
+    (*pending)--;
+    if (status != NEKOS_OK) {
+        fprintf(stderr, RED "failed!" BOLD " Error code: %d\n", status);
+        exit(EXIT_FAILURE);
+    }
+
+    for (size_t i = 0; i < results->len; i++)
+        fprintf(stderr, PINK BOLD "  %s" WHITE BOLD " made by " CYAN BOLD "%s\n", results->responses[i].url, results->responses[i].source.png->artist_name);
+    nekos_free_results(results);
+}
+
+int main() {
+    fprintf(stderr, WHITE BOLD "Fetching image info from neko and waifu categories asynchronously... ");
+
+    // create endpoints
+    nekos_endpoint neko;
+    neko.name = "neko";
+    neko.format = NEKOS_PNG;
+    nekos_endpoint waifu;
+    waifu.name = "waifu";
+    waifu.format = NEKOS_PNG;
+
+    // create async context
+    event_loop loop;
+    loop.nfds = 0;
+    loop.timeout_ms = -1;
+    nekos_async async;
+    nekos_status status = nekos_async_init(&async, socket_callback, timer_callback, &loop);
+    if (status != NEKOS_OK) {
+        fprintf(stderr, RED "failed!" BOLD " Error code: %d\n", status);
+        return EXIT_FAILURE;
+    }
+
+    // never wait on the api for longer than 10 seconds
+    async.policy.connect_timeout_ms = 5000;
+    async.policy.timeout_ms = 10000;
+
+    // start both requests at once
+    int pending = 2;
+    status = nekos_async_category(&async, NULL, &neko, 3, results_callback, &pending);
+    if (status == NEKOS_OK)
+        status = nekos_async_category(&async, NULL, &waifu, 3, results_callback, &pending);
+    if (status != NEKOS_OK) {
+        fprintf(stderr, RED "failed!" BOLD " Error code: %d\n", status);
+        nekos_free_async(&async);
+        return EXIT_FAILURE;
+    }
+
+    fprintf(stderr, GREEN "success.\n");
+    fprintf(stderr, WHITE BOLD "-> \\\n");
+
+    // run event loop until both requests completed
+    while (pending > 0) {
+        int ready = poll(loop.fds, (nfds_t) loop.nfds, loop.timeout_ms < 0 ? 1000 : (int) loop.timeout_ms);
+        if (ready == 0) {
+            nekos_async_socket_action(&async, CURL_SOCKET_TIMEOUT, 0);
+            continue;
+        }
+
+        // copy ready sockets, callbacks may modify the poll set
+        struct pollfd fired[MAX_SOCKETS];
+        int nfired = loop.nfds;
+        memcpy(fired, loop.fds, sizeof(fired));
+        for (int i = 0; i < nfired; i++) {
+            if (!fired[i].revents)
+                continue;
+
+            int events = ((fired[i].revents & POLLIN) ? CURL_CSELECT_IN : 0) | ((fired[i].revents & POLLOUT) ? CURL_CSELECT_OUT : 0) | ((fired[i].revents & (POLLERR | POLLHUP)) ? CURL_CSELECT_ERR : 0);
+            nekos_async_socket_action(&async, fired[i].fd, events);
+        }
+    }
+
+    nekos_free_async(&async);
+
+    return EXIT_SUCCESS;
+}
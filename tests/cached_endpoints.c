@@ -0,0 +1,36 @@
+#define NEKOSBEST_IMPL
+#include <nekosbest.h>
+#include "tests_common.h"
+
+#define CACHE_PATH "nekos_endpoints.cache"
+
+int main() {
+    fprintf(stderr, WHITE BOLD "Fetching endpoints through a cache file... ");
+    remove(CACHE_PATH);
+
+    // fetch endpoints twice, the second call is served from the cache
+    nekos_endpoint_list endpoints[2];
+    for (int i = 0; i < 2; i++) {
+        nekos_status status = nekos_endpoints_cached(&endpoints[i], CACHE_PATH, 3600);
+        if (status != NEKOS_OK) {
+            fprintf(stderr, RED "failed!" BOLD " Error code: %d\n", status);
+            remove(CACHE_PATH);
+            return EXIT_FAILURE;
+        }
+    }
+    remove(CACHE_PATH);
+
+    // compare both lists
+    if (endpoints[0].len != endpoints[1].len || !nekos_find_endpoint(&endpoints[1], endpoints[0].endpoints[0].name)) {
+        fprintf(stderr, RED "failed!" BOLD " Cached endpoints do not match.\n");
+        return EXIT_FAILURE;
+    }
+    fprintf(stderr, GREEN "success.\n");
+    fprintf(stderr, WHITE BOLD "-> %ld endpoints served from the cache\n", endpoints[1].len);
+
+    // free endpoints
+    nekos_free_endpoints(&endpoints[0]);
+    nekos_free_endpoints(&endpoints[1]);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,60 @@
+#define NEKOSBEST_IMPL
+#include <nekosbest.h>
+#include "tests_common.h"
+
+#define CALLS 3
+#define AMOUNT 10
+
+int main() {
+    fprintf(stderr, WHITE BOLD "Fetching unseen images from a category... ");
+
+    nekos_seen_filter filter;
+    nekos_status status = nekos_seen_filter_init(&filter, 1000, 0.01);
+    if (status != NEKOS_OK) {
+        fprintf(stderr, RED "failed!" BOLD " Error code: %d\n", status);
+        return EXIT_FAILURE;
+    }
+
+    // fetch several lists, keeping the urls
+    nekos_endpoint endpoint;
+    endpoint.name = "neko";
+    endpoint.format = NEKOS_PNG;
+    nekos_result_list lists[CALLS];
+    for (int i = 0; i < CALLS; i++) {
+        status = nekos_category_unique(&lists[i], &endpoint, AMOUNT, &filter);
+        if (status != NEKOS_OK) {
+            fprintf(stderr, RED "failed!" BOLD " Error code: %d\n", status);
+            return EXIT_FAILURE;
+        }
+    }
+
+    // no url may repeat across the lists
+    size_t total = 0;
+    for (int i = 0; i < CALLS; i++) {
+        for (size_t r = 0; r < lists[i].len; r++) {
+            for (int j = 0; j <= i; j++) {
+                for (size_t s = 0; s < (j == i ? r : lists[j].len); s++) {
+                    if (strcmp(lists[i].responses[r].url, lists[j].responses[s].url) == 0) {
+                        fprintf(stderr, RED "failed!" BOLD " Repeated image: %s\n", lists[i].responses[r].url);
+                        return EXIT_FAILURE;
+                    }
+                }
+            }
+        }
+        total += lists[i].len;
+    }
+    if (filter.len != total) {
+        fprintf(stderr, RED "failed!" BOLD " Filter holds %ld urls instead of %ld\n", filter.len, total);
+        return EXIT_FAILURE;
+    }
+    fprintf(stderr, GREEN "success.\n");
+    fprintf(stderr, WHITE BOLD "-> %ld unique images, filter uses %ld bytes at a false-positive rate of %.6f\n",
+        total, nekos_seen_filter_memory(&filter), nekos_seen_filter_false_positive_rate(&filter));
+
+    // free lists and filter
+    for (int i = 0; i < CALLS; i++)
+        nekos_free_results(&lists[i]);
+    nekos_free_seen_filter(&filter);
+
+    return EXIT_SUCCESS;
+}
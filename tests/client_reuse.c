@@ -0,0 +1,52 @@
+#define NEKOSBEST_IMPL
+#include <nekosbest.h>
+#include "tests_common.h"
+
+int main() {
+    fprintf(stderr, WHITE BOLD "Fetching images twice with the same client... ");
+
+    // create client
+    nekos_client client;
+    nekos_status status = nekos_client_init(&client);
+    if (status != NEKOS_OK) {
+        fprintf(stderr, RED "failed!" BOLD " Error code: %d\n", status);
+        return EXIT_FAILURE;
+    }
+
+    // create endpoint
+    nekos_endpoint endpoint;
+    endpoint.name = "neko";
+    endpoint.format = NEKOS_PNG;
+
+    // get images twice, the second request reuses the connection
+    long connects = 0;
+    for (int i = 0; i < 2; i++) {
+        nekos_result_list results;
+        status = nekos_client_category(&client, &results, &endpoint, 1);
+        if (status != NEKOS_OK) {
+            fprintf(stderr, RED "failed!" BOLD " Error code: %d\n", status);
+            nekos_free_client(&client);
+            return EXIT_FAILURE;
+        }
+
+        long num_connects = -1;
+        curl_easy_getinfo(client.curl, CURLINFO_NUM_CONNECTS, &num_connects);
+        connects += num_connects;
+
+        nekos_free_results(&results);
+
+        // the second request must not open a new connection
+        if (i == 1 && num_connects != 0) {
+            fprintf(stderr, RED "failed!" BOLD " Second request opened %ld new connection(s).\n", num_connects);
+            nekos_free_client(&client);
+            return EXIT_FAILURE;
+        }
+    }
+    fprintf(stderr, GREEN "success.\n");
+    fprintf(stderr, WHITE BOLD "-> opened %ld connection(s) for 2 requests\n", connects);
+
+    // free client
+    nekos_free_client(&client);
+
+    return EXIT_SUCCESS;
+}
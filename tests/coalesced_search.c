@@ -0,0 +1,75 @@
+#define NEKOSBEST_IMPL
+#include <nekosbest.h>
+#include "tests_common.h"
+
+#include <pthread.h>
+
+#define THREADS 8
+
+static nekos_share share;
+
+typedef struct {
+    nekos_status status;
+    unsigned long long coalesced;
+} worker_state;
+
+static void* worker(void *arg) {
+    worker_state *state = (worker_state*) arg;
+
+    // identical searches from every thread, only one needs to reach the api
+    nekos_client client;
+    state->status = nekos_client_init(&client);
+    if (state->status != NEKOS_OK)
+        return NULL;
+    client.share = &share;
+    client.flags = NEKOS_COALESCE_REQUESTS;
+
+    nekos_result_list results;
+    state->status = nekos_client_search(&client, &results, "Senko", 3, NEKOS_PNG, NULL);
+    if (state->status == NEKOS_OK) {
+        if (results.len == 0 || !results.responses[0].url)
+            state->status = NEKOS_CJSON_ERR;
+        nekos_free_results(&results);
+    }
+
+    state->coalesced = client.stats.calls[NEKOS_STATS_SEARCH].coalesced;
+    nekos_free_client(&client);
+    return NULL;
+}
+
+int main() {
+    fprintf(stderr, WHITE BOLD "Searching from %d threads with coalesced requests... ", THREADS);
+
+    nekos_status status = nekos_global_init();
+    if (status == NEKOS_OK)
+        status = nekos_share_init(&share);
+    if (status != NEKOS_OK) {
+        fprintf(stderr, RED "failed!" BOLD " Error code: %d\n", status);
+        return EXIT_FAILURE;
+    }
+
+    // run workers
+    pthread_t threads[THREADS];
+    worker_state states[THREADS];
+    for (int i = 0; i < THREADS; i++)
+        pthread_create(&threads[i], NULL, worker, &states[i]);
+    for (int i = 0; i < THREADS; i++)
+        pthread_join(threads[i], NULL);
+
+    nekos_free_share(&share);
+    nekos_global_cleanup();
+
+    unsigned long long coalesced = 0;
+    for (int i = 0; i < THREADS; i++) {
+        if (states[i].status != NEKOS_OK) {
+            fprintf(stderr, RED "failed!" BOLD " Error code: %d\n", states[i].status);
+            return EXIT_FAILURE;
+        }
+        coalesced += states[i].coalesced;
+    }
+
+    fprintf(stderr, GREEN "success.\n");
+    fprintf(stderr, WHITE BOLD "-> %d searches, %llu served by a request in flight\n", THREADS, coalesced);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,51 @@
+#define NEKOSBEST_IMPL
+#include <nekosbest.h>
+#include "tests_common.h"
+
+int main() {
+    fprintf(stderr, WHITE BOLD "Searching image info over http/2 with compressed json... ");
+
+    // create clients with and without compression
+    nekos_client plain;
+    nekos_client compressed;
+    nekos_status status = nekos_client_init(&plain);
+    if (status == NEKOS_OK)
+        status = nekos_client_init(&compressed);
+    if (status != NEKOS_OK) {
+        fprintf(stderr, RED "failed!" BOLD " Error code: %d\n", status);
+        return EXIT_FAILURE;
+    }
+    compressed.flags = NEKOS_HTTP2 | NEKOS_COMPRESS_JSON;
+
+    // search the same images with both
+    nekos_result_list plain_results;
+    nekos_result_list compressed_results;
+    status = nekos_client_search(&plain, &plain_results, "Senko", NEKOS_MAX_AMOUNT, NEKOS_PNG, NULL);
+    if (status == NEKOS_OK) {
+        status = nekos_client_search(&compressed, &compressed_results, "Senko", NEKOS_MAX_AMOUNT, NEKOS_PNG, NULL);
+        if (status != NEKOS_OK)
+            nekos_free_results(&plain_results);
+    }
+    if (status != NEKOS_OK) {
+        fprintf(stderr, RED "failed!" BOLD " Error code: %d\n", status);
+        nekos_free_client(&plain);
+        nekos_free_client(&compressed);
+        return EXIT_FAILURE;
+    }
+
+    // the decoded results must be complete
+    int complete = compressed_results.len > 0;
+    for (size_t i = 0; complete && i < compressed_results.len; i++)
+        complete = compressed_results.responses[i].url && compressed_results.responses[i].source.png->artist_name;
+
+    fprintf(stderr, complete ? GREEN "success.\n" : RED "failed!" BOLD " Incomplete results.\n");
+    fprintf(stderr, WHITE BOLD "-> %ld results, %lld bytes received uncompressed, %lld bytes received compressed\n", compressed_results.len,
+        (long long) plain_results.timing.bytes_received, (long long) compressed_results.timing.bytes_received);
+
+    nekos_free_results(&plain_results);
+    nekos_free_results(&compressed_results);
+    nekos_free_client(&plain);
+    nekos_free_client(&compressed);
+
+    return complete ? EXIT_SUCCESS : EXIT_FAILURE;
+}
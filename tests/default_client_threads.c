@@ -0,0 +1,73 @@
+#define NEKOSBEST_IMPL
+#include <nekosbest.h>
+#include "tests_common.h"
+
+#include <pthread.h>
+
+#define THREADS 4
+#define REQUESTS 3
+
+static void* worker(void *arg) {
+    nekos_status *status = (nekos_status*) arg;
+
+    // functions without a client use the default client of this thread
+    nekos_endpoint endpoint;
+    endpoint.name = "neko";
+    endpoint.format = NEKOS_PNG;
+    *status = NEKOS_OK;
+    for (int i = 0; i < REQUESTS && *status == NEKOS_OK; i++) {
+        nekos_result_list results;
+        *status = nekos_category(&results, &endpoint, 1);
+        if (*status == NEKOS_OK)
+            nekos_free_results(&results);
+    }
+
+    // every thread counts only its own requests
+    nekos_stats stats;
+    if (*status == NEKOS_OK)
+        *status = nekos_get_stats(&stats);
+    if (*status == NEKOS_OK && stats.calls[NEKOS_STATS_CATEGORY].count != REQUESTS)
+        *status = NEKOS_LIBCURL_ERR;
+
+    return NULL;
+}
+
+int main() {
+    fprintf(stderr, WHITE BOLD "Fetching image info from %d threads without a client... ", THREADS);
+
+    // initialize library before starting threads
+    nekos_status status = nekos_global_init();
+    if (status != NEKOS_OK) {
+        fprintf(stderr, RED "failed!" BOLD " Error code: %d\n", status);
+        return EXIT_FAILURE;
+    }
+
+    // run workers, and use the default client of the main thread meanwhile
+    pthread_t threads[THREADS];
+    nekos_status statuses[THREADS];
+    for (int i = 0; i < THREADS; i++)
+        pthread_create(&threads[i], NULL, worker, &statuses[i]);
+    nekos_status main_status;
+    worker(&main_status);
+    for (int i = 0; i < THREADS; i++)
+        pthread_join(threads[i], NULL);
+
+    // the default client of the main thread is freed here
+    nekos_global_cleanup();
+
+    if (main_status != NEKOS_OK) {
+        fprintf(stderr, RED "failed!" BOLD " Error code: %d\n", main_status);
+        return EXIT_FAILURE;
+    }
+    for (int i = 0; i < THREADS; i++) {
+        if (statuses[i] != NEKOS_OK) {
+            fprintf(stderr, RED "failed!" BOLD " Error code: %d\n", statuses[i]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    fprintf(stderr, GREEN "success.\n");
+    fprintf(stderr, WHITE BOLD "-> %d requests\n", (THREADS + 1) * REQUESTS);
+
+    return EXIT_SUCCESS;
+}
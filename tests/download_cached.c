@@ -0,0 +1,48 @@
+#define NEKOSBEST_IMPL
+#include <nekosbest.h>
+#include "tests_common.h"
+
+#define URL "https://nekos.best/api/v2/neko/4c8285d0-60a9-4ccf-ac61-3bf744fafa03.png"
+#define SIZE 1138412
+
+int main() {
+    fprintf(stderr, WHITE BOLD "Downloading image through the image cache twice... ");
+
+    // create cache in the working directory
+    nekos_image_cache cache;
+    nekos_status status = nekos_image_cache_init(&cache, ".", 4 * SIZE);
+    if (status != NEKOS_OK) {
+        fprintf(stderr, RED "failed!" BOLD " Error code: %d\n", status);
+        return EXIT_FAILURE;
+    }
+
+    // download image twice, the second call maps the cached file
+    for (int i = 0; i < 2; i++) {
+        nekos_http_response http_response;
+        status = nekos_download_cached(&cache, &http_response, URL);
+        if (status != NEKOS_OK) {
+            fprintf(stderr, RED "failed!" BOLD " Error code: %d\n", status);
+            nekos_free_image_cache(&cache);
+            return EXIT_FAILURE;
+        }
+
+        // check size
+        if (http_response.len != SIZE) {
+            fprintf(stderr, RED "failed!" BOLD " Size mismatch: %ld != %d\n", http_response.len, SIZE);
+            nekos_free_cached_response(&http_response);
+            nekos_free_image_cache(&cache);
+            return EXIT_FAILURE;
+        }
+
+        nekos_free_cached_response(&http_response);
+    }
+    fprintf(stderr, GREEN "success.\n");
+    fprintf(stderr, WHITE BOLD "-> filesize matches, %llu bytes cached\n", cache.size);
+
+    // empty cache
+    cache.max_size = 0;
+    nekos_trim_image_cache(&cache);
+    nekos_free_image_cache(&cache);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,40 @@
+#define NEKOSBEST_IMPL
+#include <nekosbest.h>
+#include "tests_common.h"
+
+#define URL "https://nekos.best/api/v2/neko/4c8285d0-60a9-4ccf-ac61-3bf744fafa03.png"
+#define SIZE 1138412
+
+static char buffer[2 * 1024 * 1024];
+
+int main() {
+    fprintf(stderr, WHITE BOLD "Downloading image into a fixed buffer... ");
+
+    // download image
+    nekos_http_response http_response;
+    nekos_status status = nekos_download_into(&http_response, buffer, sizeof(buffer), URL);
+    if (status != NEKOS_OK) {
+        fprintf(stderr, RED "failed!" BOLD " Error code: %d\n", status);
+        return EXIT_FAILURE;
+    }
+
+    // check size
+    if (http_response.len != SIZE) {
+        fprintf(stderr, RED "failed!" BOLD " Size mismatch: %ld != %d\n", http_response.len, SIZE);
+        return EXIT_FAILURE;
+    }
+    fprintf(stderr, GREEN "success.\n");
+    fprintf(stderr, WHITE BOLD "-> filesize matches\n");
+
+    // download image into a buffer that is too small
+    fprintf(stderr, WHITE BOLD "Downloading image into a small buffer... ");
+    status = nekos_download_into(&http_response, buffer, SIZE / 2, URL);
+    if (status != NEKOS_BUFFER_ERR) {
+        fprintf(stderr, RED "failed!" BOLD " Expected buffer error, got: %d\n", status);
+        return EXIT_FAILURE;
+    }
+    fprintf(stderr, GREEN "success.\n");
+    fprintf(stderr, WHITE BOLD "-> download was aborted\n");
+
+    return EXIT_SUCCESS;
+}
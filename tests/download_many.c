@@ -0,0 +1,39 @@
+#define NEKOSBEST_IMPL
+#include <nekosbest.h>
+#include "tests_common.h"
+
+#define URL "https://nekos.best/api/v2/neko/4c8285d0-60a9-4ccf-ac61-3bf744fafa03.png"
+#define SIZE 1138412
+#define COUNT 4
+
+int main() {
+    fprintf(stderr, WHITE BOLD "Downloading %d images in parallel... ", COUNT);
+
+    // download images
+    const char *urls[COUNT] = { URL, URL, URL, URL };
+    nekos_http_response http_responses[COUNT];
+    nekos_status statuses[COUNT];
+    nekos_status status = nekos_download_many(http_responses, statuses, urls, COUNT, 0);
+    if (status != NEKOS_OK) {
+        fprintf(stderr, RED "failed!" BOLD " Error code: %d\n", status);
+        for (size_t i = 0; i < COUNT; i++)
+            nekos_free_http_response(&http_responses[i]);
+        return EXIT_FAILURE;
+    }
+
+    // check sizes
+    for (size_t i = 0; i < COUNT; i++) {
+        if (http_responses[i].len != SIZE) {
+            fprintf(stderr, RED "failed!" BOLD " Size mismatch: %ld != %d\n", http_responses[i].len, SIZE);
+            return EXIT_FAILURE;
+        }
+    }
+    fprintf(stderr, GREEN "success.\n");
+    fprintf(stderr, WHITE BOLD "-> all filesizes match\n");
+
+    // free responses
+    for (size_t i = 0; i < COUNT; i++)
+        nekos_free_http_response(&http_responses[i]);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,46 @@
+#define NEKOSBEST_IMPL
+#include <nekosbest.h>
+#include "tests_common.h"
+
+#define URL "https://nekos.best/api/v2/neko/4c8285d0-60a9-4ccf-ac61-3bf744fafa03.png"
+#define SIZE 1138412
+#define CHUNK_SIZE (128 * 1024)
+#define PARALLEL 4
+
+int main() {
+    fprintf(stderr, WHITE BOLD "Downloading image in byte ranges... ");
+
+    // download image into memory and into a file
+    nekos_http_response http_response;
+    nekos_status status = nekos_download_ranged(&http_response, URL, CHUNK_SIZE, PARALLEL);
+    if (status == NEKOS_OK) {
+        status = nekos_download_ranged_file("download_ranged.png", URL, CHUNK_SIZE, PARALLEL);
+        if (status != NEKOS_OK)
+            nekos_free_http_response(&http_response);
+    }
+    if (status != NEKOS_OK) {
+        fprintf(stderr, RED "failed!" BOLD " Error code: %d\n", status);
+        return EXIT_FAILURE;
+    }
+
+    // both copies must be the whole image
+    char *file_text = (char*) malloc(SIZE + 1);
+    FILE *file = fopen("download_ranged.png", "rb");
+    size_t file_len = file && file_text ? fread(file_text, 1, SIZE + 1, file) : 0;
+    if (file)
+        fclose(file);
+    remove("download_ranged.png");
+
+    int same = http_response.len == SIZE && file_len == SIZE && memcmp(http_response.text, file_text, SIZE) == 0;
+    free(file_text);
+    nekos_free_http_response(&http_response);
+    if (!same) {
+        fprintf(stderr, RED "failed!" BOLD " Size or content mismatch: %ld, %ld != %d\n", http_response.len, file_len, SIZE);
+        return EXIT_FAILURE;
+    }
+
+    fprintf(stderr, GREEN "success.\n");
+    fprintf(stderr, WHITE BOLD "-> filesize matches in memory and on disk\n");
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,39 @@
+#define NEKOSBEST_IMPL
+#include <nekosbest.h>
+#include "tests_common.h"
+
+#define URL "https://nekos.best/api/v2/neko/4c8285d0-60a9-4ccf-ac61-3bf744fafa03.png"
+#define SIZE 1138412
+
+int main() {
+    fprintf(stderr, WHITE BOLD "Streaming image to a file... ");
+
+    // create sink
+    nekos_sink sink;
+    sink.type = NEKOS_SINK_FILE;
+    sink.file = tmpfile();
+    if (!sink.file) {
+        fprintf(stderr, RED "failed!" BOLD " Could not create temporary file.\n");
+        return EXIT_FAILURE;
+    }
+
+    // stream image
+    nekos_status status = nekos_download_to(&sink, URL);
+    if (status != NEKOS_OK) {
+        fprintf(stderr, RED "failed!" BOLD " Error code: %d\n", status);
+        fclose(sink.file);
+        return EXIT_FAILURE;
+    }
+
+    // check size
+    long size = ftell(sink.file);
+    fclose(sink.file);
+    if (size != SIZE) {
+        fprintf(stderr, RED "failed!" BOLD " Size mismatch: %ld != %d\n", size, SIZE);
+        return EXIT_FAILURE;
+    }
+    fprintf(stderr, GREEN "success.\n");
+    fprintf(stderr, WHITE BOLD "-> filesize matches\n");
+
+    return EXIT_SUCCESS;
+}
@@ -19,6 +19,12 @@ int main() {
         fprintf(stderr, RED "failed!" BOLD " Endpoint not found.\n");
         return EXIT_FAILURE;
     }
+
+    // look up missing endpoint
+    if (nekos_find_endpoint(&endpoints, "not-a-category") != NULL) {
+        fprintf(stderr, RED "failed!" BOLD " Found endpoint that does not exist.\n");
+        return EXIT_FAILURE;
+    }
     fprintf(stderr, GREEN "success.\n");
 
     // print endpoint information
@@ -0,0 +1,42 @@
+#define NEKOSBEST_IMPL
+#include <nekosbest.h>
+#include "tests_common.h"
+
+int main() {
+    fprintf(stderr, WHITE BOLD "Finding endpoints in a list built by hand... ");
+
+    // build list
+    nekos_endpoint endpoints_array[3] = { { "neko", NEKOS_PNG }, { "kiss", NEKOS_GIF }, { "waifu", NEKOS_PNG } };
+    nekos_endpoint_list endpoints;
+    endpoints.endpoints = endpoints_array;
+    endpoints.len = 3;
+
+    // search linearly
+    if (nekos_find_endpoint(&endpoints, "kiss") != &endpoints_array[1] || nekos_find_endpoint(&endpoints, "not-a-category") != NULL) {
+        fprintf(stderr, RED "failed!" BOLD " Wrong endpoint found in a plain list.\n");
+        return EXIT_FAILURE;
+    }
+
+    // search through an index
+    nekos_endpoint_index index;
+    nekos_status status = nekos_index_endpoints(&index, &endpoints);
+    if (status != NEKOS_OK) {
+        fprintf(stderr, RED "failed!" BOLD " Error code: %d\n", status);
+        return EXIT_FAILURE;
+    }
+    int found = 1;
+    for (size_t i = 0; i < endpoints.len; i++)
+        found = found && nekos_find_indexed_endpoint(&index, endpoints_array[i].name) == &endpoints_array[i];
+    if (!found || nekos_find_indexed_endpoint(&index, "not-a-category") != NULL) {
+        fprintf(stderr, RED "failed!" BOLD " Wrong endpoint found through the index.\n");
+        nekos_free_endpoint_index(&index);
+        return EXIT_FAILURE;
+    }
+    fprintf(stderr, GREEN "success.\n");
+    fprintf(stderr, WHITE BOLD "-> found with and without an index\n");
+
+    // free index, the endpoints belong to the caller
+    nekos_free_endpoint_index(&index);
+
+    return EXIT_SUCCESS;
+}
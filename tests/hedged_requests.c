@@ -0,0 +1,56 @@
+#define NEKOSBEST_IMPL
+#include <nekosbest.h>
+#include "tests_common.h"
+
+#define REQUESTS 5
+
+int main() {
+    fprintf(stderr, WHITE BOLD "Fetching image info with hedged requests... ");
+
+    // create client that hedges almost immediately and retries transient failures
+    nekos_client client;
+    nekos_status status = nekos_client_init(&client);
+    if (status != NEKOS_OK) {
+        fprintf(stderr, RED "failed!" BOLD " Error code: %d\n", status);
+        return EXIT_FAILURE;
+    }
+    client.policy.connect_timeout_ms = 5000;
+    client.policy.timeout_ms = 10000;
+    client.policy.max_retries = 2;
+    client.policy.backoff_ms = 100;
+    client.policy.hedge_delay_ms = 1;
+
+    // create endpoint
+    nekos_endpoint endpoint;
+    endpoint.name = "neko";
+    endpoint.format = NEKOS_PNG;
+
+    // get images, whichever copy of each request wins must be complete
+    for (int i = 0; i < REQUESTS && status == NEKOS_OK; i++) {
+        nekos_result_list results;
+        status = nekos_client_category(&client, &results, &endpoint, 1);
+        if (status == NEKOS_OK) {
+            if (results.len != 1 || !results.responses[0].url)
+                status = NEKOS_CJSON_ERR;
+            nekos_free_results(&results);
+        }
+    }
+
+    nekos_call_stats stats = client.stats.calls[NEKOS_STATS_CATEGORY];
+    nekos_free_client(&client);
+    if (status != NEKOS_OK) {
+        fprintf(stderr, RED "failed!" BOLD " Error code: %d\n", status);
+        return EXIT_FAILURE;
+    }
+
+    // a 1ms hedge delay is always exceeded, so duplicates must have been sent
+    if (stats.count != REQUESTS || stats.hedged == 0) {
+        fprintf(stderr, RED "failed!" BOLD " %llu requests counted, %llu hedged.\n", stats.count, stats.hedged);
+        return EXIT_FAILURE;
+    }
+
+    fprintf(stderr, GREEN "success.\n");
+    fprintf(stderr, WHITE BOLD "-> %d requests, %llu hedged, %llu won by the duplicate, %llu retried\n", REQUESTS, stats.hedged, stats.hedge_wins, stats.retries);
+
+    return EXIT_SUCCESS;
+}
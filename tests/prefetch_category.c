@@ -0,0 +1,42 @@
+#define NEKOSBEST_IMPL
+#include <nekosbest.h>
+#include "tests_common.h"
+
+int main() {
+    fprintf(stderr, WHITE BOLD "Prefetching image info from neko category... ");
+
+    // create endpoint
+    nekos_endpoint endpoint;
+    endpoint.name = "neko";
+    endpoint.format = NEKOS_PNG;
+
+    // start prefetcher
+    nekos_prefetcher prefetcher;
+    nekos_status status = nekos_prefetcher_init(&prefetcher, &endpoint, 2 * NEKOS_MAX_AMOUNT, NEKOS_MAX_AMOUNT, 0);
+    if (status != NEKOS_OK) {
+        fprintf(stderr, RED "failed!" BOLD " Error code: %d\n", status);
+        return EXIT_FAILURE;
+    }
+
+    // take more results than a single batch holds
+    fprintf(stderr, GREEN "success.\n");
+    fprintf(stderr, WHITE BOLD "-> \\\n");
+    for (int i = 0; i < NEKOS_MAX_AMOUNT + 4; i++) {
+        nekos_prefetched prefetched;
+        status = nekos_prefetcher_pop(&prefetcher, &prefetched, 1);
+        if (status != NEKOS_OK) {
+            fprintf(stderr, RED "failed!" BOLD " Error code: %d\n", status);
+            nekos_free_prefetcher(&prefetcher);
+            return EXIT_FAILURE;
+        }
+
+        fprintf(stderr, PINK BOLD "  %s" WHITE BOLD " made by " CYAN BOLD "%s\n", prefetched.result.url, prefetched.result.source.png->artist_name);
+        nekos_free_result(&prefetched.result);
+        nekos_free_http_response(&prefetched.image);
+    }
+
+    // stop prefetcher
+    nekos_free_prefetcher(&prefetcher);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,36 @@
+#define NEKOSBEST_IMPL
+#include <nekosbest.h>
+#include "tests_common.h"
+
+#define URL "https://nekos.best/api/v2/neko/4c8285d0-60a9-4ccf-ac61-3bf744fafa03.png"
+#define SIZE 1138412
+
+int main() {
+    fprintf(stderr, WHITE BOLD "Probing image... ");
+
+    // probe image
+    nekos_result result;
+    memset(&result, 0, sizeof(result));
+    result.format = NEKOS_PNG;
+    result.url = URL;
+    nekos_image_info info;
+    nekos_status status = nekos_probe(&info, &result, 0);
+    if (status != NEKOS_OK) {
+        fprintf(stderr, RED "failed!" BOLD " Error code: %d\n", status);
+        return EXIT_FAILURE;
+    }
+
+    // check metadata
+    if (info.format != NEKOS_PNG || info.width == 0 || info.height == 0) {
+        fprintf(stderr, RED "failed!" BOLD " Invalid metadata: %ux%u\n", info.width, info.height);
+        return EXIT_FAILURE;
+    }
+    if (info.bytes_read >= SIZE) {
+        fprintf(stderr, RED "failed!" BOLD " Read the whole image: %zu bytes\n", info.bytes_read);
+        return EXIT_FAILURE;
+    }
+    fprintf(stderr, GREEN "success.\n");
+    fprintf(stderr, WHITE BOLD "-> %ux%u, %u frames, read %zu of %d bytes\n", info.width, info.height, info.frames, info.bytes_read, SIZE);
+
+    return EXIT_SUCCESS;
+}
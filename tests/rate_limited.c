@@ -0,0 +1,96 @@
+#define _POSIX_C_SOURCE 200809L
+
+#define NEKOSBEST_IMPL
+#include <nekosbest.h>
+#include "tests_common.h"
+
+#include <pthread.h>
+
+#define THREADS 4
+#define REQUESTS 3
+#define RATE 4.0
+#define BURST 2.0
+
+static nekos_rate_limiter limiter;
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec + (double) ts.tv_nsec / 1e9;
+}
+
+static void* worker(void *arg) {
+    nekos_status *status = (nekos_status*) arg;
+
+    // all threads draw from the same bucket
+    nekos_client client;
+    *status = nekos_client_init(&client);
+    if (*status != NEKOS_OK)
+        return NULL;
+    client.rate_limiter = &limiter;
+
+    nekos_endpoint endpoint;
+    endpoint.name = "neko";
+    endpoint.format = NEKOS_PNG;
+    for (int i = 0; i < REQUESTS && *status == NEKOS_OK; i++) {
+        nekos_result_list results;
+        *status = nekos_client_category(&client, &results, &endpoint, 1);
+        if (*status == NEKOS_OK)
+            nekos_free_results(&results);
+    }
+
+    nekos_free_client(&client);
+    return NULL;
+}
+
+int main() {
+    fprintf(stderr, WHITE BOLD "Fetching image info from %d threads through a rate limiter... ", THREADS);
+
+    nekos_status status = nekos_global_init();
+    if (status == NEKOS_OK)
+        status = nekos_rate_limiter_init(&limiter, RATE, BURST);
+    if (status != NEKOS_OK) {
+        fprintf(stderr, RED "failed!" BOLD " Error code: %d\n", status);
+        return EXIT_FAILURE;
+    }
+
+    // run workers and sample the queue every 10ms for the first second
+    double start = now_s();
+    pthread_t threads[THREADS];
+    nekos_status statuses[THREADS];
+    for (int i = 0; i < THREADS; i++)
+        pthread_create(&threads[i], NULL, worker, &statuses[i]);
+    size_t max_queued = 0;
+    for (int sample = 0; sample < 100; sample++) {
+        size_t queued = nekos_rate_limiter_queued(&limiter);
+        if (queued > max_queued)
+            max_queued = queued;
+        struct timespec delay = { 0, 10 * 1000 * 1000 };
+        nanosleep(&delay, NULL);
+    }
+    for (int i = 0; i < THREADS; i++)
+        pthread_join(threads[i], NULL);
+    double elapsed = now_s() - start;
+
+    unsigned long long throttled = limiter.throttled;
+    nekos_free_rate_limiter(&limiter);
+    nekos_global_cleanup();
+
+    for (int i = 0; i < THREADS; i++) {
+        if (statuses[i] != NEKOS_OK) {
+            fprintf(stderr, RED "failed!" BOLD " Error code: %d\n", statuses[i]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    // requests beyond the burst must have been spread out, (12 - 2) / 4 = 2.5s at least
+    if (elapsed < (THREADS * REQUESTS - BURST) / RATE || max_queued == 0) {
+        fprintf(stderr, RED "failed!" BOLD " Requests were not delayed: %.2fs, up to %zu queued.\n", elapsed, max_queued);
+        return EXIT_FAILURE;
+    }
+
+    fprintf(stderr, GREEN "success.\n");
+    fprintf(stderr, WHITE BOLD "-> %d requests in %.2fs, up to %zu queued, %llu throttled by the api\n", THREADS * REQUESTS, elapsed, max_queued, throttled);
+
+    return EXIT_SUCCESS;
+}
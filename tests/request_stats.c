@@ -0,0 +1,57 @@
+#define NEKOSBEST_IMPL
+#include <nekosbest.h>
+#include "tests_common.h"
+
+int main() {
+    fprintf(stderr, WHITE BOLD "Fetching image info with timings... ");
+
+    // create client
+    nekos_client client;
+    nekos_status status = nekos_client_init(&client);
+    if (status != NEKOS_OK) {
+        fprintf(stderr, RED "failed!" BOLD " Error code: %d\n", status);
+        return EXIT_FAILURE;
+    }
+
+    // create endpoint
+    nekos_endpoint endpoint;
+    endpoint.name = "neko";
+    endpoint.format = NEKOS_PNG;
+
+    // make a few requests
+    for (int i = 0; i < 3; i++) {
+        nekos_result_list results;
+        status = nekos_client_category(&client, &results, &endpoint, 1);
+        if (status != NEKOS_OK) {
+            fprintf(stderr, RED "failed!" BOLD " Error code: %d\n", status);
+            nekos_free_client(&client);
+            return EXIT_FAILURE;
+        }
+
+        const nekos_timing *timing = &results.timing;
+        if (i == 0) {
+            fprintf(stderr, GREEN "success.\n");
+            fprintf(stderr, WHITE BOLD "-> dns %ldus, connect %ldus, tls %ldus, first byte %ldus, total %ldus, parse %ldus, %ld bytes\n",
+                (long) timing->dns_us, (long) timing->connect_us, (long) timing->tls_us, (long) timing->first_byte_us,
+                (long) timing->total_us, (long) timing->parse_us, (long) timing->bytes_received);
+        }
+        nekos_free_results(&results);
+    }
+
+    // check cumulative statistics
+    nekos_stats stats;
+    nekos_client_get_stats(&client, &stats);
+    const nekos_call_stats *category = &stats.calls[NEKOS_STATS_CATEGORY];
+    if (category->count != 3 || category->errors != 0 || stats.calls[NEKOS_STATS_DOWNLOAD].count != 0) {
+        fprintf(stderr, RED "failed!" BOLD " Unexpected request counts.\n");
+        nekos_free_client(&client);
+        return EXIT_FAILURE;
+    }
+    fprintf(stderr, WHITE BOLD "-> %llu requests, p50 below %lluus, p99 below %lluus\n",
+        category->count, nekos_stats_percentile(category, 50), nekos_stats_percentile(category, 99));
+
+    // cleanup
+    nekos_free_client(&client);
+
+    return EXIT_SUCCESS;
+}
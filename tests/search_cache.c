@@ -0,0 +1,60 @@
+#define NEKOSBEST_IMPL
+#include <nekosbest.h>
+#include "tests_common.h"
+
+int main() {
+    fprintf(stderr, WHITE BOLD "Searching image info through a search cache... ");
+
+    // create client with a small cache
+    nekos_client client;
+    nekos_search_cache cache;
+    nekos_status status = nekos_client_init(&client);
+    if (status == NEKOS_OK)
+        status = nekos_search_cache_init(&cache, 2, 60 * 1000);
+    if (status != NEKOS_OK) {
+        fprintf(stderr, RED "failed!" BOLD " Error code: %d\n", status);
+        return EXIT_FAILURE;
+    }
+    client.search_cache = &cache;
+
+    // search twice, the second search differs only in spacing and case and is served from the cache
+    nekos_result_list first;
+    nekos_result_list second;
+    status = nekos_client_search(&client, &first, "Senko San", 3, NEKOS_PNG, NULL);
+    if (status == NEKOS_OK) {
+        status = nekos_client_search(&client, &second, "  senko\tSAN ", 3, NEKOS_PNG, NULL);
+        if (status != NEKOS_OK)
+            nekos_free_results(&first);
+    }
+    if (status != NEKOS_OK) {
+        fprintf(stderr, RED "failed!" BOLD " Error code: %d\n", status);
+        nekos_free_search_cache(&cache);
+        nekos_free_client(&client);
+        return EXIT_FAILURE;
+    }
+
+    // an invalid search must neither be served nor counted
+    nekos_result_list invalid;
+    int rejected = nekos_client_search(&client, &invalid, "Senko San", 0, NEKOS_PNG, NULL) == NEKOS_INVALID_PARAM_ERR;
+
+    // check that the cached copy matches
+    int same = rejected && first.len == second.len && cache.hits == 1 && cache.misses == 1;
+    for (size_t i = 0; same && i < first.len; i++)
+        same = strcmp(first.responses[i].url, second.responses[i].url) == 0
+            && strcmp(first.responses[i].source.png->artist_name, second.responses[i].source.png->artist_name) == 0;
+
+    nekos_free_results(&first);
+    nekos_free_results(&second);
+    nekos_free_search_cache(&cache);
+    nekos_free_client(&client);
+
+    if (!same) {
+        fprintf(stderr, RED "failed!" BOLD " Cached results differ or the cache was not hit.\n");
+        return EXIT_FAILURE;
+    }
+
+    fprintf(stderr, GREEN "success.\n");
+    fprintf(stderr, WHITE BOLD "-> %llu hit(s), %llu miss(es)\n", cache.hits, cache.misses);
+
+    return EXIT_SUCCESS;
+}
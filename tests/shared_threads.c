@@ -0,0 +1,71 @@
+#define NEKOSBEST_IMPL
+#include <nekosbest.h>
+#include "tests_common.h"
+
+#include <pthread.h>
+
+#define THREADS 4
+#define REQUESTS 5
+
+static nekos_share share;
+
+static void* worker(void *arg) {
+    nekos_status *status = (nekos_status*) arg;
+
+    // one client per thread, caches and connections come from the share
+    nekos_client client;
+    *status = nekos_client_init(&client);
+    if (*status != NEKOS_OK)
+        return NULL;
+    client.share = &share;
+
+    nekos_endpoint endpoint;
+    endpoint.name = "neko";
+    endpoint.format = NEKOS_PNG;
+    for (int i = 0; i < REQUESTS && *status == NEKOS_OK; i++) {
+        nekos_result_list results;
+        *status = nekos_client_category(&client, &results, &endpoint, 1);
+        if (*status == NEKOS_OK)
+            nekos_free_results(&results);
+    }
+
+    nekos_free_client(&client);
+    return NULL;
+}
+
+int main() {
+    fprintf(stderr, WHITE BOLD "Fetching image info from %d threads with shared state... ", THREADS);
+
+    // initialize library before starting threads
+    nekos_status status = nekos_global_init();
+    if (status == NEKOS_OK)
+        status = nekos_share_init(&share);
+    if (status != NEKOS_OK) {
+        fprintf(stderr, RED "failed!" BOLD " Error code: %d\n", status);
+        return EXIT_FAILURE;
+    }
+
+    // run workers
+    pthread_t threads[THREADS];
+    nekos_status statuses[THREADS];
+    for (int i = 0; i < THREADS; i++)
+        pthread_create(&threads[i], NULL, worker, &statuses[i]);
+    for (int i = 0; i < THREADS; i++)
+        pthread_join(threads[i], NULL);
+
+    // cleanup after all clients are gone
+    nekos_free_share(&share);
+    nekos_global_cleanup();
+
+    for (int i = 0; i < THREADS; i++) {
+        if (statuses[i] != NEKOS_OK) {
+            fprintf(stderr, RED "failed!" BOLD " Error code: %d\n", statuses[i]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    fprintf(stderr, GREEN "success.\n");
+    fprintf(stderr, WHITE BOLD "-> %d requests\n", THREADS * REQUESTS);
+
+    return EXIT_SUCCESS;
+}
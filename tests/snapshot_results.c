@@ -0,0 +1,79 @@
+#define NEKOSBEST_IMPL
+#include <nekosbest.h>
+#include "tests_common.h"
+
+#define SNAPSHOT_PATH "nekos_results.snapshot"
+
+static int same(const char *a, const char *b) {
+    return (!a && !b) || (a && b && strcmp(a, b) == 0);
+}
+
+int main() {
+    fprintf(stderr, WHITE BOLD "Sharing results through a snapshot file... ");
+
+    // fetch endpoints and a list of each format
+    nekos_endpoint_list endpoints;
+    nekos_status status = nekos_endpoints(&endpoints);
+    if (status != NEKOS_OK) {
+        fprintf(stderr, RED "failed!" BOLD " Error code: %d\n", status);
+        return EXIT_FAILURE;
+    }
+    nekos_result_list lists[2];
+    status = nekos_search(&lists[0], "smile", 10, NEKOS_GIF, NULL);
+    if (status == NEKOS_OK) {
+        status = nekos_search(&lists[1], "cat", 10, NEKOS_PNG, NULL);
+        if (status != NEKOS_OK)
+            nekos_free_results(&lists[0]);
+    }
+    if (status != NEKOS_OK) {
+        fprintf(stderr, RED "failed!" BOLD " Error code: %d\n", status);
+        nekos_free_endpoints(&endpoints);
+        return EXIT_FAILURE;
+    }
+
+    // save and map the snapshot
+    nekos_snapshot snapshot;
+    status = nekos_snapshot_save(SNAPSHOT_PATH, &endpoints, lists, 2);
+    if (status == NEKOS_OK)
+        status = nekos_snapshot_open(&snapshot, SNAPSHOT_PATH);
+    remove(SNAPSHOT_PATH);
+    if (status != NEKOS_OK) {
+        fprintf(stderr, RED "failed!" BOLD " Error code: %d\n", status);
+        return EXIT_FAILURE;
+    }
+
+    // compare the snapshot with the lists
+    int matches = nekos_snapshot_endpoint_count(&snapshot) == endpoints.len && nekos_snapshot_list_count(&snapshot) == 2;
+    for (size_t i = 0; matches && i < endpoints.len; i++) {
+        nekos_snapshot_endpoint endpoint = nekos_snapshot_get_endpoint(&snapshot, i);
+        matches = same(endpoint.name, endpoints.endpoints[i].name) && endpoint.format == endpoints.endpoints[i].format;
+    }
+    for (size_t l = 0; matches && l < 2; l++) {
+        matches = nekos_snapshot_result_count(&snapshot, l) == lists[l].len;
+        for (size_t i = 0; matches && i < lists[l].len; i++) {
+            nekos_snapshot_result result = nekos_snapshot_get_result(&snapshot, l, i);
+            const nekos_result *expected = &lists[l].responses[i];
+            matches = result.format == expected->format && same(result.url, expected->url);
+            if (matches && expected->format == NEKOS_GIF)
+                matches = same(result.anime_name, expected->source.gif->anime_name);
+            else if (matches)
+                matches = same(result.artist_name, expected->source.png->artist_name)
+                    && same(result.artist_href, expected->source.png->artist_href)
+                    && same(result.source_url, expected->source.png->source_url);
+        }
+    }
+    if (!matches) {
+        fprintf(stderr, RED "failed!" BOLD " Snapshot does not match the lists.\n");
+        return EXIT_FAILURE;
+    }
+    fprintf(stderr, GREEN "success.\n");
+    fprintf(stderr, WHITE BOLD "-> %ld endpoints and %ld results in %ld bytes\n", endpoints.len, lists[0].len + lists[1].len, snapshot.len);
+
+    // free snapshot and lists
+    nekos_free_snapshot(&snapshot);
+    nekos_free_results(&lists[0]);
+    nekos_free_results(&lists[1]);
+    nekos_free_endpoints(&endpoints);
+
+    return EXIT_SUCCESS;
+}
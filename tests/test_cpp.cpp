@@ -2,7 +2,15 @@
 #include <nekosbest.h>
 #include "tests_common.h"
 
+#if __cplusplus >= 201402L
+// known endpoints are resolved at compile time
+static_assert(nekos_constexpr_strcmp(nekos_find_known_endpoint("neko")->name, "neko") == 0, "neko is a known endpoint");
+static_assert(nekos_find_known_endpoint("neko")->format == NEKOS_PNG, "neko is a png endpoint");
+static_assert(nekos_find_known_endpoint("kiss")->format == NEKOS_GIF, "kiss is a gif endpoint");
+static_assert(!nekos_find_known_endpoint("not-a-category"), "unknown endpoints are not found");
+#endif
+
 int main() {
-    fprintf(stderr, WHITE BOLD "Compiling with c++... " GREEN BOLD "success.\n" WHITE BOLD "-> nothing was done\n");
+    fprintf(stderr, WHITE BOLD "Compiling with c++... " GREEN BOLD "success.\n" WHITE BOLD "-> known endpoints resolved at compile time\n");
     return EXIT_SUCCESS;
 }
@@ -0,0 +1,119 @@
+#define NEKOSBEST_IMPL
+#include <nekosbest.hpp>
+#include "tests_common.h"
+
+#include <poll.h>
+
+#define MAX_SOCKETS 16
+
+// minimal poll() based event loop
+struct event_loop {
+    struct pollfd fds[MAX_SOCKETS];
+    int nfds = 0;
+    long timeout_ms = -1;
+};
+
+static void socket_callback(curl_socket_t socket, int what, void *userdata) {
+    event_loop *loop = static_cast<event_loop*>(userdata);
+    int i;
+    for (i = 0; i < loop->nfds && loop->fds[i].fd != socket; i++);
+
+    if (what == CURL_POLL_REMOVE) {
+        if (i < loop->nfds)
+            loop->fds[i] = loop->fds[--loop->nfds];
+        return;
+    }
+
+    if (i == loop->nfds) {
+        if (loop->nfds == MAX_SOCKETS)
+            return;
+        loop->nfds++;
+    }
+
+    loop->fds[i].fd = socket;
+    loop->fds[i].events = static_cast<short>(((what & CURL_POLL_IN) ? POLLIN : 0) | ((what & CURL_POLL_OUT) ? POLLOUT : 0));
+}
+
+static void timer_callback(long timeout_ms, void *userdata) {
+    static_cast<event_loop*>(userdata)->timeout_ms = timeout_ms;
+}
+
+// fire-and-forget coroutine
+struct task {
+    struct promise_type {
+        task get_return_object() noexcept { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { std::terminate(); }
+    };
+};
+
+static task fetch(nekos::async_context &async, const nekos_endpoint &endpoint, int &status) {
+    try {
+        nekos::result_list results = co_await async.category(endpoint, 2);
+        for (nekos::result result : results)
+            fprintf(stderr, PINK BOLD "  %.*s" WHITE BOLD " made by " CYAN BOLD "%.*s\n", (int) result.url().size(), result.url().data(), (int) result.artist_name().size(), result.artist_name().data());
+
+        nekos::http_response image = co_await async.download(results[0]);
+        fprintf(stderr, WHITE BOLD "  downloaded %zu bytes\n", image.size());
+        status = NEKOS_OK;
+    } catch (const nekos::error &e) {
+        status = e.status();
+    }
+}
+
+int main() {
+    fprintf(stderr, WHITE BOLD "Fetching image info with the c++ wrapper... ");
+
+    // create endpoint
+    nekos_endpoint endpoint;
+    endpoint.name = (char*) "neko";
+    endpoint.format = NEKOS_PNG;
+
+    // blocking client
+    try {
+        nekos::client client;
+        nekos::result_list results = client.category(endpoint, 1);
+        fprintf(stderr, GREEN "success.\n" WHITE BOLD "-> %.*s\n", (int) results[0].url().size(), results[0].url().data());
+    } catch (const nekos::error &e) {
+        fprintf(stderr, RED "failed!" BOLD " Error code: %d\n", e.status());
+        return EXIT_FAILURE;
+    }
+
+    // awaitable requests
+    fprintf(stderr, WHITE BOLD "Fetching image info with coroutines... \n");
+    event_loop loop;
+    nekos::async_context async(socket_callback, timer_callback, &loop);
+    int status = -1;
+    fetch(async, endpoint, status);
+
+    // run event loop until the coroutine finished
+    while (status == -1) {
+        int ready = poll(loop.fds, (nfds_t) loop.nfds, loop.timeout_ms < 0 ? 1000 : (int) loop.timeout_ms);
+        if (ready == 0) {
+            async.socket_action(CURL_SOCKET_TIMEOUT, 0);
+            continue;
+        }
+
+        // copy ready sockets, callbacks may modify the poll set
+        struct pollfd fired[MAX_SOCKETS];
+        int nfired = loop.nfds;
+        memcpy(fired, loop.fds, sizeof(fired));
+        for (int i = 0; i < nfired; i++) {
+            if (!fired[i].revents)
+                continue;
+
+            int events = ((fired[i].revents & POLLIN) ? CURL_CSELECT_IN : 0) | ((fired[i].revents & POLLOUT) ? CURL_CSELECT_OUT : 0) | ((fired[i].revents & (POLLERR | POLLHUP)) ? CURL_CSELECT_ERR : 0);
+            async.socket_action(fired[i].fd, events);
+        }
+    }
+
+    if (status != NEKOS_OK) {
+        fprintf(stderr, RED "failed!" BOLD " Error code: %d\n", status);
+        return EXIT_FAILURE;
+    }
+
+    fprintf(stderr, GREEN "success.\n");
+    return EXIT_SUCCESS;
+}
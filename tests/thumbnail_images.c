@@ -0,0 +1,103 @@
+#define NEKOSBEST_IMPL
+#include <nekosbest.h>
+#include "tests_common.h"
+
+#define URL "https://nekos.best/api/v2/neko/4c8285d0-60a9-4ccf-ac61-3bf744fafa03.png"
+#define IMAGES 8
+
+// stand-in for a real decoder: raw images are "RGBA" followed by the size and the pixels,
+// pngs become a gray image of the size in their header
+static int decode(const char *data, size_t len, nekos_image *image, void *userdata) {
+    (void) userdata;
+    const unsigned char *bytes = (const unsigned char*) data;
+    if (len >= 12 && memcmp(data, "RGBA", 4) == 0) {
+        image->width = bytes[4] | (bytes[5] << 8);
+        image->height = bytes[8] | (bytes[9] << 8);
+        image->stride = (size_t) image->width * 4;
+        if (len < 12 + image->stride * image->height)
+            return 1;
+        image->pixels = (unsigned char*) malloc(image->stride * image->height);
+        memcpy(image->pixels, data + 12, image->stride * image->height);
+        return 0;
+    }
+    if (len >= 24 && memcmp(data + 12, "IHDR", 4) == 0) {
+        image->width = ((unsigned int) bytes[18] << 8) | bytes[19];
+        image->height = ((unsigned int) bytes[22] << 8) | bytes[23];
+        image->stride = (size_t) image->width * 4;
+        image->pixels = (unsigned char*) malloc(image->stride * image->height);
+        memset(image->pixels, 128, image->stride * image->height);
+        return 0;
+    }
+    return 1;
+}
+
+static void release(nekos_image *image, void *userdata) {
+    (void) userdata;
+    free(image->pixels);
+}
+
+typedef struct {
+    nekos_status status;
+    nekos_image *thumbnails;
+} outcome;
+
+static void on_thumbnails(nekos_status status, nekos_image *thumbnails, void *userdata) {
+    outcome *out = (outcome*) userdata;
+    out->status = status;
+    out->thumbnails = thumbnails;
+}
+
+int main() {
+    fprintf(stderr, WHITE BOLD "Making thumbnails on a worker pool... ");
+
+    nekos_decoder decoder = { decode, release, NULL };
+    nekos_thumbnail_size sizes[2] = { { 64, 64 }, { 16, 32 } };
+    nekos_thumbnailer thumbnailer;
+    nekos_status status = nekos_thumbnailer_init(&thumbnailer, &decoder, sizes, 2, 4);
+    if (status != NEKOS_OK) {
+        fprintf(stderr, RED "failed!" BOLD " Error code: %d\n", status);
+        return EXIT_FAILURE;
+    }
+
+    // queue 256x128 checkerboards of black and white pixels, and a download
+    outcome outcomes[IMAGES + 1];
+    for (int i = 0; i < IMAGES; i++) {
+        size_t len = 12 + 256 * 128 * 4;
+        nekos_http_response http_response;
+        http_response.text = (char*) malloc(len);
+        http_response.len = len;
+        memcpy(http_response.text, "RGBA\0\1\0\0\x80\0\0\0", 12);
+        for (size_t p = 0; p < 256 * 128; p++)
+            memset(http_response.text + 12 + p * 4, ((p % 256) + (p / 256)) % 2 ? 255 : 0, 4);
+        nekos_thumbnailer_submit(&thumbnailer, &http_response, on_thumbnails, &outcomes[i]);
+    }
+    nekos_thumbnailer_fetch(&thumbnailer, URL, on_thumbnails, &outcomes[IMAGES]);
+    nekos_free_thumbnailer(&thumbnailer);
+
+    // checkerboards average to gray and keep their aspect ratio
+    for (int i = 0; i <= IMAGES; i++) {
+        if (outcomes[i].status != NEKOS_OK) {
+            fprintf(stderr, RED "failed!" BOLD " Error code: %d\n", outcomes[i].status);
+            return EXIT_FAILURE;
+        }
+    }
+    for (int i = 0; i < IMAGES; i++) {
+        nekos_image *thumbnails = outcomes[i].thumbnails;
+        if (thumbnails[0].width != 64 || thumbnails[0].height != 32 || thumbnails[1].width != 16 || thumbnails[1].height != 8
+            || thumbnails[0].pixels[0] != 128 || thumbnails[1].pixels[4 * 16 * 8 - 1] != 128) {
+            fprintf(stderr, RED "failed!" BOLD " Unexpected thumbnail: %ux%u, %ux%u\n", thumbnails[0].width, thumbnails[0].height, thumbnails[1].width, thumbnails[1].height);
+            return EXIT_FAILURE;
+        }
+        nekos_free_thumbnails(thumbnails);
+    }
+    nekos_image *fetched = outcomes[IMAGES].thumbnails;
+    if (fetched[0].width > 64 || fetched[0].height > 64 || (fetched[0].width != 64 && fetched[0].height != 64)) {
+        fprintf(stderr, RED "failed!" BOLD " Unexpected thumbnail: %ux%u\n", fetched[0].width, fetched[0].height);
+        return EXIT_FAILURE;
+    }
+    fprintf(stderr, GREEN "success.\n");
+    fprintf(stderr, WHITE BOLD "-> %d images downscaled, downloaded image fits in %ux%u\n", IMAGES + 1, fetched[0].width, fetched[0].height);
+    nekos_free_thumbnails(fetched);
+
+    return EXIT_SUCCESS;
+}